@@ -30,27 +30,16 @@
 #include "cmdlnopts.h"
 #include "bta_shdata.h"
 #include "angle_functions.h"
+#include "apparent.h"
 #include "usefull_macros.h"
 
 static char buf[BUFSZ+1];
 
 extern void sla_caldj(int*, int*, int*, double*, int*);
-extern void sla_amp(double*, double*, double*, double*, double*, double*);
-extern void sla_map(double*, double*, double*, double*, double*,double*, double*, double*, double*, double*);
 void slacaldj(int y, int m, int d, double *djm, int *j){
 	int iy = y, im = m, id = d;
 	sla_caldj(&iy, &im, &id, djm, j);
 }
-void slaamp(double ra, double da, double date, double eq, double *rm, double *dm ){
-	double r = ra, d = da, mjd = date, equi = eq;
-	sla_amp(&r, &d, &mjd, &equi, rm, dm);
-}
-void slamap(double rm, double dm, double pr, double pd,
-             double px, double rv, double eq, double date,
-             double *ra, double *da){
-	double r = rm, d = dm, p1 = pr, p2 = pd, ppx = px, prv = rv, equi = eq, dd = date;
-	sla_map(&r, &d, &p1, &p2, &ppx, &prv, &equi, &dd, ra, da);
-}
 
 /**
  *  convert angle in seconds into degrees
@@ -84,7 +73,8 @@ bool myatoi(int32_t *num, char **str){
 	assert(num);
 	assert(*str);
 	*num = 0;
-	tmp = strtoll(*str, &endptr, 0);
+	errno = 0;
+	tmp = strtoll(*str, &endptr, 10); // not 0: "08" of sexagesimal angle isn't wrong octal
 	if(endptr == *str || errno == ERANGE)
 		return FALSE;
 	if(tmp < INT_MIN || tmp > INT_MAX){
@@ -104,6 +94,7 @@ bool myatod(double *num, char **str){
 	assert(str);
 	assert(num);
 	assert(*str);
+	errno = 0;
 	tmp = strtod(*str, &endptr);
 	if(endptr == *str || errno == ERANGE)
 		return FALSE;
@@ -177,9 +168,11 @@ char *get_degrees(double *ret, char *str){
 	if(str[0] == '\''){ // one number in format "xx'" or "xx''"
 		if(str[1] == 0){ // minutes
 			assignresult(min);
+			++str;
 			goto allOK;
 		}else if(str[1] == '\'' && str[2] == 0){ // seconds
 			assignresult(sec);
+			str += 2;
 			goto allOK;
 		}else goto badfmt;
 	}
@@ -216,16 +209,14 @@ badfmt:
  * @param appRA, appDecl (o) - calculated apparent place
  */
 bool calc_AP(double r, double d, double *appRA, double *appDecl){
-	double mjd = 51544.5; // mjd2000
-	// convert to radians
-	r *= DH2R;
-	d *= DD2R;
-	double ra2000 = r, decl2000 = d; // coordinates for 2000.0
+	// RA/Decl for 2000.0 or apparent at epoch; proper motion on R.A./Decl (mas/year)
+	ap_star star = {.ra = r * 3600., .dec = d * 3600., .pmra = GP->pmra, .pmdec = GP->pmdecl};
 	const double jd0 = 2400000.5; // JD for MJD==0
 	// epoch given - calculate it
 	if(GP->epoch){
 		DBG("Epoch: %s", GP->epoch);
 		char *str = GP->epoch;
+		double mjd;
 		if(strcasecmp(str, "now") == 0 || strcmp(str, "1") == 0){ // now
 			mjd = JDate - jd0;
 		}else{ // check given data
@@ -251,17 +242,11 @@ bool calc_AP(double r, double d, double *appRA, double *appDecl){
 			}
 			mjd += add;
 		}
-		DBG("slaamp(%g, %g, %g, 2000.0, ra, dec)", r,d,mjd);
-		slaamp(r, d, mjd, 2000.0, &ra2000, &decl2000);
-		DBG("2000: %g, %g", ra2000*DR2H, decl2000*DR2D);
+		star.epoch = mjd;
 	}
-	// proper motion on  R.A./Decl (mas/year)
-	double pmra = GP->pmra/1000.*DAS2R, pmdecl = GP->pmdecl/1000.*DAS2R;
-	mjd = JDate - jd0;
-	slamap(ra2000, decl2000, pmra, pmdecl, 0., 0., 2000.0, mjd, &r, &d);
-	DBG("APP: %g, %g", r*DR2H, d*DR2D);
-	r *= DR2S;
-	d *= DR2AS;
+	ap_setup(GP->aptol, 1);
+	ap_batch(1, &star, JDate - jd0, &r, &d);
+	DBG("APP: %g, %g", r / 3600., d / 3600.);
 	if(appRA) *appRA = r;
 	if(appDecl) *appDecl = d;
 	return TRUE;
@@ -0,0 +1,187 @@
+/*
+ * apparent.c - batch apparent places with cached star-independent parameters
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <slamac.h>  // SLA macros
+
+#include "apparent.h"
+#include "usefull_macros.h"
+
+/*
+ * sla_map() (like sla_amp()) calculates all star-independent parameters (precession,
+ * nutation, Earth position & velocity: 21 `amprms`) on each call. Here they are got by
+ * sla_mappa() once for given time & reused while time differs from time of their
+ * calculation not more than tolerance; parameters for epochs of stars are cached in
+ * sorted array. Per-star transforms (sla_mapqkz, sla_mapqk for proper motion, sla_ampqk
+ * for apparent place at epoch) are shared between threads.
+ */
+extern void sla_mappa(double*, double*, double*);
+extern void sla_mapqkz(double*, double*, double*, double*, double*);
+extern void sla_mapqk(double*, double*, double*, double*, double*, double*, double*, double*, double*);
+extern void sla_ampqk(double*, double*, double*, double*, double*);
+
+// min amount of stars for one thread
+#define AP_MINTHR       (4096)
+#define AP_MAXTHREADS   (256)
+// epochs' cache is cleared when it becomes bigger
+#define AP_MAXEPOCHS    (4096)
+
+typedef struct{
+	double date;        // MJD
+	double amprms[21];  // star-independent parameters for mean J2000.0 <-> apparent at `date`
+} ap_params;
+
+typedef struct{
+	pthread_t thread;
+	const ap_star *stars;
+	size_t n;
+	double *ra, *dec;
+} ap_worker;
+
+static double Tol = 0.;         // tolerance (days)
+static int Nthreads = 0;        // amount of threads (0 - by number of CPUs)
+static ap_params Now = {.date = -1e9};
+static ap_params *Epochs = NULL;// sorted by date
+static size_t Nep = 0, Epsize = 0;
+
+/**
+ * Set parameters of calculations
+ * @param tolerance - max time (seconds) between given time & time of cached parameters
+ * @param nthreads  - amount of threads (0 - by number of CPUs)
+ */
+void ap_setup(double tolerance, int nthreads){
+	Tol = (tolerance > 0.) ? tolerance / 86400. : 0.;
+	Nthreads = nthreads;
+}
+
+static void get_params(ap_params *p, double mjd){
+	double eq = 2000.;
+	p->date = mjd;
+	sla_mappa(&eq, &mjd, p->amprms);
+}
+
+// parameters of epoch within tolerance or NULL
+static const ap_params *find_epoch(double mjd){
+	size_t lo = 0, hi = Nep;
+	while(lo < hi){
+		size_t mid = (lo + hi) / 2;
+		if(Epochs[mid].date < mjd) lo = mid + 1;
+		else hi = mid;
+	}
+	if(lo < Nep && Epochs[lo].date - mjd <= Tol) return &Epochs[lo];
+	if(lo && mjd - Epochs[lo-1].date <= Tol) return &Epochs[lo-1];
+	return NULL;
+}
+
+static const ap_params *add_epoch(double mjd){
+	size_t i;
+	if(Nep == Epsize){
+		Epsize = Epsize ? Epsize * 2 : 16;
+		if(!(Epochs = realloc(Epochs, Epsize * sizeof(ap_params)))) ERR("realloc()");
+	}
+	for(i = Nep; i && Epochs[i-1].date > mjd; --i);
+	memmove(&Epochs[i+1], &Epochs[i], (Nep - i) * sizeof(ap_params));
+	++Nep;
+	get_params(&Epochs[i], mjd);
+	return &Epochs[i];
+}
+
+static void *ap_thread(void *arg){
+	ap_worker *w = (ap_worker*)arg;
+	const ap_params *ep = NULL;
+	size_t i;
+	for(i = 0; i < w->n; ++i){
+		const ap_star *s = &w->stars[i];
+		double r = s->ra * DS2R, d = s->dec * DAS2R, ra, da;
+		if(s->epoch != 0.){ // apparent place at epoch -> mean J2000.0
+			if(!ep || fabs(ep->date - s->epoch) > Tol) ep = find_epoch(s->epoch);
+			assert(ep);
+			sla_ampqk(&r, &d, (double*)ep->amprms, &ra, &da);
+			r = ra; d = da;
+		}
+		if(s->pmra != 0. || s->pmdec != 0.){
+			double pr = s->pmra / 1000. * DAS2R, pd = s->pmdec / 1000. * DAS2R, px = 0., rv = 0.;
+			sla_mapqk(&r, &d, &pr, &pd, &px, &rv, Now.amprms, &ra, &da);
+		}else
+			sla_mapqkz(&r, &d, Now.amprms, &ra, &da);
+		w->ra[i] = ra * DR2S;
+		w->dec[i] = da * DR2AS;
+	}
+	return NULL;
+}
+
+/**
+ * Calculate apparent places of stars
+ * @param n     - amount of stars
+ * @param stars - stars
+ * @param mjd   - MJD of apparent places
+ * @param ra, dec (o) - apparent R.A. (seconds of time) & Decl. (arcseconds)
+ */
+void ap_batch(size_t n, const ap_star *stars, double mjd, double *ra, double *dec){
+	ap_worker w[AP_MAXTHREADS];
+	const ap_params *last = NULL;
+	size_t i, from = 0;
+	int j, nthr = Nthreads;
+	if(!n) return;
+	if(fabs(Now.date - mjd) > Tol) get_params(&Now, mjd);
+	// parameters of all epochs should be ready before threads start
+	if(Nep > AP_MAXEPOCHS) Nep = 0;
+	for(i = 0; i < n; ++i){
+		double e = stars[i].epoch;
+		if(e == 0. || (last && fabs(last->date - e) <= Tol)) continue;
+		if(!(last = find_epoch(e))) last = add_epoch(e);
+	}
+	if(nthr < 1) nthr = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if((size_t)nthr > n / AP_MINTHR) nthr = (int)(n / AP_MINTHR);
+	if(nthr > AP_MAXTHREADS) nthr = AP_MAXTHREADS;
+	if(nthr < 2){
+		w[0] = (ap_worker){.stars = stars, .n = n, .ra = ra, .dec = dec};
+		ap_thread(&w[0]);
+		return;
+	}
+	for(j = 0; j < nthr; ++j){
+		size_t to = n * (j + 1) / nthr;
+		w[j] = (ap_worker){.stars = &stars[from], .n = to - from, .ra = &ra[from], .dec = &dec[from]};
+		if(pthread_create(&w[j].thread, NULL, ap_thread, &w[j]))
+			ERR("pthread_create()");
+		from = to;
+	}
+	for(j = 0; j < nthr; ++j) pthread_join(w[j].thread, NULL);
+}
+
+/**
+ * Calculate mean J2000.0 place of one star by its apparent place (not for threads:
+ * parameters of time are stored in cache of epochs)
+ * @param mjd     - MJD of apparent place
+ * @param ra, dec - apparent R.A. (seconds of time) & Decl. (arcseconds)
+ * @param rm, dm (o) - mean R.A. & Decl.
+ */
+void ap_mean(double mjd, double ra, double dec, double *rm, double *dm){
+	const ap_params *p = find_epoch(mjd);
+	double r = ra * DS2R, d = dec * DAS2R, a, b;
+	if(!p) p = add_epoch(mjd);
+	sla_ampqk(&r, &d, (double*)p->amprms, &a, &b);
+	*rm = a * DR2S;
+	*dm = b * DR2AS;
+}
@@ -0,0 +1,40 @@
+/*
+ * apparent.h - batch apparent places with cached star-independent parameters
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __APPARENT_H__
+#define __APPARENT_H__
+
+#include <stddef.h>
+
+// star of batch apparent place calculation
+typedef struct{
+	double ra;      // R.A. (seconds of time): mean J2000.0 or apparent at `epoch`
+	double dec;     // Decl. (arcseconds)
+	double pmra;    // proper motion by R.A. (mas/year)
+	double pmdec;   // proper motion by Decl. (mas/year)
+	double epoch;   // MJD of given apparent place or 0 for mean J2000.0
+} ap_star;
+
+void ap_setup(double tolerance, int nthreads);
+void ap_batch(size_t n, const ap_star *stars, double mjd, double *ra, double *dec);
+void ap_mean(double mjd, double ra, double dec, double *rm, double *dm);
+
+#endif // __APPARENT_H__
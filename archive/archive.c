@@ -0,0 +1,669 @@
+/*
+ * archive.c - compressed archive of BTA telemetry
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE // strptime, timegm
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+
+#include "archive.h"
+#include "bta_fields.h"
+
+/*
+ * Columns of archive: raw values of fields marked ARC in BTA_FIELDS (bta_fields.h);
+ * names are pasted at first level: some of them are macros in bta_shdata.h
+ */
+#define ARC_COLTYPE_DBL     COL_DOUBLE
+#define ARC_COLTYPE_I32     COL_STATE
+#define ARC_COLTYPE_U32     COL_STATE
+#define ARC_COL_ARC(nm, src, mb, tp) \
+	{nm, ARC_COLTYPE_ ## tp, (BTA_FSRC_ ## src == FS_LOCAL), BTA_FOFF_ ## src(mb)},
+#define ARC_COL_NOARC(nm, src, mb, tp)
+#define ARC_COL(name, lvl, flags, store, src, member, type, ...) ARC_COL_ ## store(#name, src, member, type)
+const arc_column arc_columns[] = {
+	BTA_FIELDS(ARC_COL)
+	{NULL, 0, 0, 0}
+};
+#undef ARC_COL
+#undef ARC_COL_ARC
+#undef ARC_COL_NOARC
+
+// index of column in arc_columns by field index (+1, 0 if field isn't stored)
+#define ARC_IDX_ARC(col, fld)   col,
+#define ARC_IDX_NOARC(col, fld)
+#define ARC_IDX(name, lvl, flags, store, ...) ARC_IDX_ ## store(ARCCOL_ ## name, FLD_ ## name)
+enum{
+	BTA_FIELDS(ARC_IDX)
+	ARCCOL_AMOUNT
+};
+#undef ARC_IDX_ARC
+#define ARC_IDX_ARC(col, fld)   [fld] = col + 1,
+static const uint8_t fld2col[FLD_AMOUNT] = {
+	BTA_FIELDS(ARC_IDX)
+};
+#undef ARC_IDX
+#undef ARC_IDX_ARC
+#undef ARC_IDX_NOARC
+
+/**
+ * @return index of column in arc_columns or -1
+ */
+int arc_colidx(const char *name){
+	int f;
+	if(!name || (f = bta_field_idx(name, strlen(name))) < 0) return -1;
+	return (int)fld2col[f] - 1;
+}
+
+/**
+ * Convert string "YYYY-MM-DD HH:MM:SS[.S]" (UTC) or number to UNIX time
+ * @return 0 if failed
+ */
+int arc_str2time(char *str, double *t){
+	struct tm tm;
+	char *e;
+	memset(&tm, 0, sizeof(tm));
+	if((e = strptime(str, "%Y-%m-%d %H:%M:%S", &tm))){
+		double frac = 0.;
+		if(*e == '.') frac = strtod(e, &e);
+		if(*e) return 0;
+		*t = (double)timegm(&tm) + frac;
+		return 1;
+	}
+	*t = strtod(str, &e);
+	return (e != str && !*e);
+}
+
+/**
+ * Convert UNIX time into string "YYYY-MM-DD HH:MM:SS.SS" (UTC)
+ * @param buf - buffer for string (not less than 32 bytes)
+ */
+char *arc_time2str(double t, char *buf){
+	time_t sec = (time_t)floor(t);
+	struct tm tm;
+	gmtime_r(&sec, &tm);
+	size_t l = strftime(buf, 32, "%Y-%m-%d %H:%M:%S", &tm);
+	snprintf(buf + l, 32 - l, ".%02d", (int)((t - floor(t)) * 100.));
+	return buf;
+}
+
+/******************************************************************************\
+ *                          Bit streams                                        *
+\******************************************************************************/
+typedef struct{
+	uint8_t *buf;
+	size_t size;    // allocated bytes
+	size_t pos;     // bits written
+} bitwriter;
+
+typedef struct{
+	const uint8_t *buf;
+	size_t pos;     // bits read
+	size_t lim;     // size of stream (bits), pos > lim after reading out of it
+} bitreader;
+
+// reserve place for `n` bits (+ 8 bytes of zeros after end for reader)
+static void bw_reserve(bitwriter *b, size_t n){
+	size_t need = ((b->pos + n) >> 3) + 9;
+	if(need <= b->size) return;
+	size_t newsz = b->size ? b->size : 4096;
+	while(newsz < need) newsz *= 2;
+	b->buf = realloc(b->buf, newsz);
+	if(!b->buf) ERR("realloc");
+	memset(b->buf + b->size, 0, newsz - b->size);
+	b->size = newsz;
+}
+
+// put `n` (<= 64) lowest bits of `v`
+static void bw_put(bitwriter *b, uint64_t v, int n){
+	if(n <= 0) return;
+	if(n < 64) v &= (1ULL << n) - 1;
+	bw_reserve(b, n);
+	while(n > 0){
+		size_t byte = b->pos >> 3;
+		int room = 8 - (int)(b->pos & 7), k = (n < room) ? n : room;
+		b->buf[byte] |= (uint8_t)(((v >> (n - k)) & ((1U << k) - 1)) << (room - k));
+		b->pos += k;
+		n -= k;
+	}
+}
+
+static inline uint64_t br_get(bitreader *r, int n){
+	uint64_t w;
+	if(n <= 0) return 0;
+	if(r->pos + n > r->lim){ // broken stream: don't read after its end
+		r->pos = r->lim + 1;
+		return 0;
+	}
+	if(n > 56){
+		uint64_t hi = br_get(r, n - 32);
+		return (hi << 32) | br_get(r, 32);
+	}
+	memcpy(&w, r->buf + (r->pos >> 3), 8);
+	w = __builtin_bswap64(w) << (r->pos & 7);
+	r->pos += n;
+	return w >> (64 - n);
+}
+
+static inline uint64_t zigzag(int64_t x){ return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63);}
+static inline int64_t unzigzag(uint64_t x){ return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);}
+
+/******************************************************************************\
+ *                          Encoders/decoders                                  *
+\******************************************************************************/
+// XOR: '0' - the same value; '10' + bits in previous window; '11' + 5 bits of leading
+// zeros + 6 bits of length + meaningful bits
+static void enc_xor(bitwriter *b, const uint64_t *v, uint32_t n){
+	uint32_t i;
+	int plz = -1, ptz = 0;
+	bw_put(b, v[0], 64);
+	for(i = 1; i < n; ++i){
+		uint64_t x = v[i] ^ v[i-1];
+		if(!x){ bw_put(b, 0, 1); continue; }
+		int lz = __builtin_clzll(x), tz = __builtin_ctzll(x);
+		if(lz > 31) lz = 31;
+		if(plz >= 0 && lz >= plz && tz >= ptz){
+			bw_put(b, 2, 2);
+			bw_put(b, x >> ptz, 64 - plz - ptz);
+		}else{
+			int len = 64 - lz - tz;
+			bw_put(b, 3, 2);
+			bw_put(b, lz, 5);
+			bw_put(b, len - 1, 6);
+			bw_put(b, x >> tz, len);
+			plz = lz; ptz = tz;
+		}
+	}
+}
+
+static void dec_xor(bitreader *r, uint64_t *v, uint32_t n){
+	uint32_t i;
+	int plz = 0, ptz = 0;
+	v[0] = br_get(r, 64);
+	for(i = 1; i < n; ++i){
+		if(!br_get(r, 1)){ v[i] = v[i-1]; continue; }
+		if(br_get(r, 1)){
+			plz = (int)br_get(r, 5);
+			int len = (int)br_get(r, 6) + 1;
+			if((ptz = 64 - plz - len) < 0){
+				r->pos = r->lim + 1;
+				return;
+			}
+		}
+		v[i] = v[i-1] ^ (br_get(r, 64 - plz - ptz) << ptz);
+	}
+}
+
+// variable-length integer for delta of delta: '0' - zero, '10'+7, '110'+12, '1110'+20,
+// '11110'+32, '11111'+64 bits
+static void put_dod(bitwriter *b, uint64_t z){
+	if(!z) bw_put(b, 0, 1);
+	else if(z < (1ULL << 7)){ bw_put(b, 2, 2); bw_put(b, z, 7); }
+	else if(z < (1ULL << 12)){ bw_put(b, 6, 3); bw_put(b, z, 12); }
+	else if(z < (1ULL << 20)){ bw_put(b, 14, 4); bw_put(b, z, 20); }
+	else if(z < (1ULL << 32)){ bw_put(b, 30, 5); bw_put(b, z, 32); }
+	else{ bw_put(b, 31, 5); bw_put(b, z, 64); }
+}
+
+static inline uint64_t get_dod(bitreader *r){
+	int nones = 0;
+	while(nones < 5 && br_get(r, 1)) ++nones;
+	switch(nones){
+		case 0: return 0;
+		case 1: return br_get(r, 7);
+		case 2: return br_get(r, 12);
+		case 3: return br_get(r, 20);
+		case 4: return br_get(r, 32);
+		default: return br_get(r, 64);
+	}
+}
+
+// delta of delta: values are treated as integers (all arithmetics is modulo 2^64)
+static void enc_dod(bitwriter *b, const uint64_t *v, uint32_t n){
+	uint32_t i;
+	uint64_t d = 0;
+	bw_put(b, v[0], 64);
+	for(i = 1; i < n; ++i){
+		uint64_t nd = v[i] - v[i-1];
+		put_dod(b, zigzag((int64_t)(nd - d)));
+		d = nd;
+	}
+}
+
+static void dec_dod(bitreader *r, uint64_t *v, uint32_t n){
+	uint32_t i;
+	uint64_t d = 0;
+	v[0] = br_get(r, 64);
+	for(i = 1; i < n; ++i){
+		d += (uint64_t)unzigzag(get_dod(r));
+		v[i] = v[i-1] + d;
+	}
+}
+
+static void put_varint(bitwriter *b, uint64_t x){
+	while(x > 0x7f){
+		bw_put(b, (x & 0x7f) | 0x80, 8);
+		x >>= 7;
+	}
+	bw_put(b, x, 8);
+}
+
+static inline uint64_t get_varint(bitreader *r){
+	uint64_t x = 0, c;
+	int sh = 0;
+	do{
+		c = br_get(r, 8);
+		x |= (c & 0x7f) << sh;
+		sh += 7;
+	}while((c & 0x80) && sh < 64);
+	return x;
+}
+
+// RLE: pairs (value, repeats - 1) as varints
+static void enc_rle(bitwriter *b, const uint64_t *v, uint32_t n){
+	uint32_t i = 0;
+	while(i < n){
+		uint32_t j = i + 1;
+		while(j < n && v[j] == v[i]) ++j;
+		put_varint(b, v[i]);
+		put_varint(b, j - i - 1);
+		i = j;
+	}
+}
+
+static void dec_rle(bitreader *r, uint64_t *v, uint32_t n){
+	uint32_t i = 0;
+	while(i < n){
+		uint64_t val = get_varint(r), rep = get_varint(r) + 1;
+		if(rep > n - i) rep = n - i;
+		while(rep--) v[i++] = val;
+	}
+}
+
+/**
+ * Encode column into writer `b` (method byte + data)
+ * For doubles both XOR & DOD are tried, the shortest is stored
+ */
+static void encode_column(bitwriter *b, const uint64_t *v, uint32_t n, col_type type, int forcedod){
+	if(type == COL_STATE){
+		bw_put(b, ENC_RLE, 8);
+		enc_rle(b, v, n);
+	}else{
+		bitwriter x = {0}, d = {0}, *best;
+		int method;
+		enc_dod(&d, v, n);
+		if(!forcedod) enc_xor(&x, v, n);
+		if(forcedod || d.pos <= x.pos){ best = &d; method = ENC_DOD; }
+		else{ best = &x; method = ENC_XOR; }
+		bw_put(b, method, 8);
+		size_t nbytes = (best->pos + 7) >> 3, i;
+		bw_reserve(b, nbytes * 8);
+		for(i = 0; i < nbytes; ++i) bw_put(b, best->buf[i], 8);
+		free(x.buf);
+		free(d.buf);
+	}
+	// byte-align stream
+	if(b->pos & 7) bw_put(b, 0, 8 - (b->pos & 7));
+}
+
+/**
+ * Decode column
+ * @param data - stream (method byte + data), 8 bytes after it should be readable
+ * @param size - size of stream (bytes)
+ * @return 0 if stream is broken
+ */
+static int decode_column(const uint8_t *data, uint32_t size, uint32_t n, double *out){
+	bitreader r = {data + 1, 0, ((size_t)size - 1) * 8};
+	uint64_t *v = (uint64_t*)out;
+	uint32_t i;
+	switch(data[0]){
+		case ENC_XOR: dec_xor(&r, v, n); break;
+		case ENC_DOD: dec_dod(&r, v, n); break;
+		case ENC_RLE:
+			dec_rle(&r, v, n);
+			// state words could be negative (P2_Minus etc)
+			for(i = 0; i < n; ++i) out[i] = (double)(int32_t)(uint32_t)v[i];
+		break;
+		default:
+			WARNX(_("Unknown encoding %d"), data[0]);
+			return 0;
+	}
+	return (r.pos <= r.lim);
+}
+
+/******************************************************************************\
+ *                          Writer                                             *
+\******************************************************************************/
+struct arc_writer{
+	FILE *f;
+	uint32_t blockrecs;
+	uint32_t n;             // records in current block
+	uint32_t ncols;
+	uint64_t *t;            // time
+	uint64_t *col[ARC_MAXCOLS];
+	arc_header hdr;
+	arc_index *idx;
+	uint32_t idxsize;
+};
+
+/**
+ * Create new archive file
+ * @param filename  - name of file
+ * @param blockrecs - max amount of records in block
+ * @return writer or NULL
+ */
+arc_writer *arc_create(char *filename, int blockrecs){
+	arc_writer *w;
+	uint32_t i;
+	if(blockrecs < 2) blockrecs = ARC_DEFBLOCK;
+	FILE *f = fopen(filename, "w");
+	if(!f){
+		WARN(_("Can't open %s for writing"), filename);
+		return NULL;
+	}
+	w = MALLOC(arc_writer, 1);
+	w->f = f;
+	w->blockrecs = blockrecs;
+	for(i = 0; arc_columns[i].name; ++i)
+		w->col[i] = MALLOC(uint64_t, blockrecs);
+	w->ncols = i;
+	w->t = MALLOC(uint64_t, blockrecs);
+	memcpy(w->hdr.magic, ARC_MAGIC, 8);
+	w->hdr.version = ARC_VERSION;
+	w->hdr.ncols = w->ncols;
+	w->hdr.blockrecs = blockrecs;
+	// header & columns description
+	fwrite(&w->hdr, sizeof(arc_header), 1, f);
+	for(i = 0; i < w->ncols; ++i){
+		arc_coldesc d = {{0}, arc_columns[i].type, 0};
+		snprintf(d.name, ARC_NAMELEN, "%s", arc_columns[i].name);
+		fwrite(&d, sizeof(d), 1, f);
+	}
+	return w;
+}
+
+// write current block
+static int flush_block(arc_writer *w){
+	bitwriter b = {0};
+	uint32_t i, hdrsz = (w->ncols + 3) * sizeof(uint32_t);
+	uint32_t *sizes = MALLOC(uint32_t, w->ncols + 3);
+	size_t prev;
+	long offset;
+	if(!w->n) return 1;
+	sizes[0] = w->n;
+	sizes[1] = w->ncols;
+	encode_column(&b, w->t, w->n, COL_DOUBLE, 1);
+	sizes[2] = (uint32_t)(b.pos >> 3);
+	prev = b.pos;
+	for(i = 0; i < w->ncols; ++i){
+		encode_column(&b, w->col[i], w->n, arc_columns[i].type, 0);
+		sizes[i + 3] = (uint32_t)((b.pos - prev) >> 3);
+		prev = b.pos;
+	}
+	offset = ftell(w->f);
+	if(w->hdr.nblocks == w->idxsize){
+		w->idxsize = w->idxsize ? w->idxsize * 2 : 256;
+		w->idx = realloc(w->idx, w->idxsize * sizeof(arc_index));
+		if(!w->idx) ERR("realloc");
+	}
+	arc_index *x = &w->idx[w->hdr.nblocks++];
+	memcpy(&x->tfirst, &w->t[0], sizeof(double));
+	memcpy(&x->tlast, &w->t[w->n - 1], sizeof(double));
+	x->offset = (uint64_t)offset;
+	x->size = hdrsz + (uint32_t)(b.pos >> 3) + 8;
+	x->nrec = w->n;
+	// 8 zero bytes after data: reader takes 64 bits at once
+	bw_reserve(&b, 64);
+	if(fwrite(sizes, hdrsz, 1, w->f) != 1 || fwrite(b.buf, (b.pos >> 3) + 8, 1, w->f) != 1){
+		WARN(_("Can't write block"));
+		FREE(sizes);
+		free(b.buf);
+		return 0;
+	}
+	FREE(sizes);
+	free(b.buf);
+	w->n = 0;
+	return 1;
+}
+
+/**
+ * Add record into archive
+ * @param t - UNIX time of record (should grow)
+ * @return 0 if failed
+ */
+int arc_add(arc_writer *w, double t, struct BTA_Data *data, struct BTA_Local *local){
+	uint32_t i, n = w->n;
+	if(w->hdr.nrec && t <= w->hdr.tlast) return 1; // skip old data
+	memcpy(&w->t[n], &t, sizeof(double));
+	for(i = 0; i < w->ncols; ++i){
+		const arc_column *c = &arc_columns[i];
+		const uint8_t *base = c->local ? (const uint8_t*)local : (const uint8_t*)data;
+		if(c->type == COL_STATE){
+			uint32_t u;
+			memcpy(&u, base + c->offset, sizeof(u));
+			w->col[i][n] = u;
+		}else memcpy(&w->col[i][n], base + c->offset, sizeof(double));
+	}
+	if(!w->hdr.nrec) w->hdr.tfirst = t;
+	w->hdr.tlast = t;
+	++w->hdr.nrec;
+	if(++w->n == w->blockrecs) return flush_block(w);
+	return 1;
+}
+
+/**
+ * Write last block & index, close file
+ * @param rawsize (o) - size of archive file
+ * @return 0 if failed
+ */
+int arc_finish(arc_writer *w, uint64_t *rawsize){
+	int ret = flush_block(w);
+	uint32_t i;
+	w->hdr.idxoff = (uint64_t)ftell(w->f);
+	if(w->hdr.nblocks && fwrite(w->idx, sizeof(arc_index), w->hdr.nblocks, w->f) != w->hdr.nblocks) ret = 0;
+	if(rawsize) *rawsize = (uint64_t)ftell(w->f);
+	if(fseek(w->f, 0, SEEK_SET) || fwrite(&w->hdr, sizeof(arc_header), 1, w->f) != 1) ret = 0;
+	if(fclose(w->f)) ret = 0;
+	if(!ret) WARN(_("Error writing archive"));
+	for(i = 0; i < w->ncols; ++i) FREE(w->col[i]);
+	FREE(w->t);
+	free(w->idx);
+	FREE(w);
+	return ret;
+}
+
+/******************************************************************************\
+ *                          Reader                                             *
+\******************************************************************************/
+/**
+ * mmap file (unlike My_mmap don't exit if it's absent: query should skip it)
+ * @return NULL if file can't be mapped or is too short
+ */
+static mmapbuf *arc_mmap(char *filename){
+	int fd;
+	struct stat st;
+	void *ptr;
+	mmapbuf *b;
+	if((fd = open(filename, O_RDONLY)) < 0){
+		WARN(_("Can't open %s"), filename);
+		return NULL;
+	}
+	if(fstat(fd, &st) || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(arc_header)){
+		WARNX(_("%s isn't BTA archive"), filename);
+		close(fd);
+		return NULL;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(ptr == MAP_FAILED){
+		WARN(_("Can't mmap %s"), filename);
+		return NULL;
+	}
+	b = MALLOC(mmapbuf, 1);
+	b->data = ptr;
+	b->len = st.st_size;
+	return b;
+}
+
+/**
+ * Check block: it should be inside of file, its header should be the same as index and
+ * streams (with 8 bytes of padding) should be inside of block
+ * @param dataoff - end of header & columns descriptors
+ * @return 0 if block is broken
+ */
+static int check_block(const mmapbuf *b, const arc_header *h, const arc_index *x, size_t dataoff){
+	const uint32_t *sizes;
+	uint64_t sum = (h->ncols + 3) * sizeof(uint32_t) + 8;
+	uint32_t i;
+	if(x->offset < dataoff || x->offset > b->len || x->size > b->len - x->offset || x->size < sum)
+		return 0;
+	sizes = (const uint32_t*)(b->data + x->offset);
+	if(sizes[0] != x->nrec || !x->nrec || x->nrec > h->blockrecs || sizes[1] != h->ncols
+		|| (uint64_t)x->nrec > (uint64_t)sizes[2] * 8) // time takes at least 1 bit per record
+		return 0;
+	for(i = 0; i <= h->ncols; ++i){
+		if(!sizes[i + 2]) return 0; // method byte at least
+		sum += sizes[i + 2];
+	}
+	return (sum <= x->size);
+}
+
+/**
+ * Open archive (mmap it)
+ * @return archive or NULL if it's wrong
+ */
+arc_file *arc_open(char *filename){
+	mmapbuf *b = arc_mmap(filename);
+	arc_header *h;
+	arc_index *idx;
+	size_t dataoff;
+	uint32_t i, maxrec = 0;
+	if(!b) return NULL;
+	h = (arc_header*)b->data;
+	if(memcmp(h->magic, ARC_MAGIC, 8)){
+		WARNX(_("%s isn't BTA archive"), filename);
+		goto bad;
+	}
+	if(h->version != ARC_VERSION){
+		WARNX(_("%s: archive version %u differs from %u, pack records again"), filename,
+			h->version, ARC_VERSION);
+		goto bad;
+	}
+	dataoff = sizeof(arc_header) + (size_t)h->ncols * sizeof(arc_coldesc);
+	if(h->ncols > ARC_MAXCOLS || dataoff > b->len || h->idxoff < dataoff || h->idxoff > b->len
+		|| (uint64_t)h->nblocks * sizeof(arc_index) > b->len - h->idxoff)
+		goto broken;
+	idx = (arc_index*)(b->data + h->idxoff);
+	for(i = 0; i < h->nblocks; ++i){
+		if(!check_block(b, h, &idx[i], dataoff)){
+			WARNX(_("%s: block %u is broken"), filename, i);
+			goto bad;
+		}
+		if(idx[i].nrec > maxrec) maxrec = idx[i].nrec;
+	}
+	arc_file *f = MALLOC(arc_file, 1);
+	f->buf = b;
+	f->hdr = h;
+	f->cols = (arc_coldesc*)(b->data + sizeof(arc_header));
+	f->idx = idx;
+	f->maxrec = maxrec;
+	return f;
+broken:
+	WARNX(_("%s: archive is broken or wasn't closed"), filename);
+bad:
+	My_munmap(b);
+	return NULL;
+}
+
+void arc_close(arc_file *f){
+	if(!f) return;
+	My_munmap(f->buf);
+	FREE(f);
+}
+
+/**
+ * @return number of column `name` in file or -1
+ */
+int arc_filecol(arc_file *f, const char *name){
+	uint32_t i;
+	for(i = 0; i < f->hdr->ncols; ++i)
+		if(strncmp(f->cols[i].name, name, ARC_NAMELEN) == 0) return (int)i;
+	return -1;
+}
+
+/**
+ * Binary search of block
+ * @return number of first block with tlast >= t (nblocks if there's no such block)
+ */
+uint32_t arc_findblock(arc_file *f, double t){
+	uint32_t l = 0, h = f->hdr->nblocks;
+	while(l < h){
+		uint32_t m = (l + h) / 2;
+		if(f->idx[m].tlast < t) l = m + 1;
+		else h = m;
+	}
+	return l;
+}
+
+/**
+ * Decode time & selected columns of block
+ * @param nblock - number of block
+ * @param cols   - array [ncols] of flags: != 0 to decode column
+ * @param b      - block (allocated here or reused)
+ * @return 0 if failed
+ */
+int arc_decode(arc_file *f, uint32_t nblock, const uint8_t *cols, arc_block *b){
+	uint32_t i, n, ncols;
+	const uint8_t *data;
+	const uint32_t *sizes;
+	if(nblock >= f->hdr->nblocks) return 0;
+	// sizes were checked by arc_open()
+	data = (const uint8_t*)f->buf->data + f->idx[nblock].offset;
+	sizes = (const uint32_t*)data;
+	n = sizes[0];
+	ncols = sizes[1];
+	if(b->capacity < n){
+		free(b->t);
+		for(i = 0; i < ARC_MAXCOLS; ++i){ free(b->col[i]); b->col[i] = NULL; }
+		b->t = MALLOC(double, f->maxrec);
+		b->capacity = f->maxrec;
+	}
+	b->nrec = n;
+	data += (ncols + 3) * sizeof(uint32_t);
+	if(!decode_column(data, sizes[2], n, b->t)) goto bad;
+	data += sizes[2];
+	for(i = 0; i < ncols; ++i){
+		if(cols && cols[i]){
+			if(!b->col[i]) b->col[i] = MALLOC(double, b->capacity);
+			if(!decode_column(data, sizes[i + 3], n, b->col[i])) goto bad;
+		}
+		data += sizes[i + 3];
+	}
+	return 1;
+bad:
+	WARNX(_("Wrong block %u"), nblock);
+	return 0;
+}
+
+void arc_block_free(arc_block *b){
+	int i;
+	free(b->t);
+	for(i = 0; i < ARC_MAXCOLS; ++i) free(b->col[i]);
+	memset(b, 0, sizeof(arc_block));
+}
@@ -0,0 +1,131 @@
+/*
+ * archive.h - compressed archive of BTA telemetry
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __ARCHIVE_H__
+#define __ARCHIVE_H__
+
+#include <stdint.h>
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+
+/*
+ * Archive file layout:
+ *   [arc_header][arc_coldesc * ncols]
+ *   [block 0] ... [block nblocks-1]
+ *   [arc_index * nblocks]
+ * Block: uint32_t nrec, uint32_t ncols, uint32_t size[ncols+1], then streams of time
+ * column & of all other columns. Each stream starts with byte of its encoding method.
+ * Time is UNIX time (UTC) of M_time.
+ */
+#define ARC_MAGIC       "BTAARC01"
+// 2: Tel_State column holds tel_state (was tel_mode), Tel_Mode added
+#define ARC_VERSION     (2)
+#define ARC_SUFFIX      ".btz"
+#define ARC_NAMELEN     (24)
+#define ARC_MAXCOLS     (128)
+// default amount of records in block (6 minutes of 10Hz data)
+#define ARC_DEFBLOCK    (3600)
+
+// column types
+typedef enum{
+	 COL_DOUBLE = 0     // floating point values
+	,COL_STATE          // integer state words
+} col_type;
+
+// stream encoding methods
+enum{
+	 ENC_XOR = 0        // XOR with previous value (doubles)
+	,ENC_DOD            // delta of delta (doubles as integers)
+	,ENC_RLE            // run-length (state words)
+};
+
+// column of BTA data
+typedef struct{
+	const char *name;   // name (the same as in bta_print)
+	col_type type;
+	int local;          // ==1 if field is in struct BTA_Local
+	size_t offset;      // offset in structure
+} arc_column;
+
+#pragma pack(push, 4)
+typedef struct{
+	char magic[8];      // ARC_MAGIC
+	uint32_t version;   // ARC_VERSION
+	uint32_t ncols;     // amount of columns (without time)
+	uint32_t blockrecs; // max amount of records in block
+	uint32_t nblocks;   // amount of blocks
+	uint64_t idxoff;    // offset of blocks index
+	uint64_t nrec;      // total amount of records
+	double tfirst;      // time of first record
+	double tlast;       // time of last record
+} arc_header;
+
+typedef struct{
+	char name[ARC_NAMELEN];
+	uint32_t type;      // col_type
+	uint32_t reserved;
+} arc_coldesc;
+
+typedef struct{
+	double tfirst;      // time of first record in block
+	double tlast;       // time of last record in block
+	uint64_t offset;    // offset of block in file
+	uint32_t size;      // size of block
+	uint32_t nrec;      // amount of records in block
+} arc_index;
+#pragma pack(pop)
+
+// archive opened for reading
+typedef struct{
+	mmapbuf *buf;
+	arc_header *hdr;
+	arc_coldesc *cols;
+	arc_index *idx;
+	uint32_t maxrec;    // max amount of records in block
+} arc_file;
+
+// decoded (part of) block
+typedef struct{
+	uint32_t nrec;
+	uint32_t capacity;
+	double *t;                  // time
+	double *col[ARC_MAXCOLS];   // columns by number in file (NULL if not decoded)
+} arc_block;
+
+typedef struct arc_writer arc_writer;
+
+extern const arc_column arc_columns[];
+int arc_colidx(const char *name);
+int arc_str2time(char *str, double *t);
+char *arc_time2str(double t, char *buf);
+
+arc_writer *arc_create(char *filename, int blockrecs);
+int arc_add(arc_writer *w, double t, struct BTA_Data *data, struct BTA_Local *local);
+int arc_finish(arc_writer *w, uint64_t *rawsize);
+
+arc_file *arc_open(char *filename);
+void arc_close(arc_file *f);
+int arc_filecol(arc_file *f, const char *name);
+uint32_t arc_findblock(arc_file *f, double t);
+int arc_decode(arc_file *f, uint32_t nblock, const uint8_t *cols, arc_block *b);
+void arc_block_free(arc_block *b);
+
+#endif // __ARCHIVE_H__
@@ -0,0 +1,90 @@
+/*
+ * cmdlnopts.c - the only function that parce cmdln args and returns glob parameters
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include "cmdlnopts.h"
+#include "usefull_macros.h"
+#include "cmdlnopts.h"
+#include "usefull_macros.h"
+#include "archive.h"
+#include <assert.h>
+
+/*
+ * here are global parameters initialisation
+ */
+glob_pars G;  // internal global parameters structure
+int help = 0; // whether to show help string
+
+glob_pars Gdefault = {
+	 .outfile        = NULL
+	,.blockrecs      = ARC_DEFBLOCK
+	,.infile         = NULL
+	,.from           = NULL
+	,.to             = NULL
+	,.columns        = NULL
+	,.listcols       = 0
+	,.where          = NULL
+	,.aggregate      = 0
+	,.interval       = 0.
+	,.nthreads       = 0
+	,.ninput         = 0
+	,.input          = NULL
+};
+
+/*
+ * Define command line options by filling structure:
+ *	name	has_arg	flag	val		type		argptr			help
+*/
+myoption cmdlnopts[] = {
+	{"help",	0,	NULL,	'h',	arg_int,	APTR(&help),		N_("show this help")},
+	{"output",	1,	NULL,	'o',	arg_string,	APTR(&G.outfile),	N_("pack given record files into archive")},
+	{"block",	1,	NULL,	'b',	arg_int,	APTR(&G.blockrecs),	N_("amount of records in archive block")},
+	{"read",	1,	NULL,	'r',	arg_string,	APTR(&G.infile),	N_("read archive (without -c show its summary)")},
+	{"from",	1,	NULL,	'f',	arg_string,	APTR(&G.from),		N_("start of time interval (\"YYYY-MM-DD HH:MM:SS\" UTC or UNIX time)")},
+	{"to",		1,	NULL,	't',	arg_string,	APTR(&G.to),		N_("end of time interval")},
+	{"columns",	1,	NULL,	'c',	arg_string,	APTR(&G.columns),	N_("columns to show (comma-separated)")},
+	{"list",	0,	NULL,	'l',	arg_int,	APTR(&G.listcols),	N_("list columns available")},
+	{"where",	1,	NULL,	'w',	arg_string,	APTR(&G.where),		N_("query filters (e.g. \"|DiffAzim|>5'' && Sys_Mode==SysTrkOk\")")},
+	{"aggregate",0,	NULL,	'a',	arg_int,	APTR(&G.aggregate),	N_("show min/max/mean of columns instead of values")},
+	{"interval",1,	NULL,	'i',	arg_double,	APTR(&G.interval),	N_("aggregation interval, seconds (default: whole time range)")},
+	{"threads",	1,	NULL,	'j',	arg_int,	APTR(&G.nthreads),	N_("amount of query threads (default: amount of CPUs)")},
+	end_option
+};
+
+
+/**
+ * Parce command line options and return dynamically allocated structure
+ * 		to global parameters
+ * @param argc - copy of argc from main
+ * @param argv - copy of argv from main
+ * @return allocated structure with global parameters
+ */
+glob_pars *parce_args(int argc, char **argv){
+	void *ptr;
+	ptr = memcpy(&G, &Gdefault, sizeof(G)); assert(ptr);
+	// format of help: "Usage: progname [args]\n"
+	change_helpstring("Usage: %s [args] [record files to pack or archives to query]\n\n\tWhere args are:\n");
+	// parse arguments
+	parceargs(&argc, &argv, cmdlnopts);
+	if(help) showhelp(-1, cmdlnopts);
+	// the rest of arguments are record files
+	G.ninput = argc;
+	G.input = argv;
+	return &G;
+}
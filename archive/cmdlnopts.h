@@ -0,0 +1,51 @@
+/*
+ * cmdlnopts.h - comand line options for parceargs
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __CMDLNOPTS_H__
+#define __CMDLNOPTS_H__
+
+#include "parceargs.h"
+
+/*
+ * here are some typedef's for global data
+ */
+
+typedef struct{
+	char *outfile;  // archive to create
+	int blockrecs;  // records in block
+	char *infile;   // archive to read
+	char *from;     // start of time interval
+	char *to;       // end of time interval
+	char *columns;  // columns to show
+	int listcols;   // list columns
+	char *where;    // filters for query
+	int aggregate;  // show aggregates instead of values
+	double interval;// aggregation interval
+	int nthreads;   // amount of query threads
+	int ninput;     // amount of input files
+	char **input;   // input files (records or archives to query)
+}glob_pars;
+
+glob_pars *parce_args(int argc, char **argv);
+extern glob_pars *GP;
+
+#endif // __CMDLNOPTS_H__
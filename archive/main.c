@@ -0,0 +1,230 @@
+/*
+ * main.c - packing of recorded BTA data into compressed archive & reading it
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <assert.h>
+#include <signal.h>
+#include <math.h>
+#include <time.h>
+
+#include "usefull_macros.h"
+#include "cmdlnopts.h"
+#include "recorder.h"
+#include "archive.h"
+#include "query.h"
+
+glob_pars *GP = NULL;
+
+void signals(int sig){
+	if(sig)
+		WARNX(_("Get signal %d, quit.\n"), sig);
+	else
+		sig = -1;
+	exit(sig);
+}
+
+static char *time2str(double t){
+	static char buf[32];
+	return arc_time2str(t, buf);
+}
+
+static int cmpseg(const void *a, const void *b){
+	rec_segment *s1 = *(rec_segment**)a, *s2 = *(rec_segment**)b;
+	if(s1->hdr->tstart < s2->hdr->tstart) return -1;
+	if(s1->hdr->tstart > s2->hdr->tstart) return 1;
+	return 0;
+}
+
+/**
+ * Pack record files into archive
+ * @return 0 if all OK
+ */
+static int pack(){
+	rec_segment **segs = MALLOC(rec_segment*, GP->ninput);
+	int i, nsegs = 0;
+	uint32_t j;
+	uint64_t nrec = 0, size = 0, rawsize = 0;
+	double t0 = dtime();
+	arc_writer *w;
+	for(i = 0; i < GP->ninput; ++i){
+		rec_segment *s = rec_open(GP->input[i]);
+		if(s) segs[nsegs++] = s;
+	}
+	if(!nsegs){
+		WARNX(_("No record files given"));
+		return 1;
+	}
+	qsort(segs, nsegs, sizeof(rec_segment*), cmpseg);
+	if(!(w = arc_create(GP->outfile, GP->blockrecs))) return 1;
+	for(i = 0; i < nsegs; ++i){
+		rec_segment *s = segs[i];
+		if(!s->count) continue;
+		// index of record file is M_time continued through midnight: find day of first record
+		double day0 = floor(s->hdr->tstart / 86400.) * 86400.;
+		double t = day0 + s->idx[0];
+		if(t < s->hdr->tstart - 43200.) day0 += 86400.;
+		else if(t > s->hdr->tstart + 43200.) day0 -= 86400.;
+		for(j = 0; j < s->count; ++j){
+			bta_record *r = &s->rec[j];
+			if(!arc_add(w, day0 + s->idx[j], &r->data, &r->local)){
+				arc_finish(w, NULL);
+				return 1;
+			}
+		}
+		nrec += s->count;
+		rawsize += (uint64_t)s->count * sizeof(bta_record);
+		rec_close(s);
+	}
+	FREE(segs);
+	if(!arc_finish(w, &size)) return 1;
+	printf(_("Packed %llu records (%llu bytes) into %llu bytes (ratio %.1f) for %.2fs\n"),
+		(unsigned long long)nrec, (unsigned long long)rawsize, (unsigned long long)size,
+		size ? (double)rawsize / size : 0., dtime() - t0);
+	return 0;
+}
+
+/**
+ * Show archive summary
+ */
+static void summary(arc_file *f){
+	uint32_t i, j;
+	uint64_t *colsz = MALLOC(uint64_t, f->hdr->ncols + 1);
+	for(i = 0; i < f->hdr->nblocks; ++i){
+		const uint32_t *sizes = (const uint32_t*)(f->buf->data + f->idx[i].offset);
+		for(j = 0; j <= f->hdr->ncols; ++j) colsz[j] += sizes[j + 2];
+	}
+	printf(_("Records: %llu in %u blocks\n"), (unsigned long long)f->hdr->nrec, f->hdr->nblocks);
+	printf(_("Time from %s"), time2str(f->hdr->tfirst));
+	printf(_(" to %s\n"), time2str(f->hdr->tlast));
+	printf(_("Size: %zd, raw records: %llu (ratio %.1f)\n"), f->buf->len,
+		(unsigned long long)(f->hdr->nrec * sizeof(bta_record)),
+		(double)(f->hdr->nrec * sizeof(bta_record)) / f->buf->len);
+	if(!f->hdr->nrec) goto ret;
+	printf(_("Bytes per record by column:\n\t%-16s %.2f\n"), "Time", (double)colsz[0] / f->hdr->nrec);
+	for(j = 0; j < f->hdr->ncols; ++j)
+		printf("\t%-16s %.2f\n", f->cols[j].name, (double)colsz[j + 1] / f->hdr->nrec);
+ret:
+	FREE(colsz);
+}
+
+/**
+ * Read archive: show summary or columns in given time interval
+ * @return 0 if all OK
+ */
+static int readarc(){
+	arc_file *f = arc_open(GP->infile);
+	arc_block blk = {0};
+	int ret = 0, ncols = 0, list[ARC_MAXCOLS];
+	uint8_t mask[ARC_MAXCOLS] = {0};
+	double from = -INFINITY, to = INFINITY, t0;
+	uint32_t nb, i, j;
+	uint64_t nrec = 0;
+	char *tok, *saveptr = NULL;
+	if(!f) return 1;
+	if(!GP->columns){
+		summary(f);
+		goto ret;
+	}
+	if((GP->from && !arc_str2time(GP->from, &from)) || (GP->to && !arc_str2time(GP->to, &to))){
+		WARNX(_("Wrong time format"));
+		ret = 1;
+		goto ret;
+	}
+	for(tok = strtok_r(GP->columns, ",; ", &saveptr); tok; tok = strtok_r(NULL, ",; ", &saveptr)){
+		int c = arc_filecol(f, tok);
+		if(c < 0){
+			WARNX(_("No column %s in archive"), tok);
+			continue;
+		}
+		if(ncols < ARC_MAXCOLS){
+			list[ncols++] = c;
+			mask[c] = 1;
+		}
+	}
+	printf("# Time");
+	for(j = 0; j < (uint32_t)ncols; ++j) printf("\t%s", f->cols[list[j]].name);
+	printf("\n");
+	t0 = dtime();
+	for(nb = arc_findblock(f, from); nb < f->hdr->nblocks && f->idx[nb].tfirst <= to; ++nb){
+		if(!arc_decode(f, nb, mask, &blk)){
+			ret = 1;
+			break;
+		}
+		for(i = 0; i < blk.nrec; ++i){
+			if(blk.t[i] < from) continue;
+			if(blk.t[i] > to) break;
+			printf("%s", time2str(blk.t[i]));
+			for(j = 0; j < (uint32_t)ncols; ++j) printf("\t%.15g", blk.col[list[j]][i]);
+			printf("\n");
+			++nrec;
+		}
+	}
+	DBG("%llu records for %.3fs", (unsigned long long)nrec, dtime() - t0);
+ret:
+	arc_block_free(&blk);
+	arc_close(f);
+	return ret;
+}
+
+int main(int argc, char **argv){
+	int i;
+	initial_setup();
+	GP = parce_args(argc, argv);
+	assert(GP);
+	signal(SIGTERM, signals);
+	signal(SIGHUP, signals);
+	signal(SIGINT, signals);
+	signal(SIGQUIT, signals);
+	if(GP->listcols){
+		for(i = 0; arc_columns[i].name; ++i)
+			printf("%s\t%s\n", arc_columns[i].name,
+				(arc_columns[i].type == COL_STATE) ? "state" : "double");
+		return 0;
+	}
+	if(GP->outfile) return pack();
+	if(GP->interval > 0. && !GP->aggregate){
+		WARNX(_("Aggregation interval (-i) needs -a"));
+		return 1;
+	}
+	if(GP->infile){
+		if(!GP->where && !GP->aggregate) return readarc();
+		// filters or aggregation: query over this archive
+		GP->input = &GP->infile;
+		GP->ninput = 1;
+	}
+	if(GP->ninput){
+		query q;
+		memset(&q, 0, sizeof(q));
+		q.files = GP->input;
+		q.nfiles = GP->ninput;
+		q.from = -INFINITY;
+		q.to = INFINITY;
+		if((GP->from && !arc_str2time(GP->from, &q.from)) || (GP->to && !arc_str2time(GP->to, &q.to)))
+			ERRX(_("Wrong time format"));
+		if(GP->where && !query_filters(&q, GP->where)) return 1;
+		if(GP->columns && !query_columns(&q, GP->columns)) return 1;
+		if(!q.ncols && !q.nfilters) ERRX(_("Give columns (-c) or filters (-w) for query"));
+		q.aggregate = GP->aggregate;
+		q.interval = GP->interval;
+		q.nthreads = GP->nthreads;
+		return run_query(&q);
+	}
+	WARNX(_("Nothing to do: use -o, -r or give archives to query"));
+	return 1;
+}
@@ -0,0 +1,405 @@
+/*
+ * query.c - parallel queries over archives of BTA telemetry
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <pthread.h>
+#include <math.h>
+#include <ctype.h>
+
+#include "query.h"
+
+/*
+ * All blocks of all archives in time interval are work items; threads take them
+ * one by one, decode only needed columns, filter records & collect values or
+ * aggregates. Main thread prints results in order of items (i.e. by time).
+ */
+
+// symbolic values for filters
+typedef struct{
+	const char *name;
+	int val;
+} qconst;
+
+#define C(x)    {#x, x}
+static const qconst constants[] = {
+	C(SysStop), C(SysWait), C(SysPointAZ), C(SysPointAD), C(SysTrkStop), C(SysTrkStart),
+	C(SysTrkMove), C(SysTrkSeek), C(SysTrkOk), C(SysTrkCorr), C(SysTest),
+	C(TagPosition), C(TagObject), C(TagNest), C(TagZenith), C(TagHorizon), C(TagStatObj),
+	C(Prime), C(Nasmyth1), C(Nasmyth2),
+	C(Stopping), C(Pointing), C(Tracking),
+	C(Hard_Off), C(Hard_On),
+	C(Automatic), C(Manual),
+	C(Rev_Off), C(Rev_On),
+	C(P2_Off), C(P2_On), C(P2_Plus), C(P2_Minus),
+	C(Foc_Hminus), C(Foc_Lminus), C(Foc_Off), C(Foc_Lplus), C(Foc_Hplus),
+	C(PC_Off), C(PC_On),
+	{NULL, 0}
+};
+#undef C
+
+static const char *opnames[] = {"<", "<=", ">", ">=", "==", "!="};
+
+static char *skipspaces(char *s){
+	while(*s && isspace(*s)) ++s;
+	return s;
+}
+
+/**
+ * Parse filters "[|]name[|] op value" separated by "&&" or ','
+ * value is number (possibly with '' after it) or symbolic constant (SysTrkOk etc)
+ * @return 0 if failed
+ */
+int query_filters(query *q, char *str){
+	char *s = str;
+	while(*(s = skipspaces(s))){
+		qfilter *f;
+		char name[ARC_NAMELEN], *e;
+		int l = 0, i;
+		if(q->nfilters == QUERY_MAXFILTERS){
+			WARNX(_("Too much filters"));
+			return 0;
+		}
+		f = &q->filters[q->nfilters];
+		memset(f, 0, sizeof(qfilter));
+		if(*s == '|'){ f->absval = 1; ++s; }
+		while((isalnum(*s) || *s == '_') && l < ARC_NAMELEN - 1) name[l++] = *s++;
+		name[l] = 0;
+		if(f->absval){
+			if(*s != '|') goto bad;
+			++s;
+		}
+		if((f->col = arc_colidx(name)) < 0){
+			WARNX(_("Unknown column %s"), name);
+			return 0;
+		}
+		s = skipspaces(s);
+		for(i = OP_NE; i >= 0; --i) // two-symbol operations first
+			if(strncmp(s, opnames[i], strlen(opnames[i])) == 0) break;
+		if(i < 0){
+			if(*s != '=') goto bad;
+			i = OP_EQ;
+			++s;
+		}else s += strlen(opnames[i]);
+		f->op = (filter_op)i;
+		s = skipspaces(s);
+		f->val = strtod(s, &e);
+		if(e == s){ // symbolic value
+			const qconst *c;
+			for(l = 0; (isalnum(s[l]) || s[l] == '_'); ++l);
+			for(c = constants; c->name; ++c)
+				if((int)strlen(c->name) == l && strncmp(c->name, s, l) == 0) break;
+			if(!c->name) goto bad;
+			f->val = c->val;
+			e = s + l;
+		}
+		s = skipspaces(e);
+		if(strncmp(s, "''", 2) == 0) s = skipspaces(s + 2);
+		++q->nfilters;
+		if(!*s) break;
+		if(strncmp(s, "&&", 2) == 0) s += 2;
+		else if(*s == ',') ++s;
+		else goto bad;
+	}
+	return 1;
+bad:
+	WARNX(_("Wrong filter: %s"), str);
+	return 0;
+}
+
+/**
+ * Parse comma-separated list of columns
+ * @return 0 if failed
+ */
+int query_columns(query *q, char *str){
+	char *tok, *saveptr = NULL;
+	for(tok = strtok_r(str, ",; ", &saveptr); tok; tok = strtok_r(NULL, ",; ", &saveptr)){
+		int c = arc_colidx(tok);
+		if(c < 0){
+			WARNX(_("Unknown column %s"), tok);
+			return 0;
+		}
+		if(q->ncols == ARC_MAXCOLS) break;
+		q->cols[q->ncols++] = c;
+	}
+	return 1;
+}
+
+// work item: one block of archive
+typedef struct{
+	int file;
+	uint32_t block;
+	volatile int done;
+	uint64_t scanned;       // records in interval
+	uint64_t nrows;         // matched records
+	// values: (time, columns) for each matched record
+	double *rows;
+	uint64_t rowsalloc;
+	// aggregates: bin number, amount, time of first record, then min/max/sum for each column
+	double *bins;
+	uint32_t nbins, binsalloc;
+} qitem;
+
+static struct{
+	query *q;
+	arc_file **arcs;
+	int (*colmap)[ARC_MAXCOLS];     // arc_columns index -> file column index (or -1)
+	uint8_t (*masks)[ARC_MAXCOLS];  // columns to decode
+	qitem *items;
+	uint32_t nitems;
+	uint32_t next;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} Q;
+
+// size of bin: number, count, tfirst + min/max/sum
+#define BINSIZE(q)  (3 + 3*(q)->ncols)
+
+static inline int check_filter(qfilter *f, double v){
+	if(f->absval) v = fabs(v);
+	switch(f->op){
+		case OP_LT: return v < f->val;
+		case OP_LE: return v <= f->val;
+		case OP_GT: return v > f->val;
+		case OP_GE: return v >= f->val;
+		case OP_EQ: return v == f->val;
+		default:    return v != f->val;
+	}
+}
+
+static double *newbin(qitem *it, query *q, double bin, double t){
+	uint32_t bs = BINSIZE(q);
+	int j;
+	if(it->nbins == it->binsalloc){
+		it->binsalloc = it->binsalloc ? it->binsalloc * 2 : 16;
+		it->bins = realloc(it->bins, it->binsalloc * bs * sizeof(double));
+		if(!it->bins) ERR("realloc");
+	}
+	double *b = &it->bins[it->nbins++ * bs];
+	b[0] = bin; b[1] = 0.; b[2] = t;
+	for(j = 0; j < q->ncols; ++j){
+		b[3 + 3*j] = INFINITY;
+		b[4 + 3*j] = -INFINITY;
+		b[5 + 3*j] = 0.;
+	}
+	return b;
+}
+
+static void process_item(qitem *it, arc_block *blk){
+	query *q = Q.q;
+	int *map = Q.colmap[it->file], j, k;
+	uint32_t i;
+	double *bin = NULL;
+	if(!arc_decode(Q.arcs[it->file], it->block, Q.masks[it->file], blk)) return;
+	for(i = 0; i < blk->nrec; ++i){
+		double t = blk->t[i];
+		if(t < q->from) continue;
+		if(t > q->to) break;
+		++it->scanned;
+		for(k = 0; k < q->nfilters; ++k){
+			int c = map[q->filters[k].col];
+			if(c < 0 || !check_filter(&q->filters[k], blk->col[c][i])) break;
+		}
+		if(k < q->nfilters) continue;
+		++it->nrows;
+		if(q->aggregate){
+			double nb = (q->interval > 0.) ? floor(t / q->interval) : 0.;
+			if(!bin || bin[0] != nb) bin = newbin(it, q, nb, t);
+			bin[1] += 1.;
+			for(j = 0; j < q->ncols; ++j){
+				int c = map[q->cols[j]];
+				if(c < 0) continue;
+				double v = blk->col[c][i];
+				if(v < bin[3 + 3*j]) bin[3 + 3*j] = v;
+				if(v > bin[4 + 3*j]) bin[4 + 3*j] = v;
+				bin[5 + 3*j] += v;
+			}
+			continue;
+		}
+		if(it->nrows > it->rowsalloc){
+			it->rowsalloc = it->rowsalloc ? it->rowsalloc * 2 : 256;
+			it->rows = realloc(it->rows, it->rowsalloc * (1 + q->ncols) * sizeof(double));
+			if(!it->rows) ERR("realloc");
+		}
+		double *r = &it->rows[(it->nrows - 1) * (1 + q->ncols)];
+		r[0] = t;
+		for(j = 0; j < q->ncols; ++j){
+			int c = map[q->cols[j]];
+			r[j + 1] = (c < 0) ? NAN : blk->col[c][i];
+		}
+	}
+}
+
+static void *worker(_U_ void *arg){
+	arc_block blk = {0};
+	while(1){
+		uint32_t k = __sync_fetch_and_add(&Q.next, 1);
+		if(k >= Q.nitems) break;
+		process_item(&Q.items[k], &blk);
+		pthread_mutex_lock(&Q.mutex);
+		Q.items[k].done = 1;
+		pthread_cond_broadcast(&Q.cond);
+		pthread_mutex_unlock(&Q.mutex);
+	}
+	arc_block_free(&blk);
+	return NULL;
+}
+
+static void print_bin(query *q, double *b){
+	char buf[32];
+	int j;
+	double t = (q->interval > 0.) ? b[0] * q->interval : b[2];
+	printf("%s\t%.0f", arc_time2str(t, buf), b[1]);
+	for(j = 0; j < q->ncols; ++j){
+		if(b[4 + 3*j] < b[3 + 3*j]) printf("\tnan\tnan\tnan");
+		else printf("\t%.15g\t%.15g\t%.15g", b[3 + 3*j], b[4 + 3*j], b[5 + 3*j] / b[1]);
+	}
+	printf("\n");
+}
+
+// merge bin `b` into `acc`
+static void merge_bin(query *q, double *acc, double *b){
+	int j;
+	acc[1] += b[1];
+	for(j = 0; j < q->ncols; ++j){
+		if(b[3 + 3*j] < acc[3 + 3*j]) acc[3 + 3*j] = b[3 + 3*j];
+		if(b[4 + 3*j] > acc[4 + 3*j]) acc[4 + 3*j] = b[4 + 3*j];
+		acc[5 + 3*j] += b[5 + 3*j];
+	}
+}
+
+static int cmparc(const void *a, const void *b){
+	arc_file *f1 = *(arc_file**)a, *f2 = *(arc_file**)b;
+	if(f1->hdr->tfirst < f2->hdr->tfirst) return -1;
+	if(f1->hdr->tfirst > f2->hdr->tfirst) return 1;
+	return 0;
+}
+
+/**
+ * Run query & print results
+ * @return 0 if all OK
+ */
+int run_query(query *q){
+	int i, j, nf = 0, nthreads = q->nthreads;
+	uint32_t k, alloc = 0;
+	uint64_t scanned = 0, matched = 0;
+	pthread_t *threads;
+	double t0 = dtime(), *acc = NULL;
+	char buf[32];
+	if(!q->ncols){ // show columns of filters
+		for(i = 0; i < q->nfilters && q->ncols < ARC_MAXCOLS; ++i){
+			for(j = 0; j < q->ncols; ++j) if(q->cols[j] == q->filters[i].col) break;
+			if(j == q->ncols) q->cols[q->ncols++] = q->filters[i].col;
+		}
+	}
+	memset(&Q, 0, sizeof(Q));
+	Q.q = q;
+	Q.arcs = MALLOC(arc_file*, q->nfiles);
+	for(i = 0; i < q->nfiles; ++i){
+		arc_file *f = arc_open(q->files[i]);
+		if(f) Q.arcs[nf++] = f;
+	}
+	qsort(Q.arcs, nf, sizeof(arc_file*), cmparc);
+	Q.colmap = calloc(nf ? nf : 1, sizeof(*Q.colmap));
+	Q.masks = calloc(nf ? nf : 1, sizeof(*Q.masks));
+	for(i = 0; i < nf; ++i){
+		arc_file *f = Q.arcs[i];
+		for(j = 0; arc_columns[j].name && j < ARC_MAXCOLS; ++j){
+			int c = arc_filecol(f, arc_columns[j].name);
+			Q.colmap[i][j] = c;
+		}
+		for(j = 0; j < q->nfilters; ++j){
+			int c = Q.colmap[i][q->filters[j].col];
+			if(c >= 0) Q.masks[i][c] = 1;
+		}
+		for(j = 0; j < q->ncols; ++j){
+			int c = Q.colmap[i][q->cols[j]];
+			if(c >= 0) Q.masks[i][c] = 1;
+		}
+		// binary search of blocks in time interval
+		if(f->hdr->tlast < q->from || f->hdr->tfirst > q->to) continue;
+		for(k = arc_findblock(f, q->from); k < f->hdr->nblocks && f->idx[k].tfirst <= q->to; ++k){
+			if(Q.nitems == alloc){
+				alloc = alloc ? alloc * 2 : 256;
+				Q.items = realloc(Q.items, alloc * sizeof(qitem));
+				if(!Q.items) ERR("realloc");
+			}
+			memset(&Q.items[Q.nitems], 0, sizeof(qitem));
+			Q.items[Q.nitems].file = i;
+			Q.items[Q.nitems++].block = k;
+		}
+	}
+	if(nthreads < 1) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(nthreads < 1) nthreads = 1;
+	if((uint32_t)nthreads > Q.nitems) nthreads = Q.nitems ? (int)Q.nitems : 1;
+	pthread_mutex_init(&Q.mutex, NULL);
+	pthread_cond_init(&Q.cond, NULL);
+	threads = MALLOC(pthread_t, nthreads);
+	for(i = 0; i < nthreads; ++i)
+		if(pthread_create(&threads[i], NULL, worker, NULL)) ERR(_("Can't create thread"));
+	// header
+	printf("# Time");
+	if(q->aggregate) printf("\tN");
+	for(j = 0; j < q->ncols; ++j){
+		const char *n = arc_columns[q->cols[j]].name;
+		if(q->aggregate) printf("\t%s_min\t%s_max\t%s_mean", n, n, n);
+		else printf("\t%s", n);
+	}
+	printf("\n");
+	if(q->aggregate) acc = MALLOC(double, BINSIZE(q));
+	int haveacc = 0;
+	// results in order of items
+	for(k = 0; k < Q.nitems; ++k){
+		qitem *it = &Q.items[k];
+		uint64_t r;
+		pthread_mutex_lock(&Q.mutex);
+		while(!it->done) pthread_cond_wait(&Q.cond, &Q.mutex);
+		pthread_mutex_unlock(&Q.mutex);
+		scanned += it->scanned;
+		matched += it->nrows;
+		for(r = 0; r < it->nrows && !q->aggregate; ++r){
+			double *row = &it->rows[r * (1 + q->ncols)];
+			printf("%s", arc_time2str(row[0], buf));
+			for(j = 0; j < q->ncols; ++j) printf("\t%.15g", row[j + 1]);
+			printf("\n");
+		}
+		for(r = 0; r < it->nbins; ++r){
+			double *b = &it->bins[r * BINSIZE(q)];
+			if(haveacc && acc[0] == b[0]) merge_bin(q, acc, b);
+			else{
+				if(haveacc) print_bin(q, acc);
+				memcpy(acc, b, BINSIZE(q) * sizeof(double));
+				haveacc = 1;
+			}
+		}
+		free(it->rows);
+		free(it->bins);
+	}
+	if(haveacc) print_bin(q, acc);
+	for(i = 0; i < nthreads; ++i) pthread_join(threads[i], NULL);
+	printf("# %llu of %llu records matched, %u blocks, %d threads, %.3fs\n",
+		(unsigned long long)matched, (unsigned long long)scanned, Q.nitems, nthreads, dtime() - t0);
+	FREE(acc);
+	FREE(threads);
+	free(Q.items);
+	free(Q.colmap);
+	free(Q.masks);
+	for(i = 0; i < nf; ++i) arc_close(Q.arcs[i]);
+	FREE(Q.arcs);
+	return 0;
+}
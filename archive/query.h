@@ -0,0 +1,65 @@
+/*
+ * query.h - parallel queries over archives of BTA telemetry
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __QUERY_H__
+#define __QUERY_H__
+
+#include "archive.h"
+
+#define QUERY_MAXFILTERS    (16)
+
+// comparison operations
+typedef enum{
+	 OP_LT = 0
+	,OP_LE
+	,OP_GT
+	,OP_GE
+	,OP_EQ
+	,OP_NE
+} filter_op;
+
+// filter "[|]name[|] op value"
+typedef struct{
+	int col;            // index in arc_columns
+	filter_op op;
+	double val;
+	int absval;         // ==1 to compare absolute value
+} qfilter;
+
+typedef struct{
+	char **files;       // archives
+	int nfiles;
+	double from;        // time interval
+	double to;
+	qfilter filters[QUERY_MAXFILTERS];
+	int nfilters;
+	int cols[ARC_MAXCOLS]; // columns to show (indexes in arc_columns)
+	int ncols;
+	int aggregate;      // ==1 to show min/max/mean instead of values
+	double interval;    // aggregation interval (seconds), 0 - whole time range
+	int nthreads;       // amount of threads (0 - by CPU number)
+} query;
+
+int query_filters(query *q, char *str);
+int query_columns(query *q, char *str);
+int run_query(query *q);
+
+#endif // __QUERY_H__
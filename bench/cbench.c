@@ -0,0 +1,125 @@
+/*
+ * cbench.c - benchmark of batch coordinates conversion (calc_*_n) against per-call
+ *            functions calc_AZ, calc_AD & calc_PA
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "coords.h"
+#include "parceargs.h"
+#include "timers.h"
+#include "usefull_macros.h"
+
+// max error of batch functions allowed (arcseconds)
+#define CB_MAXERR   (0.01)
+
+static int npoints = 1000000, nrepeat = 5, help = 0;
+
+static myoption cmdlnopts[] = {
+	{"help",	0,	NULL,	'h',	arg_int,	APTR(&help),		N_("show this help")},
+	{"points",	1,	NULL,	'n',	arg_int,	APTR(&npoints),		N_("amount of points")},
+	{"repeat",	1,	NULL,	'r',	arg_int,	APTR(&nrepeat),		N_("amount of runs (the best one is shown)")},
+	end_option
+};
+
+void signals(int sig){
+	exit(sig);
+}
+
+// data: structure of arrays
+static double *A, *D, *S, *O1, *O2, *R1, *R2;
+
+// difference of angles in arcseconds (modulo `period`)
+static double angdiff(double a, double b, double period){
+	double d = fmod(fabs(a - b), period);
+	return (d > period / 2.) ? period - d : d;
+}
+
+static void scalar_AZ(int n){ for(int i = 0; i < n; ++i) calc_AZ(A[i], D[i], S[i], &R1[i], &R2[i]); }
+static void batch_AZ(int n){ calc_AZ_n((size_t)n, A, D, S, O1, O2); }
+static void scalar_PA(int n){ for(int i = 0; i < n; ++i) R1[i] = calc_PA(A[i], D[i], S[i]); }
+static void batch_PA(int n){ calc_PA_n((size_t)n, A, D, S, O1); }
+// for calc_AD A & D are azimuth & zenith distance
+static void scalar_AD(int n){ for(int i = 0; i < n; ++i) calc_AD(A[i], D[i], S[i], &R1[i], &R2[i]); }
+static void batch_AD(int n){ calc_AD_n((size_t)n, A, D, S, O1, O2); }
+
+// best time of `nrepeat` runs (seconds)
+static double run(void (*fn)(int), int n){
+	double best = INFINITY, t;
+	for(int r = 0; r < nrepeat; ++r){
+		t = mtime();
+		fn(n);
+		t = mtime() - t;
+		if(t < best) best = t;
+	}
+	return best;
+}
+
+/**
+ * compare scalar & batch versions
+ * @param per1, per2 - period of 1st & 2nd output (0 - no second output)
+ * @param scale1 - scale of 1st output to arcseconds
+ * @return max error in arcseconds
+ */
+static double compare(const char *name, void (*sfn)(int), void (*bfn)(int),
+		double per1, double scale1, double per2){
+	double ts = run(sfn, npoints), tb = run(bfn, npoints), err = 0., e;
+	for(int i = 0; i < npoints; ++i){
+		if((e = angdiff(R1[i], O1[i], per1) * scale1) > err) err = e;
+		if(per2 > 0. && (e = angdiff(R2[i], O2[i], per2)) > err) err = e;
+	}
+	printf("%-8s %12.2f %12.2f %9.1fx %14.3g\n", name, ts / npoints * 1e9, tb / npoints * 1e9,
+		ts / tb, err);
+	return err;
+}
+
+int main(int argc, char **argv){
+	double err = 0., e;
+	int i;
+	initial_setup();
+	change_helpstring("Usage: %s [args]\n\n\tWhere args are:\n");
+	parceargs(&argc, &argv, cmdlnopts);
+	if(help) showhelp(-1, cmdlnopts);
+	if(npoints < 1 || nrepeat < 1) ERRX(_("Amount of points & runs should be positive"));
+	A = MALLOC(double, npoints); D = MALLOC(double, npoints); S = MALLOC(double, npoints);
+	O1 = MALLOC(double, npoints); O2 = MALLOC(double, npoints);
+	R1 = MALLOC(double, npoints); R2 = MALLOC(double, npoints);
+	srand48(1);
+	for(i = 0; i < npoints; ++i){ // objects visible from SAO & any sidereal time
+		A[i] = drand48() * 86400.;
+		D[i] = (drand48() * 135. - 45.) * 3600.;
+		S[i] = drand48() * 86400.;
+	}
+	printf("%d points, best of %d runs\n", npoints, nrepeat);
+	printf("function  scalar ns/pt  batch ns/pt   speedup  max error ('')\n");
+	if((e = compare("calc_AZ", scalar_AZ, batch_AZ, S360, 1., S360)) > err) err = e;
+	if((e = compare("calc_PA", scalar_PA, batch_PA, S360, 1., 0.)) > err) err = e;
+	for(i = 0; i < npoints; ++i){ // any azimuth & zenith distance
+		A[i] = (drand48() * 360. - 180.) * 3600.;
+		D[i] = drand48() * 90. * 3600.;
+	}
+	if((e = compare("calc_AD", scalar_AD, batch_AD, 86400., 15., S360)) > err) err = e;
+	if(err > CB_MAXERR){
+		WARNX(_("Error of batch functions is more than %g''"), CB_MAXERR);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * cmdlnopts.c - the only function that parce cmdln args and returns glob parameters
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include "cmdlnopts.h"
+#include "usefull_macros.h"
+#include "qbench.h"
+#include <assert.h>
+
+/*
+ * here are global parameters initialisation
+ */
+glob_pars G;  // internal global parameters structure
+int help = 0; // whether to show help string
+
+glob_pars Gdefault = {
+	 .nsenders       = 4
+	,.duration       = 10.
+	,.rate           = 0.
+	,.drain          = 0.
+	,.mix            = QB_DEFMIX
+	,.key            = "Bnch"
+	,.qbytes         = 0
+	,.interval       = 0.1
+};
+
+/*
+ * Define command line options by filling structure:
+ *	name	has_arg	flag	val		type		argptr			help
+*/
+myoption cmdlnopts[] = {
+	{"help",	0,	NULL,	'h',	arg_int,	APTR(&help),		N_("show this help")},
+	{"senders",	1,	NULL,	'n',	arg_int,	APTR(&G.nsenders),	N_("amount of sender processes")},
+	{"time",	1,	NULL,	't',	arg_double,	APTR(&G.duration),	N_("test duration (seconds)")},
+	{"rate",	1,	NULL,	'R',	arg_double,	APTR(&G.rate),		N_("messages per second from each sender (0 - max)")},
+	{"drain",	1,	NULL,	'r',	arg_double,	APTR(&G.drain),		N_("receiver rate, messages per second (0 - max)")},
+	{"mix",		1,	NULL,	'm',	arg_string,	APTR(&G.mix),		N_("commands mix: name:weight,... (default: " QB_DEFMIX ")")},
+	{"key",		1,	NULL,	'k',	arg_string,	APTR(&G.key),		N_("key of test queue (4 characters)")},
+	{"qbytes",	1,	NULL,	'Q',	arg_int,	APTR(&G.qbytes),	N_("set queue capacity in bytes (msg_qbytes)")},
+	{"interval",1,	NULL,	'i',	arg_double,	APTR(&G.interval),	N_("queue depth sampling interval (seconds)")},
+	end_option
+};
+
+
+/**
+ * Parce command line options and return dynamically allocated structure
+ * 		to global parameters
+ * @param argc - copy of argc from main
+ * @param argv - copy of argv from main
+ * @return allocated structure with global parameters
+ */
+glob_pars *parce_args(int argc, char **argv){
+	int i;
+	void *ptr;
+	ptr = memcpy(&G, &Gdefault, sizeof(G)); assert(ptr);
+	// format of help: "Usage: progname [args]\n"
+	change_helpstring("Usage: %s [args]\n\n\tWhere args are:\n");
+	// parse arguments
+	parceargs(&argc, &argv, cmdlnopts);
+	if(help) showhelp(-1, cmdlnopts);
+	if(argc > 0){
+		printf("\nIgnore argument[s]:\n");
+		for (i = 0; i < argc; i++)
+			printf("\t%s\n", argv[i]);
+	}
+	return &G;
+}
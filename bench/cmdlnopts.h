@@ -0,0 +1,46 @@
+/*
+ * cmdlnopts.h - comand line options for parceargs
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __CMDLNOPTS_H__
+#define __CMDLNOPTS_H__
+
+#include "parceargs.h"
+
+/*
+ * here are some typedef's for global data
+ */
+
+typedef struct{
+	int nsenders;   // amount of sender processes
+	double duration;// test duration (seconds)
+	double rate;    // messages per second from each sender (0 - as fast as possible)
+	double drain;   // receiver rate (messages per second, 0 - as fast as possible)
+	char *mix;      // commands mix: name:weight,...
+	char *key;      // queue key (4 characters)
+	int qbytes;     // set queue capacity (bytes, 0 - system default)
+	double interval;// queue depth sampling interval (seconds)
+}glob_pars;
+
+glob_pars *parce_args(int argc, char **argv);
+extern glob_pars *GP;
+
+#endif // __CMDLNOPTS_H__
@@ -0,0 +1,175 @@
+/*
+ * main.c - command queue load generator: throughput, drops & latency of
+ *          message queue under load of several senders
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+#include "timers.h"
+#include "cmdlnopts.h"
+#include "qbench.h"
+
+glob_pars *GP = NULL;
+
+static struct CMD_Queue bq = {{{0}}, 0600, 0, -1, 0};
+
+void signals(int sig){
+	if(sig) WARNX(_("Get signal %d, quit.\n"), sig);
+	if(bq.id > -1) msgctl(bq.id, IPC_RMID, NULL);
+	exit(sig);
+}
+
+static int cmp_u32(const void *a, const void *b){
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+// latency percentile (us) from sorted array
+static uint32_t percentile(uint32_t *lat, uint64_t n, double p){
+	uint64_t i;
+	if(!n) return 0;
+	i = (uint64_t)ceil(p / 100. * (double)n);
+	if(i) --i;
+	if(i >= n) i = n - 1;
+	return lat[i];
+}
+
+int main(int argc, char **argv){
+	sender_stat *st, total = {0};
+	qb_receiver R;
+	pthread_t rthread;
+	struct msqid_ds ds;
+	double t0, tend, tnext, tsec;
+	uint64_t maxnum = 0, maxbytes = 0, secnum = 0, secbytes = 0, lastrcvd = 0, backlog;
+	int i, alive;
+	initial_setup();
+	GP = parce_args(argc, argv);
+	assert(GP);
+	if(GP->nsenders < 1 || GP->nsenders > 1024) ERRX(_("Amount of senders should be from 1 to 1024"));
+	if(GP->duration <= 0.) ERRX(_("Duration should be positive"));
+	if(GP->interval < 0.001 || GP->interval > 1.) ERRX(_("Sampling interval should be from 1ms to 1s"));
+	if(!qb_setmix(GP->mix)){
+		qb_listmix();
+		return 1;
+	}
+	if(strlen(GP->key) != 4) ERRX(_("Queue key should have exactly 4 characters"));
+	memcpy(bq.key.name, GP->key, 4);
+	signal(SIGTERM, signals);
+	signal(SIGHUP, signals);
+	signal(SIGINT, signals);
+	signal(SIGQUIT, signals);
+	get_cmd_queue(&bq, ServerSide);
+	if(bq.id < 0) ERRX(_("Can't create test queue"));
+	if(msgctl(bq.id, IPC_STAT, &ds)) ERR("msgctl()");
+	if(GP->qbytes > 0){
+		ds.msg_qbytes = (msglen_t)GP->qbytes;
+		if(msgctl(bq.id, IPC_SET, &ds)) WARN(_("Can't change queue capacity"));
+		msgctl(bq.id, IPC_STAT, &ds);
+	}
+	printf("Queue capacity: %lu bytes, senders: %d, rate: ", (unsigned long)ds.msg_qbytes, GP->nsenders);
+	if(GP->rate > 0.) printf("%g msg/s each", GP->rate); else printf("max");
+	printf(", drain: ");
+	if(GP->drain > 0.) printf("%g msg/s\n", GP->drain); else printf("max\n");
+	st = mmap(NULL, GP->nsenders * sizeof(sender_stat), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if(st == MAP_FAILED) ERR("mmap()");
+	memset(st, 0, GP->nsenders * sizeof(sender_stat));
+	t0 = mtime() + 0.05; // give time to start all senders
+	tend = t0 + GP->duration;
+	memset(&R, 0, sizeof(R));
+	R.qid = bq.id; R.t0 = t0; R.drain = GP->drain;
+	if(pthread_create(&rthread, NULL, qb_receive, &R)) ERR("pthread_create()");
+	for(i = 0; i < GP->nsenders; ++i){
+		pid_t p = fork();
+		if(p < 0) ERR("fork()");
+		if(p == 0){
+			signal(SIGINT, SIG_DFL); signal(SIGTERM, SIG_DFL);
+			signal(SIGHUP, SIG_DFL); signal(SIGQUIT, SIG_DFL);
+			while(mtime() < t0);
+			get_cmd_queue(&bq, ClientSide);
+			qb_sender(i, t0, tend, GP->rate, &st[i]);
+			_exit(0);
+		}
+	}
+	// sample queue depth until all senders are done
+	printf("\n%6s %10s %10s %10s %8s\n", "time", "rcvd/s", "maxdepth", "maxbytes", "full,%");
+	tnext = t0 + GP->interval;
+	tsec = t0 + 1.;
+	alive = GP->nsenders;
+	while(alive){
+		double t;
+		while((t = mtime()) < tnext) usleep(1000);
+		tnext += GP->interval;
+		if(msgctl(bq.id, IPC_STAT, &ds) == 0){
+			if(ds.msg_qnum > secnum) secnum = ds.msg_qnum;
+			if(ds.__msg_cbytes > secbytes) secbytes = ds.__msg_cbytes;
+		}
+		if(t >= tsec || t >= tend){
+			uint64_t r = R.received;
+			double dt = t - (tsec - 1.);
+			printf("%6.1f %10.0f %10llu %10llu %8.1f\n", t - t0, (double)(r - lastrcvd) / dt,
+				(unsigned long long)secnum, (unsigned long long)secbytes,
+				ds.msg_qbytes ? 100. * (double)secbytes / (double)ds.msg_qbytes : 0.);
+			lastrcvd = r;
+			if(secnum > maxnum) maxnum = secnum;
+			if(secbytes > maxbytes) maxbytes = secbytes;
+			secnum = secbytes = 0;
+			tsec = t + 1.;
+		}
+		while(alive && waitpid(-1, NULL, WNOHANG) > 0) --alive;
+	}
+	// the rest of messages is a backlog server should process after load stops
+	backlog = msgctl(bq.id, IPC_STAT, &ds) ? 0 : ds.msg_qnum;
+	tend = mtime();
+	for(i = 0; i < GP->nsenders; ++i){
+		total.sent += st[i].sent;
+		total.eagain += st[i].eagain;
+		total.errors += st[i].errors;
+	}
+	while(R.received < total.sent && mtime() - tend < 5.) usleep(1000);
+	msgctl(bq.id, IPC_RMID, NULL);
+	bq.id = -1;
+	pthread_join(rthread, NULL);
+	tend -= t0;
+	printf("\nSent: %llu (%.0f msg/s), dropped (EAGAIN): %llu, other errors: %llu\n",
+		(unsigned long long)total.sent, (double)total.sent / tend,
+		(unsigned long long)total.eagain, (unsigned long long)total.errors);
+	printf("Received: %llu, backlog after load: %llu, max depth: %llu msgs (%llu bytes)\n",
+		(unsigned long long)R.received, (unsigned long long)backlog,
+		(unsigned long long)maxnum, (unsigned long long)maxbytes);
+	if(R.nlat){
+		qsort(R.lat, R.nlat, sizeof(uint32_t), cmp_u32);
+		printf("Latency, us: p50=%u, p90=%u, p99=%u, p99.9=%u, max=%u\n",
+			percentile(R.lat, R.nlat, 50.), percentile(R.lat, R.nlat, 90.),
+			percentile(R.lat, R.nlat, 99.), percentile(R.lat, R.nlat, 99.9),
+			R.lat[R.nlat - 1]);
+	}
+	free(R.lat);
+	munmap(st, GP->nsenders * sizeof(sender_stat));
+	return 0;
+}
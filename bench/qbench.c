@@ -0,0 +1,182 @@
+/*
+ * qbench.c - load generator & receiver for command queues benchmark
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <math.h>
+#include <strings.h>
+#include <time.h>
+
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+#include "timers.h"
+#include "qbench.h"
+
+/*
+ * Senders use usual send_cmd_* helpers (through command macros of bta_shdata.h);
+ * time of sending (us from test start) & sender number are transmitted in src_pid
+ * & src_ip fields of message (set_cmd_src()), so receiver can calculate latency.
+ */
+
+static void c_stop()   { StopTeleskope(); }
+static void c_pmode()  { SetPMode(P2_Off); }
+static void c_radec()  { SetRADec(36000., 180000.); }
+static void c_azimz()  { SetAzimZ(360000., 180000.); }
+static void c_focus()  { MoveFocus(Foc_Hplus, 1.); }
+static void c_p2to()   { MoveP2To(10., 5.); }
+static void c_azcorr() { DoAZcorr(1., 1.); }
+static void c_sewget() { GetSEWparam(1, 2, 3); }
+static void c_sewput() { PutSEWparam(1, 2, 3, 4); }
+static void c_msg()    { SendMessage("bta_qbench: some long text message to test large commands"); }
+
+typedef struct{
+	const char *name;
+	void (*send)();
+} qb_cmd;
+
+static const qb_cmd cmds[] = {
+	{"StopTeleskope", c_stop},
+	{"SetPMode",      c_pmode},
+	{"SetRADec",      c_radec},
+	{"SetAzimZ",      c_azimz},
+	{"MoveFocus",     c_focus},
+	{"MoveP2To",      c_p2to},
+	{"DoAZcorr",      c_azcorr},
+	{"GetSEWparam",   c_sewget},
+	{"PutSEWparam",   c_sewput},
+	{"SendMessage",   c_msg},
+	{NULL, NULL}
+};
+
+#define QB_MAXMIX  (32)
+static const qb_cmd *mix[QB_MAXMIX];
+static int weight[QB_MAXMIX]; // cumulative weights
+static int nmix = 0;
+
+void qb_listmix(){
+	const qb_cmd *c;
+	printf(_("Commands available:"));
+	for(c = cmds; c->name; ++c) printf(" %s", c->name);
+	printf("\n");
+}
+
+/**
+ * Set commands mix
+ * @param str - list of "name:weight" (weight by default is 1)
+ * @return 0 if string is wrong
+ */
+int qb_setmix(char *str){
+	char *s = strdup(str), *tok, *saveptr = NULL;
+	int total = 0;
+	nmix = 0;
+	for(tok = strtok_r(s, ", ", &saveptr); tok; tok = strtok_r(NULL, ", ", &saveptr)){
+		const qb_cmd *c;
+		int w = 1;
+		char *colon = strchr(tok, ':');
+		if(colon){
+			*colon++ = 0;
+			w = atoi(colon);
+		}
+		for(c = cmds; c->name && strcasecmp(c->name, tok); ++c);
+		if(!c->name || w < 1 || nmix == QB_MAXMIX){
+			WARNX(_("Wrong mix item: %s"), tok);
+			free(s);
+			return 0;
+		}
+		total += w;
+		mix[nmix] = c;
+		weight[nmix++] = total;
+	}
+	free(s);
+	return nmix;
+}
+
+static sender_stat *Sstat = NULL;
+
+static void sent_hook(int _U_ code, int err){
+	if(!err) ++Sstat->sent;
+	else if(err == EAGAIN) ++Sstat->eagain;
+	else ++Sstat->errors;
+}
+
+/**
+ * Send commands by mix until `tend`
+ * @param idx  - number of sender
+ * @param t0   - start of test (mtime())
+ * @param tend - end of test
+ * @param rate - messages per second (0 - as fast as possible)
+ * @param st   - statistics
+ */
+void qb_sender(int idx, double t0, double tend, double rate, sender_stat *st){
+	unsigned int seed = (unsigned int)(idx * 7919 + getpid());
+	uint64_t n = 0;
+	double t;
+	Sstat = st;
+	cmd_sent_hook = sent_hook;
+	while((t = mtime()) < tend){
+		int i, r = rand_r(&seed) % weight[nmix - 1];
+		for(i = 0; weight[i] <= r; ++i);
+		int us = (int)((t - t0) * 1e6);
+		set_cmd_src((uint32_t)idx, us ? us : 1); // zero PID means "use getpid()"
+		mix[i]->send();
+		if(rate > 0.){ // sleep until next message time
+			double next = t0 + (double)(++n) / rate;
+			struct timespec ts;
+			if(next > tend) break;
+			ts.tv_sec = (time_t)next;
+			ts.tv_nsec = (long)((next - ts.tv_sec) * 1e9);
+			while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+		}
+	}
+}
+
+/**
+ * Receive messages until queue removed, store latencies
+ * @param arg - receiver state
+ */
+void *qb_receive(void *arg){
+	qb_receiver *R = (qb_receiver*)arg;
+	struct{
+		struct my_msgbuf m;
+		char reserve[16]; // sizeof(long) could be more than sizeof(int32_t)
+	} buf;
+	uint64_t n = 0;
+	while(1){
+		if(msgrcv(R->qid, (struct msgbuf *)&buf, 112, 0, MSG_NOERROR) < 0){
+			if(errno == EINTR) continue;
+			break; // EIDRM - queue removed
+		}
+		double t = mtime();
+		if(R->nlat == R->latsize){
+			R->latsize = R->latsize ? R->latsize * 2 : 65536;
+			R->lat = realloc(R->lat, R->latsize * sizeof(uint32_t));
+			if(!R->lat) ERR("realloc()");
+		}
+		double lat = (t - R->t0) * 1e6 - (double)buf.m.src_pid;
+		R->lat[R->nlat++] = (lat < 0.) ? 0 : (uint32_t)lat;
+		R->received = ++n;
+		if(R->drain > 0.){ // emulate slow server
+			double next = R->t0 + (double)n / R->drain;
+			struct timespec ts;
+			ts.tv_sec = (time_t)next;
+			ts.tv_nsec = (long)((next - ts.tv_sec) * 1e9);
+			while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,52 @@
+/*
+ * qbench.h - load generator & receiver for command queues benchmark
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __QBENCH_H__
+#define __QBENCH_H__
+
+#include <stdint.h>
+
+#define QB_DEFMIX  "SetRADec:4,MoveFocus:2,SetPMode:2,StopTeleskope:1,SendMessage:1"
+
+// sender statistics (lays in memory shared between processes)
+typedef struct{
+	uint64_t sent;     // sent successfully
+	uint64_t eagain;   // dropped because queue was full
+	uint64_t errors;   // other msgsnd errors
+} sender_stat;
+
+// receiver state
+typedef struct{
+	int qid;           // queue ID
+	double t0;         // start of test (mtime())
+	double drain;      // messages per second (0 - as fast as possible)
+	volatile uint64_t received; // amount of messages received
+	uint32_t *lat;     // latencies (us)
+	uint64_t nlat;     // amount of latencies stored
+	uint64_t latsize;  // size of `lat`
+} qb_receiver;
+
+int qb_setmix(char *mix);
+void qb_listmix();
+void qb_sender(int idx, double t0, double tend, double rate, sender_stat *st);
+void *qb_receive(void *r);
+
+#endif // __QBENCH_H__
@@ -21,8 +21,6 @@
 #define _GNU_SOURCE 666 // for strcasestr
 #include <strings.h>
 #include <string.h>
-#include <pthread.h>
-#include <signal.h>  // pthread_kill
 #include <math.h>
 
 #include "bta_shdata.h"
@@ -32,6 +30,8 @@
 #include "bta_control.h"
 #include "angle_functions.h"
 #include "bta_print.h"
+#include "timers.h"
+#include "cmdlat.h"
 
 // constants for choosing move/goto (move for near objects)
 const double Amove = 1800.;   // +-30'
@@ -39,9 +39,17 @@ const double Zmove = 3600.;   // +-60'
 // arcseconds to radians
 #define AS2R  (M_PI/180./3600.)
 
+// all data reading goes through coherent copy of shared data, see update_snapshot()
+static struct BTA_Snapshot Snap;
+#define sdt   (&Snap.data)
+#define sdtl  (&Snap.local)
+
 // ACS command wrapper
 #ifdef EMULATION
 #define ACS_CMD(a)   do{green(#a); printf("\n");}while(0)
+#elif defined SEND_COMMANDS
+// really send commands (e.g. to emulator/bta_emulator)
+#define ACS_CMD(a)   do{DBG(#a); a; }while(0)
 #else
 #define ACS_CMD(a)   do{red(#a); printf("\n");}while(0)
 // Uncomment only in final release
@@ -49,103 +57,391 @@ const double Zmove = 3600.;   // +-60'
 #endif
 
 volatile int tmout = 0;
-pthread_t athread;
-void *tmout_thread(void *buf){
-	int selfd = -1, *sec = (int*)buf;
-	struct timeval tv;
-	tv.tv_sec  = *sec;
-	tv.tv_usec = 0;
-	errno = 0;
-	while(selfd < 0){
-		selfd = select(0, NULL, NULL, NULL, &tv);
-		if(selfd < 0 && errno != EINTR){
-			WARN(_("Error while select()"));
-			tmout = 1;
-			return NULL;
-		}
-	}
-	tmout = 1;
-	return NULL;
+/**
+ * set deadline [delay] (in seconds), after it variable tmout will be set
+ * (previous deadline is cancelled)
+ */
+void set_timeout(int delay){
+	static int id = -1;
+	timer_cancel(id);
+	id = timer_add("wait", (double)delay, &tmout);
 }
+char indi[] = "|/-\\";
+char *iptr = indi;
 
 /**
- * run thread with pause [delay] (in seconds), at its end set variable tmout
+ * refresh local copy of shared data
+ * all WAIT_EVENT conditions are checked on this copy
  */
-void set_timeout(int delay){
-	static int run = 0;
-	static int *arg = NULL;
-	if(!arg) arg = MALLOC(int, 1);
-	if(run && (pthread_kill(athread, 0) != ESRCH)){ // another timeout process detected - kill it
-		pthread_cancel(athread);
-		pthread_join(athread, NULL);
+void update_snapshot(){
+	if(!get_bta_snapshot(&Snap))
+		DBG("Data changed while copying (%u tries)", Snap.tries);
+	cmdlat_check();
+}
+
+/*
+ * Waiting engine: conditions are checked right after server publishes new data.
+ * Publishing period learns by M_time changes, so between ticks we sleep until
+ * a little before the next expected tick & then poll M_time with small steps.
+ */
+// guard interval before expected tick (part of period)
+#define WAIT_GUARD        (0.1)
+// polling step (part of period) & its limits (seconds)
+#define WAIT_POLLPART     (0.02)
+#define WAIT_POLLMIN      (0.0005)
+#define WAIT_POLLMAX      (0.01)
+// max sleeping interval (to refresh indicator & check timeout)
+#define WAIT_MAXSLEEP     (0.1)
+wait_stat Wstat = {0};
+static double last_mtime = -1.;  // last M_time seen
+static double last_tick = 0.;    // local time when last M_time change was seen
+static double wait_t0, next_indi;
+
+// seconds -> usleep
+static void wsleep(double t){
+	if(t > WAIT_MAXSLEEP) t = WAIT_MAXSLEEP;
+	if(t > 0.) usleep((useconds_t)(t * 1e6));
+}
+
+/**
+ * check whether M_time changed & learn publishing period
+ * @return 1 if there's a new tick
+ */
+static int check_tick(){
+	double m = get_shm_mtime(), dm;
+	if(m == last_mtime) return 0;
+	dm = m - last_mtime;
+	if(dm < 0.) dm += 86400.; // midnight
+	if(last_mtime > 0. && dm > 0. && dm < 10.){
+		// missed ticks (dm is several periods) don't change estimation
+		if(Wstat.period <= 0. || dm < 0.7 * Wstat.period) Wstat.period = dm;
+		else if(dm < 1.5 * Wstat.period) Wstat.period += (dm - Wstat.period) * 0.2;
+	}
+	last_mtime = m;
+	last_tick = mtime();
+	++Wstat.ticks;
+	return 1;
+}
+
+/**
+ * start waiting: set timeout & indicator
+ */
+void wait_start(int max_delay){
+	set_timeout(max_delay);
+	wait_t0 = mtime();
+	next_indi = wait_t0 + WAIT_MAXSLEEP;
+	Wstat.ticks = 0;
+	check_tick();
+	Wstat.ticks = 0;
+	PRINT(" ");
+}
+
+/**
+ * sleep until next server tick but no longer than till moment `until`
+ * @return 1 if got new tick
+ */
+static int sleep_till_tick(double until){
+	double poll = WAIT_POLLMAX, t;
+	if(Wstat.period > 0.){
+		poll = Wstat.period * WAIT_POLLPART;
+		if(poll < WAIT_POLLMIN) poll = WAIT_POLLMIN;
+		else if(poll > WAIT_POLLMAX) poll = WAIT_POLLMAX;
+		// sleep until a little before expected tick
+		t = last_tick + Wstat.period * (1. - WAIT_GUARD);
+		if(t > until) t = until;
+		wsleep(t - mtime());
+	}
+	while(!check_tick()){
+		t = mtime();
+		if(t > until) return 0;
+		if(t + poll > until) poll = until - t;
+		wsleep(poll);
+	}
+	return 1;
+}
+
+/**
+ * sleep until next server tick (or timeout)
+ */
+void wait_tick(){
+	static int n = 0;
+	sleep_till_tick(next_indi);
+	if(mtime() > next_indi){
+		next_indi += WAIT_MAXSLEEP;
+		if(!*(++iptr)) iptr = indi;
+		if(++n % 10 == 0) PRINT("\b. ");
+		PRINT("\b%c", *iptr);
 	}
-	tmout = 0;
-	run = 1;
-	*arg = delay;
-	if(pthread_create(&athread, NULL, tmout_thread, (void*)arg)){
-		WARN(_("Can't create timeout thread!"));
-		tmout = 1;
-		return;
+}
+
+/**
+ * wait for new data from server (without indicator & timeout flag)
+ * @param timeout - max waiting time (seconds)
+ * @return 1 if data changed since previous call, 0 if timeout
+ */
+int wait_data(double timeout){
+	return sleep_till_tick(mtime() + timeout);
+}
+
+/**
+ * end of waiting: calculate detection latency
+ */
+void wait_end(){
+	double t = mtime();
+	Wstat.duration = t - wait_t0;
+	if(!tmout && Wstat.ticks){
+		// latency by server time if clocks are synchronized, else by moment of tick detection
+		double lat = fmod(dtime(), 86400.) - last_mtime;
+		if(lat < 0. || lat > 1.) lat = t - last_tick;
+		Wstat.latency = lat;
+		DBG("Event after %d ticks (%.3fs), period: %.1fms",
+			Wstat.ticks, Wstat.duration, Wstat.period*1e3);
+		PRINT(_(" (latency %.1fms)\n"), lat*1e3);
+	}else{
+		Wstat.latency = 0.;
+		PRINT("\n");
 	}
 }
-char indi[] = "|/-\\";
-char *iptr = indi;
 
 /***************************************************************
  * All functions for changing telescope parameters are boolean *
  * returning TRUE in case of succsess or FALSE if failed       *
  ***************************************************************/
+/*
+ * Each actuator has its own lock (see lock_resource() in ch4run.c), so non-conflicting
+ * commands can run from concurrent processes; lock is recursive inside one process.
+ */
+typedef enum{
+	 RES_TEL = 0 // telescope pointing (coordinates, goto, corrections, stop, Az reverce)
+	,RES_P2      // P2 rotation & mode
+	,RES_FOCUS   // focus motor
+	,RES_PCS     // pointing correction system state
+	,RES_AMOUNT
+} bta_resource;
+
+static const char *resnames[RES_AMOUNT] = {"tel", "p2", "focus", "pcs"};
+static int resfd[RES_AMOUNT] = {-1, -1, -1, -1};
+static int rescnt[RES_AMOUNT] = {0};
+
+/**
+ * Lock resource, wait no more than GP->lockwait if it is busy
+ * @return FALSE if resource is still busy
+ */
+static bool res_get(bta_resource r){
+	if(rescnt[r]++) return TRUE;
+	if((resfd[r] = lock_resource(resnames[r], 0.)) > -1) return TRUE;
+	double t0 = mtime();
+	pid_t owner = resource_owner(resnames[r]);
+	if(owner) PRINT(_("Resource '%s' is busy (pid %d), waiting... "), resnames[r], owner);
+	else PRINT(_("Resource '%s' is busy (owner unknown), waiting... "), resnames[r]);
+	resfd[r] = lock_resource(resnames[r], GP->lockwait);
+	if(resfd[r] < 0){
+		WARNX(_("Resource '%s' is still busy after %.1fs"), resnames[r], mtime() - t0);
+		--rescnt[r];
+		return FALSE;
+	}
+	PRINT(_("got it after %.1fs\n"), mtime() - t0);
+	return TRUE;
+}
+
+static void res_put(bta_resource r){
+	if(rescnt[r] < 1 || --rescnt[r]) return;
+	unlock_resource(resfd[r]);
+	resfd[r] = -1;
+}
+
+// run function `fn` holding resource `r`
+#define LOCKED(r, fn)  do{if(!res_get(r)) return FALSE; \
+		bool ret_ = fn; res_put(r); return ret_;}while(0)
+
 #ifndef WAIT_EVENT
-#define WAIT_EVENT(evt, max_delay)  do{int __ = 0; set_timeout(max_delay); \
-		PRINT(" "); while(!tmout && !(evt)){ \
-		usleep(100000); if(!*(++iptr)) iptr = indi; if(++__%10==0) PRINT("\b. "); \
-		PRINT("\b%c", *iptr);}; PRINT("\n");}while(0)
+#define WAIT_EVENT(evt, max_delay)  do{wait_start(max_delay); \
+		while(!tmout && (update_snapshot(), !(evt))) wait_tick(); \
+		wait_end();}while(0)
 #endif
 
+/*
+ * Motions are non-blocking state machines: step() is called after each refresh of
+ * snapshot and changes state by current data or by deadline of current state, so
+ * independent mechanisms (P2, focus, telescope) could move simultaneously in one loop.
+ */
+typedef enum{
+	 OP_RUN = 0 // still working
+	,OP_OK      // done
+	,OP_FAIL    // failed
+} op_status;
+
+typedef struct bta_op{
+	const char *name;
+	op_status (*step)(struct bta_op *op);
+	int state;          // current state of machine
+	double deadline;    // timeout of current state (mtime())
+	double tstart;      // time of start
+	double tend;        // time of end (0 while running)
+	int tries;          // amount of moving tries
+	int mode;           // P2: mode to restore; goto: TRUE for RA/Decl
+	double target;      // target value (P2 in degrees, focus in mm)
+	double dt;          // estimated time of current moving
+} bta_op;
+
+// change state & set its timeout
+#define OP_SET(op, st, tm)  do{(op)->state = (st); (op)->deadline = mtime() + (tm);}while(0)
+#define OP_TMOUT(op)        (mtime() > (op)->deadline)
+
 /**
- * move P2 to the given angle relative to current position +- P2_ANGLE_THRES
+ * Run operations until all of them end
+ * @param ops - array of operations prepared to run
+ * @param n   - its size
+ * @return FALSE if any of them failed
  */
-void cmd_P2moveto(double p2shift){
-	double p2vel = 45.*60., p2dt, p2mintime = P2_MINTIME, p2secs = fabs(p2shift) * 3600.;
-	if(fabs(p2shift) < P2_ANGLE_THRES) return;
-	p2dt = p2secs / p2vel;
-	if(p2dt < p2mintime){
-		p2vel = p2secs / p2mintime;
-		if(p2vel < 1.) p2vel = 1.;
-		p2dt = p2secs / p2vel;
-	}
-	// if speed is too fast, make dt less
-	if(p2vel > P2_FAST_SPEED && p2dt > P2_FAST_T_CORR + P2_MINTIME){
-		p2dt -= P2_FAST_T_CORR;
+static bool run_ops(bta_op **ops, int n){
+	int i, active = n;
+	bool ret = TRUE;
+	double t0 = mtime();
+	for(i = 0; i < n; ++i){
+		ops[i]->tstart = t0;
+		ops[i]->tend = 0.;
+	}
+	while(active){
+		double now, wait = WAIT_MAXSLEEP;
+		update_snapshot();
+		for(i = 0; i < n; ++i){
+			bta_op *op = ops[i];
+			if(op->tend > 0.) continue;
+			op_status st = op->step(op);
+			if(st == OP_RUN) continue;
+			op->tend = mtime();
+			--active;
+			if(st == OP_FAIL) ret = FALSE;
+			DBG("%s %s after %.1fs", op->name, (st == OP_OK) ? "done" : "failed", op->tend - op->tstart);
+		}
+		if(!active) break;
+		// wait for next server tick but no longer than nearest deadline
+		now = mtime();
+		for(i = 0; i < n; ++i)
+			if(ops[i]->tend == 0. && ops[i]->deadline - now < wait) wait = ops[i]->deadline - now;
+		if(wait > 0.) wait_data(wait);
 	}
-	if(p2shift < 0) p2vel = -p2vel;
-	DBG("p2vel=%g, p2dt = %g, p2_val=%s", p2vel, p2dt, angle_asc(val_P));
-	ACS_CMD(MoveP2To(p2vel, p2dt));
+	return ret;
+}
+
+// run single operation after its preparing
+static bool run_op(bta_op *op, op_status prepared){
+	if(prepared != OP_RUN) return (prepared == OP_OK);
+	return run_ops(&op, 1);
+}
+
+/******************************** P2 ******************************************/
+enum{
+	 P2S_STOP    // wait for stop after force stop
+	,P2S_SETUP   // P2 is stopped: start moving
+	,P2S_MOVE    // next try
+	,P2S_WSTART  // wait for P2 starts
+	,P2S_WSTOP   // wait for P2 stops
+	,P2S_CHECK   // check position after moving
+};
+
+static op_status p2_step(bta_op *op){
+	double p2val, shift, p2vel, p2secs;
+	while(1){
+		p2val = sec_to_degr(val_P);
+		switch(op->state){
+			case P2S_STOP:
+				if(P2_State == P2_Off){
+					op->state = P2S_SETUP;
+					continue;
+				}
+				if(!OP_TMOUT(op)) return OP_RUN;
+				WARNX(_("Timeout reached, can't stop P2"));
+				return OP_FAIL;
+			case P2S_SETUP:
+				op->mode = P2_Mode;
+				ACS_CMD(SetPMode(P2_Off));
+				DBG("Move P2 to %gdegr", op->target);
+				if(fabs(op->target - p2val) < P2_ANGLE_THRES){
+					WARNX(_("Zero moving (< %g)"), P2_ANGLE_THRES);
+					return OP_OK;
+				}
+				op->state = P2S_MOVE;
+				continue;
+			case P2S_MOVE: // move to the given angle relative to current position
+				if(op->tries++) PRINT(_("P2: try %d\n"), op->tries);
+				shift = op->target - p2val;
+				op->state = P2S_CHECK;
+				if(fabs(shift) < P2_ANGLE_THRES) continue;
+				p2vel = 45.*60.;
+				p2secs = fabs(shift) * 3600.;
+				op->dt = p2secs / p2vel;
+				if(op->dt < P2_MINTIME){
+					p2vel = p2secs / P2_MINTIME;
+					if(p2vel < 1.) p2vel = 1.;
+					op->dt = p2secs / p2vel;
+				}
+				// if speed is too fast, make dt less
+				if(p2vel > P2_FAST_SPEED && op->dt > P2_FAST_T_CORR + P2_MINTIME)
+					op->dt -= P2_FAST_T_CORR;
+				if(shift < 0) p2vel = -p2vel;
+				DBG("p2vel=%g, p2dt = %g, p2_val=%s", p2vel, op->dt, angle_asc(val_P));
+				ACS_CMD(MoveP2To(p2vel, op->dt));
 #ifndef EMULATION
-	PRINT(_("Wait for starting"));
-	WAIT_EVENT(((fabs(vel_P) > 1.) && (P2_State != P2_Off)), WAITING_TMOUT);
-	if((fabs(vel_P) < 1.) || (P2_State == P2_Off)){
-		DBG("vel: %g, state: %d", vel_P, P2_State);
-		WARNX(_("P2 didn't start!"));
-		return;
-	}
-	PRINT(_("Moving P2 "));
-	// wait until P2 stops, set to guiding or timeout ends
-	WAIT_EVENT(((fabs(vel_P) < 1.) && (P2_State == P2_Off)), p2dt + 1.);
-	DBG("P2 state: %d, vel_P: %g, p2_val=%s", P2_State, vel_P, angle_asc(val_P));
-	if(tmout && P2_State != P2_Off){
-		WARNX(_("Timeout reached, stop P2"));
-		ACS_CMD(MoveP2(0));
-	}
+				PRINT(_("P2: wait for starting\n"));
+				OP_SET(op, P2S_WSTART, WAITING_TMOUT);
 #endif
+				continue;
+			case P2S_WSTART:
+				if(fabs(vel_P) > 1. && P2_State != P2_Off){
+					PRINT(_("P2: moving\n"));
+					// wait until P2 stops, set to guiding or timeout ends
+					OP_SET(op, P2S_WSTOP, op->dt + 1.);
+					continue;
+				}
+				if(!OP_TMOUT(op)) return OP_RUN;
+				DBG("vel: %g, state: %d", vel_P, P2_State);
+				WARNX(_("P2 didn't start!"));
+				op->state = P2S_CHECK;
+				continue;
+			case P2S_WSTOP:
+				if(fabs(vel_P) < 1. && P2_State == P2_Off){
+					op->state = P2S_CHECK;
+					continue;
+				}
+				if(!OP_TMOUT(op)) return OP_RUN;
+				if(P2_State != P2_Off){
+					WARNX(_("Timeout reached, stop P2"));
+					ACS_CMD(MoveP2(0));
+				}
+				op->state = P2S_CHECK;
+				continue;
+			case P2S_CHECK:
+				DBG("P2 state: %d, vel_P: %g, p2_val=%s", P2_State, vel_P, angle_asc(val_P));
+				if(fabs(op->target - p2val) < P2_ANGLE_THRES){
+					PRINT(_("All OK, current P2 value: %s\n"), angle_asc(val_P));
+					ACS_CMD(SetPMode(op->mode));
+					return OP_OK;
+				}
+				if(op->tries < 5){
+					op->state = P2S_MOVE;
+					continue;
+				}
+				WARNX(_("Error moving P2: have %gdegr, need %gdegr"), p2val, op->target);
+				return OP_FAIL;
+			default:
+				return OP_FAIL;
+		}
+	}
 }
 
 /**
- * move P2 to given angle or at given delta
+ * prepare P2 moving to given angle or at given delta
  * @param angle    angle to move (in degrees) with suffix "rel" for relative moving
+ * @return OP_RUN if op should be run
  */
-bool moveP2(char *arg){
-	if(!arg) return FALSE;
+static op_status p2_prepare(bta_op *op, char *arg){
+	update_snapshot();
+	memset(op, 0, sizeof(bta_op));
+	op->name = "P2";
+	op->step = p2_step;
+	if(!arg) return OP_FAIL;
 	int p2rel = 0;
 	char *eptr = NULL;
 	int badarg = 0;
@@ -164,18 +460,12 @@ bool moveP2(char *arg){
 	if(!get_degrees(&p2angle, arg)) badarg = 1;
 	else{ // now check if there a good angle
 		if(p2angle < -360. || p2angle > 360.) badarg = 1;
-	/*	else if(eptr){
-			if(strcasecmp(eptr, "rel") == 0)
-				p2rel = 1;
-			else // wrong degrees format
-				badarg = 1;
-		}*/
 	}
 bdrg:
 	if(badarg){
 		WARNX(_("Key p2move should be in format angle[rel],\n\tangle - from -360 to +360"
 			"\n\twrite \"rel\" after angle for relative moving"));
-			return FALSE;
+			return OP_FAIL;
 	}
 	// now get information about current angle & check target angle
 	double p2val = sec_to_degr(val_P);
@@ -186,53 +476,32 @@ bdrg:
 	if(p2angle > P2_LOW_ES && p2angle < P2_HIGH_ES){ // prohibited angle
 		WARNX(_("Target angle (%g) is in prohibited zone (between %g & %g degrees)"),
 			p2angle, P2_LOW_ES, P2_HIGH_ES);
-		return FALSE;
+		return OP_FAIL;
 	}
+	op->target = p2angle;
+	op->state = P2S_SETUP;
 	if(P2_State != P2_Off && P2_State != P2_On){
 		WARNX(_("P2 is already moving!"));
-		if(!GP->force) return FALSE;
+		if(!GP->force) return OP_FAIL;
 		WARNX(_("Force stop"));
 		ACS_CMD(MoveP2(0)); // stop P2
 #ifndef EMULATION
-		if(P2_State != P2_Off){
-			PRINT(_("Wait for P2 stop "));
-			WAIT_EVENT(P2_State == P2_Off, WAITING_TMOUT);
-			if(tmout && P2_State != P2_Off){
-				WARNX(_("Timeout reached, can't stop P2"));
-				return 0;
-			}
-		}
+		PRINT(_("P2: wait for stop\n"));
+		OP_SET(op, P2S_STOP, WAITING_TMOUT);
 #endif
 	}
-#ifndef EMULATION
-	_U_ int p2oldmode = P2_Mode;
-#endif
-	ACS_CMD(SetPMode(P2_Off));
-	DBG("Move P2 to %gdegr", p2angle);
-	if(fabs(p2angle - p2val) < P2_ANGLE_THRES){
-		WARNX(_("Zero moving (< %g)"), P2_ANGLE_THRES);
-		return TRUE;
-	}
-	int i;
-	for(i = 0; i < 5; ++i){
-		if(i) PRINT(_("Try %d. "), i+1);
-		cmd_P2moveto(p2angle - p2val);
-		p2val = sec_to_degr(val_P);
-		if(fabs(p2angle - p2val) < P2_ANGLE_THRES) break;
-	}
-	if(fabs(p2angle - p2val) > P2_ANGLE_THRES){
-		WARNX(_("Error moving P2: have %gdegr, need %gdegr"), p2val, p2angle);
-		return FALSE;
-	}
-	PRINT(_("All OK, current P2 value: %s\n"), angle_asc(val_P));
-	ACS_CMD(SetPMode(p2oldmode));
-	return TRUE;
+	return OP_RUN;
+}
+
+static bool moveP2_unlocked(char *arg){
+	bta_op op;
+	return run_op(&op, p2_prepare(&op, arg));
 }
 
 /**
  * set P2 mode: stop or track
  */
-bool setP2mode(char *arg){
+static bool setP2mode_unlocked(char *arg){
 	int _U_ mode;
 	if(!arg) goto badarg;
 	if(strcasecmp(arg, "stop") == 0) mode = P2_Off;
@@ -241,6 +510,7 @@ bool setP2mode(char *arg){
 	DBG("Set P2 mode to %s", (mode == P2_Off) ? "stop" : "track");
 	ACS_CMD(SetPMode(mode));
 #ifndef EMULATION
+	update_snapshot();
 	if(P2_State != mode){
 		PRINT(_("Wait for given mode "));
 		WAIT_EVENT(P2_State == mode, WAITING_TMOUT);
@@ -256,83 +526,128 @@ badarg:
 	return FALSE;
 }
 
-void cmd_Fmoveto(double f){
+/******************************** Focus ***************************************/
+enum{
+	 FS_STOP     // wait for stop after force stop
+	,FS_SETUP    // focus is stopped: start moving
+	,FS_MOVE     // next try
+	,FS_WSTART   // wait for focus starts
+	,FS_WMOVE    // wait for moving end
+	,FS_WSTOP    // wait for motor stop
+	,FS_CHECK    // check position after moving
+};
+
+static op_status focus_step(bta_op *op){
 	const double FOC_HVEL = 0.63, FOC_LVEL = 0.13;
+	double fshift, fvel;
 	int _U_ fspeed;
-	if(f < 1. || f > 199.) return;
-	double fshift = f - val_F, fvel, fdt;
-	if(fabs(fshift) > 1.){
-		fvel = FOC_HVEL;
-		fspeed = (fshift > 0.) ? Foc_Hplus : Foc_Hminus;
-	}else if(fabs(fshift) > FOCUS_THRES){
-		fvel = FOC_LVEL;
-		fspeed = (fshift > 0.) ? Foc_Lplus : Foc_Lminus;
-	} else{
-		WARNX(_("Can't move for such small distance (%gmm)"), fshift);
-		return;
-	}
-	fdt = fabs(fshift) / fvel;
+	while(1) switch(op->state){
+		case FS_STOP:
+			if(Foc_State == Foc_Off){
+				op->state = FS_SETUP;
+				continue;
+			}
+			if(!OP_TMOUT(op)) return OP_RUN;
+			WARNX(_("Timeout reached, can't stop focus motor"));
+			return OP_FAIL;
+		case FS_SETUP:
+			DBG("Move focus to %g", op->target);
+			if(fabs(op->target - val_F) < FOCUS_THRES){
+				WARNX(_("Zero moving (< %g)"), FOCUS_THRES);
+				return OP_OK;
+			}
+			op->state = FS_MOVE;
+			continue;
+		case FS_MOVE:
+			if(op->tries++) PRINT(_("Focus: try %d\n"), op->tries);
+			op->state = FS_CHECK;
+			fshift = op->target - val_F;
+			if(fabs(fshift) > 1.){
+				fvel = FOC_HVEL;
+				fspeed = (fshift > 0.) ? Foc_Hplus : Foc_Hminus;
+			}else if(fabs(fshift) > FOCUS_THRES){
+				fvel = FOC_LVEL;
+				fspeed = (fshift > 0.) ? Foc_Lplus : Foc_Lminus;
+			} else{
+				WARNX(_("Can't move for such small distance (%gmm)"), fshift);
+				continue;
+			}
+			op->dt = fabs(fshift) / fvel;
 #ifdef EMULATION
-	printf("Move focus with speed %g''/s for %gseconds\n", fvel, fdt);
+			printf("Move focus with speed %g''/s for %gseconds\n", fvel, op->dt);
 #endif
-	ACS_CMD(MoveFocus(fspeed, fdt));
+			ACS_CMD(MoveFocus(fspeed, op->dt));
 #ifndef EMULATION
-	DBG("dt: %g, fvel: %g, fstate: %d, F:%g", fdt, vel_F, Foc_State, val_F);
-	PRINT(_("Wait for starting"));
-	WAIT_EVENT((Foc_State != Foc_Off || fabs(vel_F) > 0.01), WAITING_TMOUT);
-	PRINT(_("Moving Focus "));
-	WAIT_EVENT((fabs(vel_F) < 0.01 && Foc_State == Foc_Off), fdt + 1.);
-	DBG("fvel: %g, fstate: %d, F:%g", vel_F, Foc_State, val_F);
-	PRINT(_("Wait for stop"));
-	WAIT_EVENT((Foc_State == Foc_Off && fabs(vel_F) < 0.01), WAITING_TMOUT);
-	DBG("fvel: %g, fstate: %d, F:%g", vel_F, Foc_State, val_F);
-	if(tmout && Foc_State != Foc_Off){
-		WARNX(_("Timeout reached, stop focus"));
-		ACS_CMD(MoveFocus(Foc_Off, 0.));
-	}
+			DBG("dt: %g, fvel: %g, fstate: %d, F:%g", op->dt, vel_F, Foc_State, val_F);
+			PRINT(_("Focus: wait for starting\n"));
+			OP_SET(op, FS_WSTART, WAITING_TMOUT);
 #endif
+			continue;
+		case FS_WSTART:
+			if(Foc_State == Foc_Off && fabs(vel_F) < 0.01 && !OP_TMOUT(op)) return OP_RUN;
+			PRINT(_("Focus: moving\n"));
+			OP_SET(op, FS_WMOVE, op->dt + 1.);
+			continue;
+		case FS_WMOVE:
+			if((fabs(vel_F) > 0.01 || Foc_State != Foc_Off) && !OP_TMOUT(op)) return OP_RUN;
+			DBG("fvel: %g, fstate: %d, F:%g", vel_F, Foc_State, val_F);
+			OP_SET(op, FS_WSTOP, WAITING_TMOUT);
+			continue;
+		case FS_WSTOP:
+			if(Foc_State == Foc_Off && fabs(vel_F) < 0.01){
+				op->state = FS_CHECK;
+				continue;
+			}
+			if(!OP_TMOUT(op)) return OP_RUN;
+			WARNX(_("Timeout reached, stop focus"));
+			ACS_CMD(MoveFocus(Foc_Off, 0.));
+			op->state = FS_CHECK;
+			continue;
+		case FS_CHECK:
+			DBG("fvel: %g, fstate: %d, F:%g", vel_F, Foc_State, val_F);
+			if(fabs(op->target - val_F) < FOCUS_THRES) return OP_OK;
+			if(op->tries < 3){
+				op->state = FS_MOVE;
+				continue;
+			}
+			WARNX(_("Error moving focus: have %gmm, need %gmm"), val_F, op->target);
+			return OP_FAIL;
+		default:
+			return OP_FAIL;
+	}
 }
 
 /**
- * move focus to given position
+ * prepare focus moving to given position
+ * @return OP_RUN if op should be run
  */
-bool moveFocus(double val){
+static op_status focus_prepare(bta_op *op, double val){
+	update_snapshot();
+	memset(op, 0, sizeof(bta_op));
+	op->name = "Focus";
+	op->step = focus_step;
 	if(val < 1. || val > 199.){
 		WARNX(_("Focus value should be between 1mm & 199mm"));
-		return FALSE;
+		return OP_FAIL;
 	}
+	op->target = val;
+	op->state = FS_SETUP;
 	if(Foc_State != Foc_Off){
 		WARNX(_("Focus is already moving!"));
-		if(!GP->force) return FALSE;
+		if(!GP->force) return OP_FAIL;
 		WARNX(_("Force stop"));
 		ACS_CMD(MoveFocus(Foc_Off, 0.));
-	}
 #ifndef EMULATION
-	if(Foc_State != Foc_Off){
-		PRINT(_("Wait for focus stop "));
-		WAIT_EVENT(Foc_State == Foc_Off, WAITING_TMOUT);
-		if(tmout && Foc_State != Foc_Off){
-			WARNX(_("Timeout reached, can't stop focus motor"));
-			return FALSE;
-		}
-	}
+		PRINT(_("Focus: wait for stop\n"));
+		OP_SET(op, FS_STOP, WAITING_TMOUT);
 #endif
-	DBG("Move focus to %g", val);
-	if(fabs(val - val_F) < FOCUS_THRES){
-		WARNX(_("Zero moving (< %g)"), FOCUS_THRES);
-		return TRUE;
-	}
-	int i;
-	for(i = 0; i < 3; ++i){
-		if(i) PRINT(_("Try %d. "), i+1);
-		cmd_Fmoveto(val);
-		if(fabs(val - val_F) < FOCUS_THRES) break;
-	}
-	if(fabs(val - val_F) > FOCUS_THRES){
-		WARNX(_("Error moving focus: have %gmm, need %gmm"), val_F, val);
-		return FALSE;
 	}
-	return TRUE;
+	return OP_RUN;
+}
+
+static bool moveFocus_unlocked(double val){
+	bta_op op;
+	return run_op(&op, focus_prepare(&op, val));
 }
 
 /**
@@ -343,7 +658,8 @@ bool moveFocus(double val){
  *   format A/Z:   suitable for get_degrees(), AZIMUTH GOES FIRST!
  * @param isEQ: TRUE if equatorial coordinates, FALSE if horizontal
  */
-bool setCoords(char *coords, bool isEQ){
+static bool setCoords_unlocked(char *coords, bool isEQ){
+	update_snapshot();
 	if(!coords) return FALSE;
 	char *ra = NULL, *dec = NULL, *ptr = coords;
 	double r, d;
@@ -426,7 +742,8 @@ badcrds:
 /**
  * reverce Azimuth traveling
  */
-bool azreverce(){
+static bool azreverce_unlocked(){
+	update_snapshot();
 	bool ret = TRUE;
 	int mode = Az_Mode;
 	DBG("mode: %d", mode);
@@ -442,6 +759,7 @@ bool azreverce(){
 }
 
 bool testauto(){
+	update_snapshot();
 	if(Tel_Mode != Automatic){
 		WARNX(_("Not automatic mode!"));
 		return FALSE;
@@ -449,7 +767,8 @@ bool testauto(){
 	return TRUE;
 }
 
-bool stop_telescope(){
+static bool stop_telescope_unlocked(){
+	update_snapshot();
 	if(!testauto()) return FALSE;
 	if(Sys_Mode == SysStop){
 		WARNX(_("Already stoped"));
@@ -464,49 +783,103 @@ bool stop_telescope(){
 	return TRUE;
 }
 
+/******************************** Telescope ***********************************/
+enum{
+	 GS_STOP     // wait for stop of telescope
+	,GS_START    // start pointing
+	,GS_DELAY    // pause after start
+	,GS_WGO      // wait for moving
+	,GS_WTRACK   // wait for tracking
+};
+
+static op_status goto_step(bta_op *op){
+	while(1) switch(op->state){
+		case GS_STOP:
+			if(Sys_Mode == SysStop){
+				op->state = GS_START;
+				continue;
+			}
+			if(!OP_TMOUT(op)) return OP_RUN;
+			WARNX(_("Can't stop telescope"));
+			return OP_FAIL;
+		case GS_START:
+			if(op->mode){
+				if((fabs(val_A - InpAzim) < Amove && fabs(val_Z - InpZdist) < Zmove)){ // move back to last coords
+					ACS_CMD(MoveToObject());
+				}else{
+					ACS_CMD(GoToObject());
+				}
+				ACS_CMD(SetSysTarg(TagObject));
+			}else{
+				ACS_CMD(GoToAzimZ());
+				ACS_CMD(SetSysTarg(TagPosition));
+			}
+			DBG("start");
+			ACS_CMD(StartTeleskope());
+			OP_SET(op, GS_DELAY, 0.5);
+			return OP_RUN;
+		case GS_DELAY:
+			if(!OP_TMOUT(op)) return OP_RUN;
+#ifdef EMULATION
+			return OP_OK;
+#else
+			PRINT(_("Telescope: go\n"));
+			OP_SET(op, GS_WGO, WAITING_TMOUT);
+			continue;
+#endif
+		case GS_WGO:
+			if(Sys_Mode != SysStop && Sys_Mode != SysWait){
+				PRINT(_("Telescope: wait for tracking\n"));
+				//  Wait with timeout 15min
+				OP_SET(op, GS_WTRACK, 900.);
+				continue;
+			}
+			if(!OP_TMOUT(op)) return OP_RUN;
+			WARNX(_("Can't move telescope"));
+			ACS_CMD(StopTeleskope());
+			return OP_FAIL;
+		case GS_WTRACK:
+			if(Sys_Mode == SysTrkOk) return OP_OK;
+			if(!OP_TMOUT(op)) return OP_RUN;
+			WARNX(_("Eror during telescope pointing"));
+			return OP_FAIL;
+		default:
+			return OP_FAIL;
+	}
+}
+
 /**
- * move telecope to object by entered coordinates
+ * prepare moving of telecope to object by entered coordinates
+ * @return OP_RUN if op should be run
  */
-bool gotopos(bool isradec){
-	if(!testauto()) return FALSE;
-	if(Sys_Mode != SysStop && !stop_telescope()) return FALSE;
-	if(isradec){
-		if((fabs(val_A - InpAzim) < Amove && fabs(val_Z - InpZdist) < Zmove)){ // move back to last coords
-			ACS_CMD(MoveToObject());
-		}else{
-			ACS_CMD(GoToObject());
-		}
-		ACS_CMD(SetSysTarg(TagObject));
-	}else{
-		ACS_CMD(GoToAzimZ());
-		ACS_CMD(SetSysTarg(TagPosition));
-	}
-	DBG("start");
-	ACS_CMD(StartTeleskope());
-	usleep(500000);
-#ifndef EMULATION
-	PRINT("Go");
-	WAIT_EVENT((Sys_Mode != SysStop && Sys_Mode != SysWait), WAITING_TMOUT);
-	if(tmout){
-		WARNX(_("Can't move telescope"));
+static op_status goto_prepare(bta_op *op, bool isradec){
+	update_snapshot();
+	memset(op, 0, sizeof(bta_op));
+	op->name = "Telescope";
+	op->step = goto_step;
+	op->mode = isradec;
+	if(!testauto()) return OP_FAIL;
+	op->state = GS_START;
+	if(Sys_Mode != SysStop){
 		ACS_CMD(StopTeleskope());
-		return FALSE;
+		OP_SET(op, GS_STOP, WAITING_TMOUT);
 	}
-	PRINT("Wait for tracking");
-	//  Wait with timeout 15min
-	WAIT_EVENT((Sys_Mode == SysTrkOk), 900.);
-	if(tmout){
-		WARNX(_("Eror during telescope pointing"));
-		return FALSE;
-   }
-#endif
-	return TRUE;
+	return OP_RUN;
+}
+
+/**
+ * move telecope to object by entered coordinates
+ */
+static bool gotopos_unlocked(bool isradec){
+	bta_op op;
+	return run_op(&op, goto_prepare(&op, isradec));
 }
 
 /**
  * set PCS state (TRUE == on)
  */
-bool PCS_state(bool on){
+static bool PCS_state_unlocked(bool on){
+	update_snapshot();
 	int _U_ newstate = PC_Off;
 	if(on){
 		if(Pos_Corr == PC_On) return TRUE;
@@ -532,7 +905,7 @@ bool PCS_state(bool on){
  * if isAZ == TRUE, dx is dA, dy is dZ
  * else dx is dRA, dy is dDecl
  */
-bool run_correction(char *dxdy, bool isAZ){
+static bool run_correction_unlocked(char *dxdy, bool isAZ){
 	double dx, dy;
 	char *eptr = dxdy;
 	if(!myatod(&dx, &eptr) || !*eptr || !*(++eptr)) goto badang;
@@ -569,3 +942,76 @@ badang:
 	WARNX(_("Bad format, need \"dx,dy\" in arcseconds"));
 	return FALSE;
 }
+
+/*
+ * Commands holding their resources
+ */
+bool moveP2(char *arg){
+	LOCKED(RES_P2, moveP2_unlocked(arg));
+}
+
+bool setP2mode(char *arg){
+	LOCKED(RES_P2, setP2mode_unlocked(arg));
+}
+
+bool moveFocus(double val){
+	LOCKED(RES_FOCUS, moveFocus_unlocked(val));
+}
+
+bool setCoords(char *coords, bool isEQ){
+	LOCKED(RES_TEL, setCoords_unlocked(coords, isEQ));
+}
+
+bool azreverce(){
+	LOCKED(RES_TEL, azreverce_unlocked());
+}
+
+bool stop_telescope(){
+	LOCKED(RES_TEL, stop_telescope_unlocked());
+}
+
+bool gotopos(bool isradec){
+	LOCKED(RES_TEL, gotopos_unlocked(isradec));
+}
+
+bool PCS_state(bool on){
+	LOCKED(RES_PCS, PCS_state_unlocked(on));
+}
+
+bool run_correction(char *dxdy, bool isAZ){
+	LOCKED(RES_TEL, run_correction_unlocked(dxdy, isAZ));
+}
+
+/**
+ * Move P2, focus & telescope simultaneously (all of them are independent mechanisms)
+ * @param p2arg  - argument of P2 moving (like in moveP2) or NULL
+ * @param focus  - focus target (<= 0 - don't move)
+ * @param go     - GOTO_RADEC/GOTO_AZ to move telescope (like in gotopos) or GOTO_NONE
+ * @return FALSE if any of motions failed
+ */
+bool run_motions(char *p2arg, double focus, goto_type go){
+	bta_op ops[3], *run[3];
+	bta_resource res[3];
+	int i, n = 0;
+	bool ret = TRUE;
+	double t0 = mtime(), serial = 0.;
+#define ADDOP(r, prepare)  do{if(!res_get(r)){ret = FALSE; break;} \
+		switch(prepare){ \
+			case OP_RUN:  res[n] = r; run[n] = &ops[n]; ++n; break; \
+			case OP_FAIL: ret = FALSE; /* fallthrough */ \
+			default:      res_put(r);}}while(0)
+	if(go != GOTO_NONE) ADDOP(RES_TEL, goto_prepare(&ops[n], go == GOTO_RADEC));
+	if(p2arg)           ADDOP(RES_P2, p2_prepare(&ops[n], p2arg));
+	if(focus > 0.)      ADDOP(RES_FOCUS, focus_prepare(&ops[n], focus));
+#undef ADDOP
+	if(!n) return ret;
+	if(!run_ops(run, n)) ret = FALSE;
+	for(i = 0; i < n; ++i){
+		serial += ops[i].tend - ops[i].tstart;
+		res_put(res[i]);
+	}
+	t0 = mtime() - t0;
+	if(n > 1)
+		PRINT(_("Motions took %.1fs instead of %.1fs one by one (saved %.1fs)\n"), t0, serial, serial - t0);
+	return ret;
+}
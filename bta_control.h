@@ -35,6 +35,20 @@ typedef struct{
 
 extern glob_pars *GP;
 void set_timeout(int delay);
+void update_snapshot();
+
+// statistics of waiting engine
+typedef struct{
+	double period;   // estimated server publishing period (seconds)
+	double latency;  // detection latency of last event (seconds)
+	double duration; // duration of last waiting (seconds)
+	int ticks;       // amount of server ticks during last waiting
+} wait_stat;
+extern wait_stat Wstat;
+void wait_start(int max_delay);
+void wait_tick();
+void wait_end();
+int wait_data(double timeout);
 extern volatile int tmout;
 extern char *iptr;
 extern char indi[];
@@ -49,10 +63,16 @@ bool gotopos(bool isradec);
 bool PCS_state(bool on);
 bool run_correction(char *dxdy, bool isAZ);
 
-#define WAIT_EVENT(evt, max_delay)  do{int __ = 0; set_timeout(max_delay); \
-		PRINT(" "); while(!tmout && !(evt)){ \
-		usleep(100000); if(!*(++iptr)) iptr = indi; if(++__%10==0) PRINT("\b. "); \
-		PRINT("\b%c", *iptr);}; PRINT("\n");}while(0)
+typedef enum{
+	 GOTO_NONE = 0
+	,GOTO_RADEC  // go to last entered RA/Decl
+	,GOTO_AZ     // go to last entered A/Z
+} goto_type;
+bool run_motions(char *p2arg, double focus, goto_type go);
+
+#define WAIT_EVENT(evt, max_delay)  do{wait_start(max_delay); \
+		while(!tmout && (update_snapshot(), !(evt))) wait_tick(); \
+		wait_end();}while(0)
 
 #define PRINT(...) do{if(!GP->quiet) printf(__VA_ARGS__);}while(0)
 
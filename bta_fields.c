@@ -0,0 +1,85 @@
+/*
+ * bta_fields.c - registry of BTA data fields & their lookup by name
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <pthread.h>
+#include <string.h>
+
+#include "bta_shdata.h"
+#include "bta_fields.h"
+#include "usefull_macros.h"
+
+#define BTA_FDESC(name, lvl, flags, store, src, member, type, get, tx, fmt, unit, help) \
+	{#name, lvl, flags, BTA_FSTORE_ ## store, BTA_FSRC_ ## src, BTA_FOFF_ ## src(member), FT_ ## type, unit, help},
+const bta_field bta_fields[] = {
+	BTA_FIELDS(BTA_FDESC)
+	{NULL, 0, 0, 0, 0, 0, 0, NULL, NULL}
+};
+#undef BTA_FDESC
+
+/*
+ * Perfect hash of names: seed is chosen once so that all names get different
+ * cells of table, lookup is one hash & one comparison
+ */
+#define FHASH_SIZE  (1024)  // power of 2, much more than FLD_AMOUNT (else seed is hard to find)
+#define FHASH_SEED  (1)     // good for current fields; next seeds are tried if fields added
+static int16_t fhash[FHASH_SIZE];
+static uint32_t fseed = FHASH_SEED;
+static pthread_once_t fonce = PTHREAD_ONCE_INIT;
+
+// FNV-1a
+static inline uint32_t fnv(const char *s, size_t len, uint32_t seed){
+	uint32_t h = seed;
+	while(len--){
+		h ^= (uint8_t)*s++;
+		h *= 16777619U;
+	}
+	h ^= h >> 16; // mix high bits into low ones used as index
+	h *= 0x85ebca6bU;
+	return h ^ (h >> 13);
+}
+
+static void fhash_init(){
+	int i;
+	for(;; ++fseed){
+		for(i = 0; i < FHASH_SIZE; ++i) fhash[i] = -1;
+		for(i = 0; i < FLD_AMOUNT; ++i){
+			const char *n = bta_fields[i].name;
+			uint32_t h = fnv(n, strlen(n), fseed) & (FHASH_SIZE - 1);
+			if(fhash[h] > -1) break;
+			fhash[h] = (int16_t)i;
+		}
+		if(i == FLD_AMOUNT) break;
+	}
+	DBG("Hash seed: 0x%08x", fseed);
+}
+
+/**
+ * Find field by exact name
+ * @param name - name (not obligatory zero-terminated)
+ * @param len  - its length
+ * @return index of field (FLD_*) or -1
+ */
+int bta_field_idx(const char *name, size_t len){
+	int idx;
+	pthread_once(&fonce, fhash_init);
+	idx = fhash[fnv(name, len, fseed) & (FHASH_SIZE - 1)];
+	if(idx < 0 || strncmp(bta_fields[idx].name, name, len) || bta_fields[idx].name[len]) return -1;
+	return idx;
+}
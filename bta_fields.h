@@ -0,0 +1,179 @@
+/*
+ * bta_fields.h - registry of BTA data fields (one line per field)
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __BTA_FIELDS_H__
+#define __BTA_FIELDS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bta_print.h"
+
+/*
+ * BTA_FIELDS(X): X(name, lvl, flags, store, src, member, type, get, tx, fmt, unit, help)
+ *   name   - field name (`-i` list, serializers, archive columns)
+ *   lvl    - information level of bta_print (0 - shown only if requested by name)
+ *   flags  - FF_OBJ: shown only if target is object; FF_LABEL: text is name of state
+ *   store  - ARC if field is stored in archives, NOARC if not
+ *   src    - D: member of struct BTA_Data, L: of struct BTA_Local, N: only calculated
+ *   member - member of structure (its raw value is stored & used if `get` is NULL)
+ *   type   - DBL, I32 or U32: type of member
+ *   get    - function calculating value[s] shown (in bta_print.c)
+ *   tx     - text formatter (in bta_print.c) & its format `fmt`
+ *   unit   - unit of numbers (times & RA in seconds, angles in arcseconds)
+ * Text output, `-i` selection, serializers & archive columns follow this order.
+ */
+#define BTA_FIELDS(X) \
+X(M_time,       TIME_INFO,      0,        NOARC, D, m_time,         DBL, g_mtime,   tx_time,      NULL,               "s",    "mean solar time") \
+X(S_time,       TIME_INFO,      0,        ARC,   D, s_time,         DBL, g_stime,   tx_time,      NULL,               "s",    "mean sidereal time") \
+X(JDate,        TIME_INFO,      0,        ARC,   D, jdate,          DBL, NULL,      tx_num,       "%.6f",             "d",    "julian date") \
+X(Tel_Mode,     ACS_INFO,       FF_LABEL, ARC,   D, tel_mode,       I32, NULL,      tx_telmode,   NULL,               "",     "telescope mode") \
+X(Sys_Mode,     0,              0,        ARC,   D, system,         I32, NULL,      tx_num,       "%g",               "",     "main system mode (code)") \
+X(Tel_Hardware, 0,              0,        ARC,   D, tel_hard_state, I32, NULL,      tx_num,       "%g",               "",     "telescope power state (code)") \
+X(Tel_State,    0,              0,        ARC,   D, tel_state,      I32, NULL,      tx_num,       "%g",               "",     "telescope state (code)") \
+X(Tel_Focus,    ACS_INFO,       FF_LABEL, ARC,   D, tel_focus,      I32, NULL,      tx_telfocus,  NULL,               "",     "focus mode") \
+X(Tel_Taget,    ACS_INFO,       FF_LABEL, ARC,   D, sys_target,     I32, NULL,      tx_teltarget, NULL,               "",     "current or last telescope target") \
+X(P2_Mode,      ACS_INFO,       FF_LABEL, NOARC, D, p2_state,       I32, NULL,      tx_p2mode,    NULL,               "",     "P2 rotator mode") \
+X(P2_State,     0,              0,        ARC,   D, p2_state,       I32, NULL,      tx_num,       "%g",               "",     "P2 motor state (code)") \
+X(PCS_Coeffs,   ACS_INFO,       0,        NOARC, D, pc_coeff,       DBL, g_pcs,     tx_pcs,       NULL,               "''",   "Precision Correction System coefficients") \
+X(Pos_Corr,     0,              0,        ARC,   D, pcor_mode,      I32, NULL,      tx_num,       "%g",               "",     "pointing correction mode (code)") \
+X(code_KOST,    ACS_INFO,       0,        ARC,   D, kost,           U32, NULL,      tx_kost,      NULL,               "",     "syscodes") \
+X(Az_Reverce,   ACS_INFO,       0,        ARC,   D, az_mode,        I32, NULL,      tx_onoff,     NULL,               "",     "reverce of azimuth direction") \
+X(Az_EndSw,     ACS_INFO,       0,        ARC,   D, pep_sw_a,       U32, NULL,      tx_swA,       NULL,               "",     "Azimuth end-switches") \
+X(Zen_EndSw,    ACS_INFO,       0,        ARC,   D, pep_sw_z,       U32, NULL,      tx_swZ,       NULL,               "",     "Zenith end-switches") \
+X(P2_EndSw,     ACS_INFO,       0,        ARC,   D, pep_sw_p,       U32, NULL,      tx_swP,       NULL,               "",     "P2 end-switches") \
+X(Worm_A,       ACS_INFO,       0,        ARC,   D, worm_a,         DBL, NULL,      tx_num,       "%gmkm",            "mkm",  "worm A position") \
+X(Worm_Z,       ACS_INFO,       0,        ARC,   D, worm_z,         DBL, NULL,      tx_num,       "%gmkm",            "mkm",  "worm Z position") \
+X(Lock_Flags,   ACS_INFO,       0,        ARC,   D, lock_flags,     U32, NULL,      tx_lock,      NULL,               "",     "locked motors") \
+X(Oil_Pres,     ACS_INFO,       0,        NOARC, N, 0,              DBL, g_oil,     tx_num3,      "p(A)=%.1f, p(Z)=%.1f, p(tank)=%.1f", "MPa", "oil pressure in A,Z & tank (Pa)") \
+X(Oil_PresA,    0,              0,        ARC,   L, pr_oil_a,       DBL, NULL,      tx_num,       "%.1f",             "MPa",  "oil pressure in A") \
+X(Oil_PresZ,    0,              0,        ARC,   L, pr_oil_z,       DBL, NULL,      tx_num,       "%.1f",             "MPa",  "oil pressure in Z") \
+X(Oil_PresT,    0,              0,        ARC,   L, pr_oil_t,       DBL, NULL,      tx_num,       "%.1f",             "MPa",  "oil pressure in tank") \
+X(Oil_Temp,     ACS_INFO,       0,        ARC,   L, t_oil_1,        DBL, NULL,      tx_num,       "%.1f",             "degC", "oil temperature (degrC)") \
+X(Oil_Cool_Temp,ACS_INFO,       0,        ARC,   L, t_oil_2,        DBL, NULL,      tx_num,       "%.1f",             "degC", "oil coolant themperature (degrC)") \
+X(CurAlpha,     BASIC_COORDS,   FF_OBJ,   ARC,   D, c_alpha,        DBL, NULL,      tx_time,      NULL,               "s",    "current") \
+X(CurDelta,     BASIC_COORDS,   FF_OBJ,   ARC,   D, c_delta,        DBL, NULL,      tx_angle,     NULL,               "''",   "current") \
+X(SrcAlpha,     BASIC_COORDS,   FF_OBJ,   ARC,   D, s_alpha,        DBL, NULL,      tx_time,      NULL,               "s",    "last source position") \
+X(SrcDelta,     BASIC_COORDS,   FF_OBJ,   ARC,   D, s_delta,        DBL, NULL,      tx_angle,     NULL,               "''",   "last source position") \
+X(InpAlpha,     BASIC_COORDS,   FF_OBJ,   ARC,   D, i_alpha,        DBL, NULL,      tx_time,      NULL,               "s",    "last input value") \
+X(InpDelta,     BASIC_COORDS,   FF_OBJ,   ARC,   D, i_delta,        DBL, NULL,      tx_angle,     NULL,               "''",   "last input value") \
+X(TelAlpha,     BASIC_COORDS,   FF_OBJ,   ARC,   D, val_alp,        DBL, NULL,      tx_time,      NULL,               "s",    "real telescope") \
+X(TelDelta,     BASIC_COORDS,   FF_OBJ,   ARC,   D, val_del,        DBL, NULL,      tx_angle,     NULL,               "''",   "real telescope") \
+X(CurAzim,      BASIC_COORDS,   0,        ARC,   D, tag_a,          DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "current") \
+X(CurZenD,      BASIC_COORDS,   0,        ARC,   D, tag_z,          DBL, NULL,      tx_afmt,      "%02d:%02d:%04.1f", "''",   "current") \
+X(InpAzim,      BASIC_COORDS,   0,        ARC,   D, i_azim,         DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "input") \
+X(InpZenD,      BASIC_COORDS,   0,        ARC,   D, i_zdist,        DBL, NULL,      tx_afmt,      "%02d:%02d:%04.1f", "''",   "input") \
+X(CurPA,        BASIC_COORDS,   0,        ARC,   D, tag_p,          DBL, NULL,      tx_afmt,      "%03d:%02d:%04.1f", "''",   "current") \
+X(SrcPA,        BASIC_COORDS,   0,        NOARC, N, 0,              DBL, g_srcpa,   tx_afmt,      "%03d:%02d:%04.1f", "''",   "source") \
+X(InpPA,        BASIC_COORDS,   0,        NOARC, N, 0,              DBL, g_inppa,   tx_afmt,      "%03d:%02d:%04.1f", "''",   "input") \
+X(TelPA,        BASIC_COORDS,   0,        NOARC, N, 0,              DBL, g_telpa,   tx_afmt,      "%03d:%02d:%04.1f", "''",   "telescope") \
+X(ValFoc,       BASIC_COORDS,   0,        ARC,   D, val_f,          DBL, NULL,      tx_num,       "%0.2f",            "mm",   "focus value") \
+X(ValAzim,      EXTENDED_COORDS,0,        ARC,   D, val_a,          DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "from encoder") \
+X(ValZenD,      EXTENDED_COORDS,0,        ARC,   D, val_z,          DBL, NULL,      tx_afmt,      "%02d:%02d:%04.1f", "''",   "from encoder") \
+X(ValP2,        EXTENDED_COORDS,0,        ARC,   D, val_p,          DBL, NULL,      tx_afmt,      "%03d:%02d:%04.1f", "''",   "from encoder") \
+X(ValDome,      EXTENDED_COORDS,0,        ARC,   D, val_d,          DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "from encoder") \
+X(DiffAzim,     EXTENDED_COORDS,0,        ARC,   D, diff_a,         DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "A difference") \
+X(DiffZenD,     EXTENDED_COORDS,0,        ARC,   D, diff_z,         DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''", "Z difference") \
+X(DiffP2,       EXTENDED_COORDS,0,        ARC,   D, diff_p,         DBL, NULL,      tx_afmt,      "%c%03d:%02d:%04.1f", "''", "P2 difference") \
+X(DiffDome,     EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_diffdome,tx_afmt,      "%c%03d:%02d:%04.1f", "''", "DomeAz difference") \
+X(VelAzim,      EXTENDED_COORDS,0,        ARC,   D, vel_a,          DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''/s", "A velocity") \
+X(VelZenD,      EXTENDED_COORDS,0,        ARC,   D, vel_z,          DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''/s", "Z velocity") \
+X(VelP2,        EXTENDED_COORDS,0,        ARC,   D, vel_p,          DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''/s", "P2 velocity") \
+X(VelPA,        EXTENDED_COORDS,0,        ARC,   D, vbasep,         DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''/s", "object PA velocity") \
+X(VelDome,      EXTENDED_COORDS,0,        ARC,   D, vel_d,          DBL, NULL,      tx_afmt,      "%c%02d:%02d:%04.1f", "''/s", "DomeAz velocity") \
+X(CorrPCS,      EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_corrpcs, tx_corrpcs,   "%c%01d:%02d:%04.1f", "''", "Point Correction System value") \
+X(CorrPCSA,     0,              0,        ARC,   D, tcor_a,         DBL, NULL,      tx_afmt,      "%c%01d:%02d:%04.1f", "''", "Point Correction System value by A") \
+X(CorrPCSZ,     0,              0,        ARC,   D, tcor_z,         DBL, NULL,      tx_afmt,      "%c%01d:%02d:%04.1f", "''", "Point Correction System value by Z") \
+X(Refraction,   EXTENDED_COORDS,0,        ARC,   D, tref_z,         DBL, g_refr,    tx_afmt,      "%c%01d:%02d:%04.1f", "''", "calculated refraction value") \
+X(CorrAlpha,    EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_corralp, tx_afmt,      "%c%01d:%02d:%05.2f", "s",  "correction by RA") \
+X(CorrDelta,    EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_corrdel, tx_afmt,      "%c%01d:%02d:%04.1f", "''", "correction by Decl") \
+X(CorrAzim,     EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_corrA,   tx_afmt,      "%c%01d:%02d:%04.1f", "''", "correction by A") \
+X(CorrZenD,     EXTENDED_COORDS,0,        NOARC, N, 0,              DBL, g_corrZ,   tx_afmt,      "%c%01d:%02d:%04.1f", "''", "correction by Z") \
+X(Foc_State,    EXTENDED_COORDS,FF_LABEL, ARC,   D, focus_state,    I32, NULL,      tx_focstate,  NULL,               "",     "focus motor state") \
+X(polarX,       EXTENDED_COORDS,0,        ARC,   D, xpol,           DBL, NULL,      tx_num,       "%g",               "''",   "X polar motion") \
+X(polarY,       EXTENDED_COORDS,0,        ARC,   D, ypol,           DBL, NULL,      tx_num,       "%g",               "''",   "Y polar motion") \
+X(DUT1,         EXTENDED_COORDS,0,        ARC,   D, dut1,           DBL, NULL,      tx_num,       "%g",               "s",    "UT1 - UTC") \
+X(ValTout,      METEO_INFO,     0,        ARC,   D, val_t1,         DBL, NULL,      tx_num,       "%+05.1f",          "degC", "outern temperature (DegrC)") \
+X(ValTind,      METEO_INFO,     0,        ARC,   D, val_t2,         DBL, NULL,      tx_num,       "%+05.1f",          "degC", "indome temperature (DegrC)") \
+X(ValTmir,      METEO_INFO,     0,        ARC,   D, val_t3,         DBL, NULL,      tx_num,       "%+05.1f",          "degC", "mirror temperature (DegrC)") \
+X(ValPres,      METEO_INFO,     0,        ARC,   D, val_b,          DBL, NULL,      tx_num,       "%+05.1f",          "mmHg", "atm. pressure (mmHg)") \
+X(ValWind,      METEO_INFO,     0,        ARC,   D, val_wnd,        DBL, NULL,      tx_num,       "%04.1f",           "m/s",  "wind speed (m/s)") \
+X(Blast10,      METEO_INFO,     0,        NOARC, N, 0,              DBL, g_blast10, tx_num,       "%.1f",             "min",  "wind blast >=10m/s (minutes ago)") \
+X(Blast15,      METEO_INFO,     0,        NOARC, N, 0,              DBL, g_blast15, tx_num,       "%.1f",             "min",  "wind blast >=15m/s (minutes ago)") \
+X(Precipitation,METEO_INFO,     0,        NOARC, N, 0,              DBL, g_precip,  tx_num,       "%.1f",             "min",  "last precipitation (minutes ago)") \
+X(ValHumd,      METEO_INFO,     0,        ARC,   D, val_hmd,        DBL, NULL,      tx_num,       "%04.1f",           "%",    "Humidity, %") \
+X(SEW_Current,  0,              0,        NOARC, N, 0,              DBL, g_sewcur,  tx_num3,      "%.1f, %.1f, %.1f", "A",    "measured currents of SEW drivers 1-3") \
+X(SEW_Speed,    0,              0,        NOARC, N, 0,              DBL, g_sewvel,  tx_num3,      "%.1f, %.1f, %.1f", "rpm",  "measured speeds of SEW drivers 1-3")
+
+// field flags
+#define FF_OBJ      (1)
+#define FF_LABEL    (2)
+
+// max amount of values of one field
+#define BTA_FLD_MAXVALS  (8)
+
+// helpers to expand BTA_FIELDS columns
+#define BTA_FSRC_D          FS_DATA
+#define BTA_FSRC_L          FS_LOCAL
+#define BTA_FSRC_N          FS_NONE
+#define BTA_FOFF_D(m)       offsetof(struct BTA_Data, m)
+#define BTA_FOFF_L(m)       offsetof(struct BTA_Local, m)
+#define BTA_FOFF_N(m)       0
+#define BTA_FSTORE_ARC      1
+#define BTA_FSTORE_NOARC    0
+
+// index of field: FLD_M_time, FLD_S_time...
+#define BTA_FENUM(name, ...)  FLD_ ## name,
+typedef enum{
+	BTA_FIELDS(BTA_FENUM)
+	FLD_AMOUNT
+} bta_fidx;
+#undef BTA_FENUM
+
+typedef enum{
+	 FS_NONE = 0    // calculated value
+	,FS_DATA        // struct BTA_Data
+	,FS_LOCAL       // struct BTA_Local
+} bta_fsrc;
+
+typedef enum{
+	 FT_DBL = 0
+	,FT_I32
+	,FT_U32
+} bta_ftype;
+
+// description of field (everything but bta_print's functions)
+typedef struct{
+	const char *name;
+	uint32_t lvl;       // info_level
+	uint32_t flags;     // FF_*
+	int stored;         // ==1 if stored in archives
+	bta_fsrc src;       // structure containing field
+	size_t offset;      // offset of member in structure
+	bta_ftype type;     // type of member
+	const char *unit;
+	const char *help;
+} bta_field;
+
+extern const bta_field bta_fields[];
+
+int bta_field_idx(const char *name, size_t len);
+
+#endif // __BTA_FIELDS_H__
@@ -2,13 +2,8 @@
  *
  * copyright: Vladimir Shergin <vsher@sao.ru>
  *
- * Usage:
- *         bta_print [time_step] [file_name]
- * Where:
- *         time_step - writing period in sec., >=1.0
- *                      <1.0 - once and exit (default)
- *         file_name - name of file to write to,
- *                      "-" - stdout (default)
+ * bta_print() prints data once; periodic output into file is made by
+ * run_monitor() (see monitor.c, `--monitor` option)
  */
 /*
  * bta_print.c
@@ -49,14 +44,36 @@
 #include <sys/types.h>
 #include <sys/times.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <strings.h>
 
 #include <crypt.h>
 
 #include "angle_functions.h"
+#include "coords.h"
 #include "bta_shdata.h"
 #include "bta_print.h"
+#include "bta_fields.h"
 #include "usefull_macros.h"
 
+// all values are printed from one coherent copy of shared data
+static struct BTA_Snapshot Snap;
+#define sdt   (&Snap.data)
+#define sdtl  (&Snap.local)
+// ==1 if data loaded from record file
+static int loaded = 0;
+
+/**
+ * Use given data (e.g. from record file) instead of shared memory
+ */
+void bta_print_set(struct BTA_Data *data, struct BTA_Local *local){
+	memcpy(&Snap.data, data, sizeof(struct BTA_Data));
+	memcpy(&Snap.local, local, sizeof(struct BTA_Local));
+	Snap.mtime = data->m_time;
+	Snap.coherent = 1;
+	loaded = 1;
+}
+
 typedef struct{
 	const char *name;
 	const info_level lvl;
@@ -74,587 +91,825 @@ const levelstr const infolevels_str[] = {
 	{NULL, NO_INFO}
 };
 
+uint8_t parameters_to_show[FLD_AMOUNT] = {0};
+
+static const char *str_telmode(){
+	if(Tel_Hardware == Hard_Off) return "Off";
+	if(Tel_Mode != Automatic) return "Manual";
+	switch(Sys_Mode){
+		default:
+		case SysStop    :  return "Stopped";
+		case SysWait    :  return "Waiting";
+		case SysPointAZ :
+		case SysPointAD :  return "Pointing";
+		case SysTrkStop :
+		case SysTrkStart:
+		case SysTrkMove :
+		case SysTrkSeek :  return "Seeking";
+		case SysTrkOk   :  return "Tracking";
+		case SysTrkCorr :  return "Correction";
+		case SysTest    :  return "Testing";
+	}
+}
+
+static const char *str_telfocus(){
+	switch(Tel_Focus){
+		default:
+		case Prime    :  return "Prime";
+		case Nasmyth1 :  return "Nasmyth1";
+		case Nasmyth2 :  return "Nasmyth2";
+	}
+}
+
+static const char *str_teltarget(){
+	switch(Sys_Target) {
+		default:
+		case TagObject   :  return "Object";
+		case TagPosition :  return "A/Z-Pos.";
+		case TagNest     :  return "Nest";
+		case TagZenith   :  return "Zenith";
+		case TagHorizon  :  return "Horizon";
+	}
+}
+
+static const char *str_p2mode(){
+	if(Tel_Hardware != Hard_On) return "Off";
+	switch (P2_State) {
+		default:
+		case P2_Off   :  return "Stop";
+		case P2_On    :  return "Track";
+		case P2_Plus  :  return "Move+";
+		case P2_Minus :  return "Move-";
+	}
+}
+
+static const char *str_focstate(){
+	switch(Foc_State){
+		case Foc_Hminus :
+		case Foc_Hplus  : return "fast move";
+		case Foc_Lminus :
+		case Foc_Lplus  : return "slow move";
+		default         : return "stopped";
+	}
+}
+
+// corrections while tracking (all zeros in other modes), ''
 typedef struct{
-	const char *name;
-	const int pos_idx;
-}parstr;
-
-// ./btatest -l|awk "{print  \"\tPAR_\"\$1\",\" }"
-typedef enum{
-	PAR_M_time,
-	PAR_S_time,
-	PAR_JDate,
-	PAR_Tel_Mode,
-	PAR_Tel_Focus,
-	PAR_Tel_Taget,
-	PAR_P2_Mode,
-	PAR_PCS_Coeffs,
-	PAR_code_KOST,
-	PAR_Az_Reverce,
-	PAR_Az_EndSw,
-	PAR_Zen_EndSw,
-	PAR_P2_EndSw,
-	PAR_Worm_A,
-	PAR_Worm_Z,
-	PAR_Lock_Flags,
-	PAR_Oil_Pres,
-	PAR_Oil_Temp,
-	PAR_Oil_Cool_Temp,
-	PAR_CurAlpha,
-	PAR_CurDelta,
-	PAR_SrcAlpha,
-	PAR_SrcDelta,
-	PAR_InpAlpha,
-	PAR_InpDelta,
-	PAR_TelAlpha,
-	PAR_TelDelta,
-	PAR_CurAzim,
-	PAR_CurZenD,
-	PAR_InpAzim,
-	PAR_InpZenD,
-	PAR_CurPA,
-	PAR_SrcPA,
-	PAR_InpPA,
-	PAR_TelPA,
-	PAR_ValFoc,
-	PAR_ValAzim,
-	PAR_ValZenD,
-	PAR_ValP2,
-	PAR_ValDome,
-	PAR_DiffAzim,
-	PAR_DiffZenD,
-	PAR_DiffP2,
-	PAR_DiffDome,
-	PAR_VelAzim,
-	PAR_VelZenD,
-	PAR_VelP2,
-	PAR_VelPA,
-	PAR_VelDome,
-	PAR_CorrPCS,
-	PAR_Refraction,
-	PAR_CorrAlpha,
-	PAR_CorrDelta,
-	PAR_CorrAzim,
-	PAR_CorrZenD,
-	PAR_Foc_State,
-	PAR_polarX,
-	PAR_polarY,
-	PAR_DUT1,
-	PAR_ValTout,
-	PAR_ValTind,
-	PAR_ValTmir,
-	PAR_ValPres,
-	PAR_ValWind,
-	PAR_Blast10,
-	PAR_Blast15,
-	PAR_Precipitation,
-	PAR_ValHumd,
-	PAR_bta_pars_end
-}bta_pars;
-
-uint8_t parameters_to_show[PAR_bta_pars_end] = {0};
-
-// ./btatest -l|awk "{print  \"\t\{\\\"\"\$1\"\\\", PAR_\"\$1\"\},\" }"
-const parstr const parameters_str[] = {
-	{"M_time", PAR_M_time},
-	{"S_time", PAR_S_time},
-	{"JDate", PAR_JDate},
-	{"Tel_Mode", PAR_Tel_Mode},
-	{"Tel_Focus", PAR_Tel_Focus},
-	{"Tel_Taget", PAR_Tel_Taget},
-	{"P2_Mode", PAR_P2_Mode},
-	{"PCS_Coeffs", PAR_PCS_Coeffs},
-	{"code_KOST", PAR_code_KOST},
-	{"Az_Reverce", PAR_Az_Reverce},
-	{"Az_EndSw", PAR_Az_EndSw},
-	{"Zen_EndSw", PAR_Zen_EndSw},
-	{"P2_EndSw", PAR_P2_EndSw},
-	{"Worm_A", PAR_Worm_A},
-	{"Worm_Z", PAR_Worm_Z},
-	{"Lock_Flags", PAR_Lock_Flags},
-	{"Oil_Pres", PAR_Oil_Pres},
-	{"Oil_Temp", PAR_Oil_Temp},
-	{"Oil_Cool_Temp", PAR_Oil_Cool_Temp},
-	{"CurAlpha", PAR_CurAlpha},
-	{"CurDelta", PAR_CurDelta},
-	{"SrcAlpha", PAR_SrcAlpha},
-	{"SrcDelta", PAR_SrcDelta},
-	{"InpAlpha", PAR_InpAlpha},
-	{"InpDelta", PAR_InpDelta},
-	{"TelAlpha", PAR_TelAlpha},
-	{"TelDelta", PAR_TelDelta},
-	{"CurAzim", PAR_CurAzim},
-	{"CurZenD", PAR_CurZenD},
-	{"InpAzim", PAR_InpAzim},
-	{"InpZenD", PAR_InpZenD},
-	{"CurPA", PAR_CurPA},
-	{"SrcPA", PAR_SrcPA},
-	{"InpPA", PAR_InpPA},
-	{"TelPA", PAR_TelPA},
-	{"ValFoc", PAR_ValFoc},
-	{"ValAzim", PAR_ValAzim},
-	{"ValZenD", PAR_ValZenD},
-	{"ValP2", PAR_ValP2},
-	{"ValDome", PAR_ValDome},
-	{"DiffAzim", PAR_DiffAzim},
-	{"DiffZenD", PAR_DiffZenD},
-	{"DiffP2", PAR_DiffP2},
-	{"DiffDome", PAR_DiffDome},
-	{"VelAzim", PAR_VelAzim},
-	{"VelZenD", PAR_VelZenD},
-	{"VelP2", PAR_VelP2},
-	{"VelPA", PAR_VelPA},
-	{"VelDome", PAR_VelDome},
-	{"CorrPCS", PAR_CorrPCS},
-	{"Refraction", PAR_Refraction},
-	{"CorrAlpha", PAR_CorrAlpha},
-	{"CorrDelta", PAR_CorrDelta},
-	{"CorrAzim", PAR_CorrAzim},
-	{"CorrZenD", PAR_CorrZenD},
-	{"Foc_State", PAR_Foc_State},
-	{"ValTout", PAR_ValTout},
-	{"ValTind", PAR_ValTind},
-	{"ValTmir", PAR_ValTmir},
-	{"ValPres", PAR_ValPres},
-	{"ValWind", PAR_ValWind},
-	{"Blast10", PAR_Blast10},
-	{"Blast15", PAR_Blast15},
-	{"Precipitation", PAR_Precipitation},
-	{"ValHumd", PAR_ValHumd},
-	{NULL, 0}
+	double Alp, Del;        // by RA (in seconds of time) & Decl
+	double A, Z;            // by A/Z
+	double PCSA, PCSZ, refr;// PCS & refraction
+} corrections;
+
+static void get_corrections(corrections *c){
+	memset(c, 0, sizeof(corrections));
+	if(Sys_Mode == SysTrkSeek || Sys_Mode == SysTrkOk || Sys_Mode == SysTrkCorr){
+		double curA,curZ,srcA,srcZ;
+		c->Alp = CurAlpha-SrcAlpha;
+		c->Del = CurDelta-SrcDelta;
+		if(c->Alp >  23*3600.) c->Alp -= 24*3600.;
+		if(c->Alp < -23*3600.) c->Alp += 24*3600.;
+		calc_AZ(SrcAlpha, SrcDelta, S_time, &srcA, &srcZ);
+		calc_AZ(CurAlpha, CurDelta, S_time, &curA, &curZ);
+		c->A = curA - srcA;
+		c->Z = curZ - srcZ;
+		c->PCSA = tel_cor_A; c->PCSZ = tel_cor_Z; c->refr = tel_ref_Z;
+	}
+}
+
+// minutes since last wind blasts & precipitation (-1 if unknown)
+static void get_blasts(double *w10, double *w15, double *pre){
+	*w10 = *w15 = *pre = -1.;
+	if(Wnd10_time > 0.1 && Wnd10_time <= M_time){
+		*w10 = (M_time-Wnd10_time)/60.;
+		*w15 = (M_time-Wnd15_time)/60.;
+	}
+	if(Precip_time > 0.1 && Precip_time <= M_time)
+		*pre = (M_time-Precip_time)/60.;
+}
+/*******************************************************************************
+*            Values & text of fields (see BTA_FIELDS in bta_fields.h)          *
+*******************************************************************************/
+// calculated values: put value[s] into v, return their amount
+static int g_mtime(double *v){ *v = M_time + DUT1; return 1; }
+static int g_stime(double *v){ *v = S_time - EE_time; return 1; }
+static int g_pcs(double *v){
+	int i;
+	for(i = 0; i < 8; ++i) v[i] = PosCor_Coeff[i];
+	return 8;
+}
+static int g_oil(double *v){
+	v[0] = PressOilA; v[1] = PressOilZ; v[2] = PressOilTank;
+	return 3;
+}
+static int g_sewcur(double *v){
+	v[0] = currentSEW1; v[1] = currentSEW2; v[2] = currentSEW3;
+	return 3;
+}
+static int g_sewvel(double *v){
+	v[0] = vel_SEW1; v[1] = vel_SEW2; v[2] = vel_SEW3;
+	return 3;
+}
+static int g_srcpa(double *v){ *v = calc_PA(SrcAlpha, SrcDelta, S_time); return 1; }
+static int g_inppa(double *v){ *v = calc_PA(InpAlpha, InpDelta, S_time); return 1; }
+static int g_telpa(double *v){ *v = calc_PA(val_Alp, val_Del, S_time); return 1; }
+static int g_diffdome(double *v){ *v = val_A - val_D; return 1; }
+static int g_corrpcs(double *v){
+	corrections C;
+	get_corrections(&C);
+	v[0] = C.PCSA; v[1] = C.PCSZ;
+	return 2;
+}
+#define GCORR(fn, fld) static int fn(double *v){corrections C; get_corrections(&C); *v = C.fld; return 1;}
+GCORR(g_refr, refr)
+GCORR(g_corralp, Alp)
+GCORR(g_corrdel, Del)
+GCORR(g_corrA, A)
+GCORR(g_corrZ, Z)
+#undef GCORR
+static int g_blast10(double *v){ double w15, pre; get_blasts(v, &w15, &pre); return 1; }
+static int g_blast15(double *v){ double w10, pre; get_blasts(&w10, v, &pre); return 1; }
+static int g_precip(double *v){ double w10, w15; get_blasts(&w10, &w15, v); return 1; }
+
+// text formatters: put text of value[s] `v` into `buf` of length `l`
+#define TXARGS  const char _U_ *fmt, const double _U_ *v, char *buf, size_t l
+static void tx_time(TXARGS){ snprintf(buf, l, "%s", time_asc(*v)); }
+static void tx_angle(TXARGS){ snprintf(buf, l, "%s", angle_asc(*v)); }
+static void tx_afmt(TXARGS){ snprintf(buf, l, "%s", angle_fmt(*v, (char*)fmt)); }
+static void tx_num(TXARGS){ snprintf(buf, l, fmt, *v); }
+static void tx_num3(TXARGS){ snprintf(buf, l, fmt, v[0], v[1], v[2]); }
+static void tx_onoff(TXARGS){ snprintf(buf, l, "%s", *v ? "On" : "Off"); }
+#define TXLABEL(fn) static void tx_ ## fn(TXARGS){ snprintf(buf, l, "%s", str_ ## fn()); }
+TXLABEL(telmode)
+TXLABEL(telfocus)
+TXLABEL(teltarget)
+TXLABEL(p2mode)
+TXLABEL(focstate)
+#undef TXLABEL
+
+// add formatted string to buffer
+#define TXADD(...) do{int _n = snprintf(buf, l, __VA_ARGS__); \
+	if(_n > 0 && (size_t)_n < l){buf += _n; l -= (size_t)_n;}}while(0)
+
+static void tx_pcs(TXARGS){
+	int i;
+	if(!Pos_Corr){
+		snprintf(buf, l, "Off");
+		return;
+	}
+	*buf = 0;
+	for(i = 0; i < 8; ++i) TXADD("%.2f%s", v[i], (i == 7) ? "" : ",");
+}
+
+static void tx_corrpcs(TXARGS){
+	TXADD("A=%s, ", angle_fmt(v[0], (char*)fmt));
+	TXADD("Z=%s", angle_fmt(v[1], (char*)fmt));
+}
+
+static void tx_kost(TXARGS){
+	uint32_t k = (uint32_t)*v;
+	TXADD("0x%04X", k);
+	if(!k) return;
+	TXADD(": ");
+	if(k & 0x8000) TXADD("A>0 ");
+	if(k & 0x4000) TXADD("PowerOn ");
+	if(k & 0x2000) TXADD("Guiding ");
+	if(k & 0x1000) TXADD("P2On ");
+	if(k & 0x01F0){
+		TXADD("CorrSpd=");
+		if(k & 0x0010) TXADD("0.2");
+		else if(k & 0x0020) TXADD("0.4");
+		else if(k & 0x0040) TXADD("1.0");
+		else if(k & 0x0080) TXADD("2.0");
+		else if(k & 0x0100) TXADD("5.0");
+		TXADD("''/s ");
+	}
+	if(k & 0x000F){
+		if(k & 0x0001) TXADD("Z+");
+		else if(k & 0x0002) TXADD("Z-");
+		else if(k & 0x0004) TXADD("A+");
+		else if(k & 0x0008) TXADD("A-");
+	}
+}
+
+static void tx_swA(TXARGS){
+	uint32_t s = (uint32_t)*v;
+	if(!s){ snprintf(buf, l, "Off"); return; }
+	*buf = 0;
+	if(s & Sw_minus_A)   TXADD("A<0 ");
+	if(s & Sw_plus240_A) TXADD("A=+240 ");
+	if(s & Sw_minus240_A)TXADD("A=-240 ");
+	if(s & Sw_minus45_A) TXADD("horizon");
+}
+
+static void tx_swZ(TXARGS){
+	uint32_t s = (uint32_t)*v;
+	if(!s){ snprintf(buf, l, "Off"); return; }
+	*buf = 0;
+	if(s & Sw_0_Z)  TXADD("Zenith ");
+	if(s & Sw_5_Z)  TXADD("Z<=5 ");
+	if(s & Sw_20_Z) TXADD("Z<=20 ");
+	if(s & Sw_60_Z) TXADD("Z>=60 ");
+	if(s & Sw_80_Z) TXADD("Z>=80 ");
+	if(s & Sw_90_Z) TXADD("Z=90 ");
+}
+
+static void tx_swP(TXARGS){
+	uint32_t s = (uint32_t)*v;
+	if(!s){ snprintf(buf, l, "Off"); return; }
+	*buf = 0;
+	if(s & Sw_22_P) TXADD("22degr ");
+	if(s & Sw_89_P) TXADD("89degr ");
+	if(s & Sw_Sm_P) TXADD("SMOKE");
+}
+
+static void tx_lock(TXARGS){
+	uint32_t f = (uint32_t)*v;
+	if(!f){ snprintf(buf, l, "Off"); return; }
+	*buf = 0;
+	if(f & Lock_A) TXADD("A ");
+	if(f & Lock_Z) TXADD("Z ");
+	if(f & Lock_P) TXADD("P2 ");
+	if(f & Lock_F) TXADD("F ");
+	if(f & Lock_D) TXADD("D ");
+}
+#undef TXADD
+#undef TXARGS
+
+// functions of fields
+typedef struct{
+	int (*get)(double *v);
+	void (*tx)(const char *fmt, const double *v, char *buf, size_t l);
+	const char *fmt;
+} fieldfn;
+
+#define BTA_FFN(name, lvl, flags, store, src, member, type, get, tx, fmt, ...) {get, tx, fmt},
+static const fieldfn fieldfns[] = {
+	BTA_FIELDS(BTA_FFN)
 };
+#undef BTA_FFN
 
+/**
+ * Get value[s] of field from snapshot
+ * @param idx - index of field
+ * @param v   - array of BTA_FLD_MAXVALS values
+ * @return amount of values
+ */
+static int field_values(int idx, double *v){
+	const bta_field *f = &bta_fields[idx];
+	const uint8_t *base;
+	if(fieldfns[idx].get) return fieldfns[idx].get(v);
+	base = (f->src == FS_LOCAL) ? (const uint8_t*)&Snap.local : (const uint8_t*)&Snap.data;
+	base += f->offset;
+	switch(f->type){
+		case FT_I32: *v = *(const int32_t*)base;  break;
+		case FT_U32: *v = *(const uint32_t*)base; break;
+		default:     *v = *(const double*)base;
+	}
+	return 1;
+}
 
-#ifndef M_PI
-#define M_PI (3.14159265358979323846)
-#endif
+/**
+ * Select fields by exact names
+ * @param list - names divided by any other symbols
+ * @param sel  - array of FLD_AMOUNT flags
+ * @return amount of fields selected
+ */
+static int select_fields(const char *list, uint8_t *sel){
+	int n = 0;
+	memset(sel, 0, FLD_AMOUNT);
+	while(*list){
+		const char *s;
+		int idx;
+		while(*list && !isalnum((uint8_t)*list) && *list != '_') ++list;
+		s = list;
+		while(isalnum((uint8_t)*list) || *list == '_') ++list;
+		if(list == s) break;
+		if((idx = bta_field_idx(s, (size_t)(list - s))) < 0){
+			WARNX(_("Unknown parameter %.*s"), (int)(list - s), s);
+			continue;
+		}
+		sel[idx] = 1;
+		++n;
+	}
+	return n;
+}
 
-#define R2D  (180./M_PI)     // rad. to degr.
-#define D2R  (M_PI/180.)     // degr. to rad.
-#define R2S  (648000./M_PI)  // rad. to sec
-#define S2R  (M_PI/648000.)  // sec. to rad.
-#define S360 (1296000.)    // sec in 360degr
-
-
-// By google maps: 43.646683 (43 38 48.0588), 41.440681 (41 26 26.4516)
-// (real coordinates should be measured relative to mass center, not geoid)
-const double longitude = 149189.175;   // SAO longitude 41 26 29.175 (-2:45:45.945)
-const double Fi = 157152.7;            // SAO latitude 43 39 12.7
-const double cos_fi = 0.7235272793;    // Cos of SAO latitude
-const double sin_fi = 0.6902957888;    // Sin  ---  ""  -----
-
-void calc_AZ(double alpha, double delta, double stime, double *az, double *zd){
-	double sin_t,cos_t, sin_d,cos_d,  cos_z;
-	double t, d, z, a, x, y;
-
-	t = (stime - alpha) * 15.;
-	if (t < 0.)
-	t += S360;      // +360degr
-	t *= S2R;          // -> rad
-	d = delta * S2R;
-	sincos(t, &sin_t, &cos_t);
-	sincos(d, &sin_d, &cos_d);
-
-	cos_z = cos_fi * cos_d * cos_t + sin_fi * sin_d;
-	z = acos(cos_z);
-
-	y = cos_d * sin_t;
-	x = cos_d * sin_fi * cos_t - cos_fi * sin_d;
-	a = atan2(y, x);
-
-	*zd = z * R2S;
-	*az = a * R2S;
-}
-
-double calc_PA(double alpha, double delta, double stime){
-	double sin_t,cos_t, sin_d,cos_d;
-	double t, d, p, sp, cp;
-
-	t = (stime - alpha) * 15.;
-	if (t < 0.)
-		t += S360;      // +360degr
-	t *= S2R;          // -> rad
-	d = delta * S2R;
-	sin_t = sin(t);
-	cos_t = cos(t);
-	sin_d = sin(d);
-	cos_d = cos(d);
-
-	sp = sin_t * cos_fi;
-	cp = sin_fi * cos_d - sin_d * cos_fi * cos_t;
-	p = atan2(sp, cp);
-	if (p < 0.0)
-		p += 2.0*M_PI;
-
-	return(p * R2S);
-}
-
-void calc_AD(double az, double zd, double stime, double *alpha, double *delta){
-	double sin_d, sin_a, cos_a, sin_z, cos_z;
-	double t, d, z, a, x, y;
-	a = az * S2R;
-	z = zd * S2R;
-	sin_a = sin(a);
-	cos_a = cos(a);
-	sin_z = sin(z);
-	cos_z = cos(z);
-
-	y = sin_z * sin_a;
-	x = cos_a * sin_fi * sin_z + cos_fi * cos_z;
-	t = atan2(y, x);
-	if (t < 0.0)
-		t += 2.0*M_PI;
-
-	sin_d = sin_fi * cos_z - cos_fi * cos_a * sin_z;
-	d = asin(sin_d);
-
-	*delta = d * R2S;
-	*alpha = (stime - t * R2S / 15.);
-	if (*alpha < 0.0)
-		*alpha += S360/15.;      // +24h
-}
-
-void my_sleep(double dt){
-	int nfd;
-	struct timeval tv;
-	tv.tv_sec = (int)dt;
-	tv.tv_usec = (int)((dt - tv.tv_sec)*1000000.);
-slipping:
-	nfd = select(0, (fd_set *)NULL,(fd_set *)NULL,(fd_set *)NULL, &tv);
-	if(nfd < 0) {
-		if(errno == EINTR)
-		/*On  Linux,  timeout  is  modified to reflect the amount of
-		time not slept; most other implementations DO NOT do this!*/
-			goto slipping;
-		fprintf(stderr,"Error in mydelay(){ select() }. %s\n",strerror(errno));
+/*******************************************************************************
+*                      Machine-readable output                                 *
+*******************************************************************************/
+/*
+ * Whole snapshot is rendered into one static buffer & written by one write(),
+ * numbers are printed as is (times & RA in seconds, angles in '', see -l for
+ * list), state fields are strings in JSON/CSV & codes in binary.
+ */
+static print_format Pfmt = PF_TEXT;
+static int Pfd = STDOUT_FILENO;  // output file descriptor
+static double Pstamp = -1.;      // UNIX time of sample (<0 - don't show)
+static int csvhdr = 0;           // CSV header was written into Pfd
+
+static const char *formats[] = {
+	[PF_TEXT] = "text",
+	[PF_JSON] = "json",
+	[PF_CSV]  = "csv",
+	[PF_BIN]  = "bin",
+};
+
+/**
+ * Set output format of bta_print()
+ * @param name - "text", "json", "csv" or "bin" (NULL - text)
+ * @return 0 if format is unknown
+ */
+int bta_print_format(const char *name){
+	int i;
+	if(!name){
+		Pfmt = PF_TEXT;
+		return 1;
 	}
+	for(i = 0; i < PF_AMOUNT; ++i)
+		if(strcasecmp(name, formats[i]) == 0){
+			Pfmt = (print_format)i;
+			return 1;
+		}
+	WARNX(_("Unknown output format %s, should be text, json, csv or bin"), name);
+	return 0;
 }
 
 /**
- * print requested information
- * @param lvl      - requested information level
- * @param par_list - list of parameters (any separator) if lvl == REQUESTED_LIST
- * @return 0 in case of some error
+ * Set output of bta_print()
+ * @param fd - file descriptor to write into (CSV header will be repeated)
  */
-int bta_print(info_level lvl, char *par_list){
-	int i, verb = 1, sel = 0;
-	char *value = NULL;
-	DBG("lvl: 0x%X, list: %s", lvl, par_list);
-	if(lvl == NO_INFO && par_list) lvl = REQUESTED_LIST;
-	else if(lvl == REQUESTED_LIST && !par_list) return 0;
-	if(lvl == REQUESTED_LIST){
-		parstr *ptr = (parstr*)parameters_str;
-		while(ptr->name){
-			if(strstr(par_list, ptr->name))
-				parameters_to_show[ptr->pos_idx] = 1;
-			++ptr;
+void bta_print_output(int fd){
+	Pfd = fd;
+	csvhdr = 0;
+}
+
+/**
+ * Set timestamp of next samples (shown as `Sample_time` before other fields;
+ * binary header has M_time only)
+ * @param t - UNIX time of sample, <0 - don't show
+ */
+void bta_print_stamp(double t){
+	if((t < 0.) != (Pstamp < 0.)) csvhdr = 0;
+	Pstamp = t;
+}
+
+/*
+ * After keyframe (all selected fields) only fields changed more than their dead-band
+ * since they were shown last time are output; keyframe is repeated each Dkeyper
+ * seconds, so consumers could resynchronize. Dead-band is compared with last shown
+ * value, so slow drift is shown too.
+ */
+static double Dkeyper = -1.;      // keyframe period (seconds), 0 - only first, <0 - delta output off
+static double Dnextkey = 0.;      // time of next keyframe
+static double Dband[FLD_AMOUNT];  // dead-bands of fields
+static double Dlast[FLD_AMOUNT][BTA_FLD_MAXVALS]; // values shown last time
+static int Dlastn[FLD_AMOUNT];    // amount of values in Dlast
+
+// default dead-bands by unit (other fields are shown on any change)
+static const struct{
+	const char *unit;
+	double band;
+} dbands[] = {
+	{"''",   0.01},
+	{"''/s", 0.01},
+	{"s",    0.001},
+	{"degC", 0.1},
+	{"mmHg", 0.1},
+	{"m/s",  0.1},
+	{"MPa",  0.05},
+	{"%",    0.5},
+	{"mkm",  0.1},
+	{"mm",   0.001},
+	{"A",    0.1},
+	{"rpm",  1.},
+};
+
+/**
+ * Turn on change-only output of bta_print()
+ * @param keyper - period of keyframes (seconds), 0 - only first one, <0 - turn off
+ * @param bands  - dead-bands "Name=value[,Name=value...]" replacing defaults (or NULL)
+ * @return 0 if `bands` is wrong
+ */
+int bta_print_delta(double keyper, const char *bands){
+	size_t i, j;
+	Dkeyper = keyper;
+	Dnextkey = 0.;
+	csvhdr = 0;
+	memset(Dlastn, 0, sizeof(Dlastn));
+	for(i = 0; i < FLD_AMOUNT; ++i){
+		Dband[i] = 0.;
+		for(j = 0; j < sizeof(dbands) / sizeof(dbands[0]); ++j)
+			if(strcmp(bta_fields[i].unit, dbands[j].unit) == 0) Dband[i] = dbands[j].band;
+	}
+	while(bands && *bands){
+		const char *s;
+		char *e;
+		int idx;
+		double b;
+		while(*bands && !isalnum((uint8_t)*bands) && *bands != '_') ++bands;
+		s = bands;
+		while(isalnum((uint8_t)*bands) || *bands == '_') ++bands;
+		if(bands == s) break;
+		if((idx = bta_field_idx(s, (size_t)(bands - s))) < 0){
+			WARNX(_("Unknown parameter %.*s"), (int)(bands - s), s);
+			return 0;
 		}
-		lvl = ALL_INFO;
-		sel = 1;
+		if(*bands != '=' || (b = strtod(bands + 1, &e), e == bands + 1) || b < 0.){
+			WARNX(_("Dead-band should be given as Name=value (value >= 0)"));
+			return 0;
+		}
+		Dband[idx] = b;
+		bands = e;
 	}
-	if(lvl == NO_INFO){ // show all parameters but without values
-		lvl = ALL_INFO;
-		verb = 0;
+	return 1;
+}
+
+// ==1 if value changed more than dead-band `b`
+static int changed(double v, double last, double b){
+	if(isnan(v) || isnan(last)) return isnan(v) != isnan(last);
+	return fabs(v - last) > b;
+}
+
+/**
+ * Select fields changed since last output
+ * @param sel - array of FLD_AMOUNT flags: fields selected
+ * @param chg - (o) fields to show
+ * @return 1 if it's keyframe, 0 if there are changes, -1 if nothing changed
+ */
+static int delta_select(const uint8_t *sel, uint8_t *chg){
+	double v[BTA_FLD_MAXVALS], t = dtime();
+	int f, i, n, key = 0, nchg = 0;
+	if(t >= Dnextkey){
+		key = 1;
+		if(Dkeyper <= 0.) Dnextkey = INFINITY;
+		else if(t - Dnextkey < Dkeyper) Dnextkey += Dkeyper; // keep keyframes cadence
+		else Dnextkey = t + Dkeyper;
 	}
-#define FMSG(par,hlp, ...)  do{if(!sel || parameters_to_show[PAR_ ## par]){printf("\n" #par);if(verb){printf("=\""); \
-		printf(__VA_ARGS__);printf("\"");}else printf(" (" hlp ")");}}while(0)
-#define SMSG(par,hlp, str)  do{if(!sel || parameters_to_show[PAR_ ## par]){printf("\n" #par); if(verb)printf("=\"%s\"",str);\
-		else printf(" (" hlp ")");}}while(0)
-
-/****************************** TIME_INFO *************************************/
-	if(lvl & TIME_INFO){
-		SMSG(M_time, "mean solar time", time_asc(M_time + DUT1));
-#ifdef EE_time
-		SMSG(S_time, "mean sidereal time", time_asc(S_time - EE_time));
-		FMSG(JDate, "julian date", "%.6f", JDate);
-#else
-		SMSG(S_time, "mean sidereal time", time_asc(S_time));
-#endif
+	for(f = 0; f < FLD_AMOUNT; ++f){
+		chg[f] = 0;
+		if(!sel[f]) continue;
+		n = field_values(f, v);
+		if(!key && n == Dlastn[f]){
+			for(i = 0; i < n; ++i)
+				if(changed(v[i], Dlast[f][i], Dband[f])) break;
+			if(i == n) continue;
+		}
+		chg[f] = 1;
+		++nchg;
+		Dlastn[f] = n;
+		memcpy(Dlast[f], v, (size_t)n * sizeof(double));
 	}
+	if(key) return 1;
+	return nchg ? 0 : -1;
+}
 
-/******************************** ACS_INFO ************************************/
-	if(lvl & ACS_INFO){
-		if(verb){
-			if(Tel_Hardware == Hard_Off) value = "Off";
-			else if(Tel_Mode != Automatic) value = "Manual";
-			else{
-				switch(Sys_Mode){
-					default:
-					case SysStop    :  value = "Stopped";   break;
-					case SysWait    :  value = "Waiting";   break;
-					case SysPointAZ :
-					case SysPointAD :  value = "Pointing";  break;
-					case SysTrkStop :
-					case SysTrkStart:
-					case SysTrkMove :
-					case SysTrkSeek :  value = "Seeking";   break;
-					case SysTrkOk   :  value = "Tracking";  break;
-					case SysTrkCorr :  value = "Correction";break;
-					case SysTest    :  value = "Testing";   break;
-				}
-			}
+// all names & strings are short, so whole snapshot always fits
+#define SER_BUFSZ  (65536)
+static char sbuf[SER_BUFSZ] __attribute__((aligned(8)));
+static char *sptr;
+#define SLEFT()  ((size_t)(sbuf + SER_BUFSZ - sptr))
+
+static void sputs(const char *s){
+	size_t l = strlen(s);
+	if(l >= SLEFT()) l = SLEFT() - 1;
+	memcpy(sptr, s, l);
+	sptr += l;
+}
+
+static void sputc(char c){
+	if(SLEFT() > 1) *sptr++ = c;
+}
+
+static void sprint(const char *fmt, ...){
+	va_list ap;
+	int l;
+	va_start(ap, fmt);
+	l = vsnprintf(sptr, SLEFT(), fmt, ap);
+	va_end(ap);
+	if(l > 0) sptr += ((size_t)l < SLEFT()) ? (size_t)l : SLEFT() - 1;
+}
+
+// text value of field `idx` with values `v`
+static void sputtext(int idx, const double *v){
+	*sptr = 0;
+	fieldfns[idx].tx(fieldfns[idx].fmt, v, sptr, SLEFT());
+	sptr += strlen(sptr);
+}
+
+static void sputnum(double v){
+	int l;
+	if(!isfinite(v)){
+		sputs(Pfmt == PF_JSON ? "null" : "nan");
+		return;
+	}
+	if(v == (double)(int64_t)v && fabs(v) < 1e12 && SLEFT() > 16){ // integers are often: print them fast
+		char tmp[16], *t = tmp + 16;
+		int64_t x = (int64_t)v;
+		if(x < 0){
+			*sptr++ = '-';
+			x = -x;
 		}
-		SMSG(Tel_Mode, "telescope mode", value);
-		if(verb){
-			switch(Tel_Focus){
-				default:
-				case Prime    :  value = "Prime";     break;
-				case Nasmyth1 :  value = "Nasmyth1";  break;
-				case Nasmyth2 :  value = "Nasmyth2";  break;
-			}
+		do{ *--t = '0' + (char)(x % 10); x /= 10; }while(x);
+		l = (int)(tmp + 16 - t);
+		memcpy(sptr, t, (size_t)l);
+		sptr += l;
+		return;
+	}
+	l = snprintf(sptr, SLEFT(), "%.12g", v);
+	if(l > 0 && (size_t)l < SLEFT()) sptr += l;
+}
+
+// write whole buffer by one write()
+static int swrite(const char *buf, size_t len){
+	fflush(stdout);
+	while(len){
+		ssize_t n = write(Pfd, buf, len);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			WARN("write()");
+			return 0;
 		}
-		SMSG(Tel_Focus, "focus mode", value);
-		if(verb){
-			switch(Sys_Target) {
-				default:
-				case TagObject   :  value = "Object";   break;
-				case TagPosition :  value = "A/Z-Pos."; break;
-				case TagNest     :  value = "Nest";     break;
-				case TagZenith   :  value = "Zenith";   break;
-				case TagHorizon  :  value = "Horizon";  break;
+		buf += n; len -= (size_t)n;
+	}
+	return 1;
+}
+
+/**
+ * Render selected fields of current snapshot in format Pfmt
+ *   JSON - {"Name":value,...} line, multi-values are arrays;
+ *   CSV  - header (when set of columns changed) & line of values, multi-values
+ *          are columns Name_0, Name_1...; unchanged values of delta output are empty;
+ *   bin  - bta_ser_hdr & array of doubles in order of `-l` list
+ * @param sel - array of FLD_AMOUNT flags: fields selected
+ * @param chg - fields to show (changed fields of delta output)
+ * @param key - ==1 if all selected fields are shown
+ * @return 0 in case of some error
+ */
+static int bta_serialize(const uint8_t *sel, const uint8_t *chg, int key){
+	static uint8_t lastsel[FLD_AMOUNT];
+	double v[BTA_FLD_MAXVALS];
+	int f, i, n, first = 1;
+	sptr = sbuf;
+	switch(Pfmt){
+		case PF_JSON:
+			sputc('{');
+			if(Pstamp >= 0.){
+				sprint("\"Sample_time\":%.3f", Pstamp);
+				first = 0;
 			}
-		}
-		SMSG(Tel_Taget, "current or last telescope target", value);
-		if(verb){
-			if(Tel_Hardware == Hard_On)
-				switch (P2_State) {
-					default:
-					case P2_Off   :  value = "Stop";    break;
-					case P2_On    :  value = "Track";   break;
-					case P2_Plus  :  value = "Move+";   break;
-					case P2_Minus :  value = "Move-";   break;
-				}
-			else value = "Off";
-		}
-		SMSG(P2_Mode, "P2 rotator mode", value);
-		if(!sel || parameters_to_show[PAR_PCS_Coeffs]){
-			printf("\nPCS_Coeffs");
-			if(verb){
-				printf("=\"");
-				if(Pos_Corr){
-					for(i = 0; i < 8; ++i){
-						printf("%.2f%s", PosCor_Coeff[i], (i == 7) ? "\"" : ",");
+			if(Dkeyper >= 0. && key){
+				if(!first) sputc(',');
+				sputs("\"Keyframe\":true");
+				first = 0;
+			}
+			for(f = 0; f < FLD_AMOUNT; ++f){
+				if(!chg[f]) continue;
+				n = field_values(f, v);
+				if(!first) sputc(',');
+				first = 0;
+				sputc('"'); sputs(bta_fields[f].name); sputs("\":");
+				if(bta_fields[f].flags & FF_LABEL){
+					sputc('"'); sputtext(f, v); sputc('"');
+				}else if(n == 1) sputnum(v[0]);
+				else{
+					sputc('[');
+					for(i = 0; i < n; ++i){
+						if(i) sputc(',');
+						sputnum(v[i]);
 					}
-				}else{
-					printf("Off\"");
+					sputc(']');
 				}
-			}else printf(" (Precision Correction System coefficients");
-		}
-		if(!sel || parameters_to_show[PAR_code_KOST]){
-			printf("\ncode_KOST");
-			if(verb){
-				printf("=\"0x%04X", code_KOST);
-				if(code_KOST){
-					printf(": ");
-					if(code_KOST & 0x8000) printf("A>0 ");
-					if(code_KOST & 0x4000) printf("PowerOn ");
-					if(code_KOST & 0x2000) printf("Guiding ");
-					if(code_KOST & 0x1000) printf("P2On ");
-					if(code_KOST & 0x01F0){
-						printf("CorrSpd=");
-						if(code_KOST & 0x0010) printf("0.2");
-						else if(code_KOST & 0x0020) printf("0.4");
-						else if(code_KOST & 0x0040) printf("1.0");
-						else if(code_KOST & 0x0080) printf("2.0");
-						else if(code_KOST & 0x0100) printf("5.0");
-						printf("''/s ");
-					}
-					if(code_KOST & 0x000F){
-						if(code_KOST & 0x0001) printf("Z+");
-						else if(code_KOST & 0x0002) printf("Z-");
-						else if(code_KOST & 0x0004) printf("A+");
-						else if(code_KOST & 0x0008) printf("A-");
+			}
+			sputs("}\n");
+		break;
+		case PF_CSV:
+			if(!csvhdr || memcmp(sel, lastsel, FLD_AMOUNT)){
+				if(Pstamp >= 0.){
+					sputs("Sample_time");
+					first = 0;
+				}
+				if(Dkeyper >= 0.){
+					if(!first) sputc(',');
+					sputs("Keyframe");
+					first = 0;
+				}
+				for(f = 0; f < FLD_AMOUNT; ++f){
+					if(!sel[f]) continue;
+					n = field_values(f, v);
+					for(i = 0; i < n; ++i){
+						if(!first) sputc(',');
+						first = 0;
+						sputs(bta_fields[f].name);
+						if(n > 1) sprint("_%d", i);
 					}
 				}
-				printf("\"");
-			}else printf(" (syscodes)");
-		}
-		if(verb){
-			if(Az_Mode) value = "On";
-			else value = "Off";
-		}
-		SMSG(Az_Reverce, "reverce of azimuth direction", value);
-		if(!sel || parameters_to_show[PAR_Az_EndSw]){
-			printf("\nAz_EndSw");
-			if(verb){
-				printf("=\"");
-				if(switch_A){
-					if(switch_A & Sw_minus_A)   printf("A<0 ");
-					if(switch_A & Sw_plus240_A) printf("A=+240 ");
-					if(switch_A & Sw_minus240_A)printf("A=-240 ");
-					if(switch_A & Sw_minus45_A) printf("horizon");
-				}else printf("Off");
-				printf("\"");
-			}else printf(" (Azimuth end-switches)");
-		}
-		if(!sel || parameters_to_show[PAR_Zen_EndSw]){
-			printf("\nZen_EndSw");
-			if(verb){
-				printf("=\"");
-				if(switch_Z){
-					if(switch_Z & Sw_0_Z)  printf("Zenith ");
-					if(switch_Z & Sw_5_Z)  printf("Z<=5 ");
-					if(switch_Z & Sw_20_Z) printf("Z<=20 ");
-					if(switch_Z & Sw_60_Z) printf("Z>=60 ");
-					if(switch_Z & Sw_80_Z) printf("Z>=80 ");
-					if(switch_Z & Sw_90_Z) printf("Z=90 ");
-				}else printf("Off");
-				printf("\"");
-			}else printf(" (Zenith end-switches)");
-		}
-		if(!sel || parameters_to_show[PAR_P2_EndSw]){
-			printf("\nP2_EndSw");
-			if(verb){
-				printf("=\"");
-				if(switch_P){
-					if(switch_P & Sw_22_P) printf("22degr ");
-					if(switch_P & Sw_89_P) printf("89degr ");
-					if(switch_P & Sw_Sm_P) printf("SMOKE");
-				}else  printf("Off");
-				printf("\"");
-			}else printf(" (P2 end-switches)");
-		}
-		FMSG(Worm_A, "worm A position", "%gmkm", worm_A);
-		FMSG(Worm_Z, "worm Z position", "%gmkm", worm_Z);
-		if(verb && !sel){
-			for(i = 0; i < MesgNum; ++i){
-				switch (Sys_Mesg(i).type){
-					case MesgInfor  : value = "information"; break;
-					case MesgWarn   : value = "warning";     break;
-					case MesgFault  : value = "FAULT";       break;
-					case MesgLog    : value = "log";         break;
-					default         : value = NULL;
+				sputc('\n');
+				memcpy(lastsel, sel, FLD_AMOUNT);
+				csvhdr = 1;
+				first = 1;
+			}
+			if(Pstamp >= 0.){
+				sprint("%.3f", Pstamp);
+				first = 0;
+			}
+			if(Dkeyper >= 0.){
+				if(!first) sputc(',');
+				sputc(key ? '1' : '0');
+				first = 0;
+			}
+			for(f = 0; f < FLD_AMOUNT; ++f){
+				if(!sel[f]) continue;
+				n = field_values(f, v);
+				if(!chg[f]){ // empty cells
+					for(i = 0; i < n; ++i){
+						if(!first) sputc(',');
+						first = 0;
+					}
+				}else if(bta_fields[f].flags & FF_LABEL){
+					if(!first) sputc(',');
+					first = 0;
+					sputtext(f, v);
+				}else for(i = 0; i < n; ++i){
+					if(!first) sputc(',');
+					first = 0;
+					sputnum(v[i]);
 				}
-				if(!value) continue;
-				printf("\nMessage[%d](num=%d, status=\"%s\")=\"%s\"", i,
-					Sys_Mesg(i).seq_num, value, Sys_Mesg(i).text);
 			}
+			sputc('\n');
+		break;
+		case PF_BIN:{
+			bta_ser_hdr *hdr = (bta_ser_hdr*)sbuf;
+			double *d;
+			memset(hdr, 0, sizeof(bta_ser_hdr));
+			hdr->magic = BTA_SER_MAGIC;
+			hdr->version = BTA_SER_VER;
+			hdr->mtime = Snap.mtime;
+			if(key) hdr->flags |= BTA_SER_KEYFRAME;
+			if(Dkeyper >= 0.) hdr->flags |= BTA_SER_DELTA;
+			d = (double*)(sbuf + sizeof(bta_ser_hdr));
+			for(f = 0; f < FLD_AMOUNT && f < 128; ++f){
+				if(!chg[f]) continue;
+				hdr->mask[f / 32] |= 1U << (f % 32);
+				n = field_values(f, d);
+				d += n;
+				hdr->nvals += n;
+			}
+			sptr = (char*)d;
 		}
-		if(!sel || parameters_to_show[PAR_Lock_Flags]){
-			printf("\nLock_Flags");
-			if(verb){
-				printf("=\"");
-				if(LockFlags){
-					if(A_Locked) printf("A ");
-					if(Z_Locked) printf("Z ");
-					if(P_Locked) printf("P2 ");
-					if(F_Locked) printf("F ");
-					if(D_Locked) printf("D ");
-				}else printf("Off");
-				printf("\"");
-			}else printf(" (locked motors)");
-		}
-		FMSG(Oil_Pres, "oil pressure in A,Z & tank (Pa)", "p(A)=%.1f, p(Z)=%.1f, p(tank)=%.1f", PressOilA, PressOilZ, PressOilTank);
-		FMSG(Oil_Temp, "oil temperature (degrC)", "%.1f", OilTemper1);
-		FMSG(Oil_Cool_Temp, "oil coolant themperature (degrC)", "%.1f", OilTemper2);
+		break;
+		default:
+			return 0;
 	}
-/************************* BASIC_COORDS ***************************************/
-	if(lvl & BASIC_COORDS){ // basic coordinates: cur, src, inp, tel
-		// Target: object, show A/D
-		if(Sys_Target == TagObject){
-			SMSG(CurAlpha, "current", time_asc(CurAlpha));
-			SMSG(CurDelta, "current", angle_asc(CurDelta));
-			SMSG(SrcAlpha, "last source position", time_asc(SrcAlpha));
-			SMSG(SrcDelta, "last source position", angle_asc(SrcDelta));
-			SMSG(InpAlpha, "last input value", time_asc(InpAlpha));
-			SMSG(InpDelta, "last input value", angle_asc(InpDelta));
-			SMSG(TelAlpha, "real telescope", time_asc(val_Alp));
-			SMSG(TelDelta, "real telescope", angle_asc(val_Del));
+	return swrite(sbuf, (size_t)(sptr - sbuf));
+}
+
+/*
+ * OpenMetrics: field Name is gauge bta_Name[_unit], multi-values have label n="0",
+ * n="1"..., state fields are codes with label state="name".
+ */
+static const struct{
+	const char *unit;
+	const char *om;
+} omunits[] = {
+	{"''",   "arcseconds"},
+	{"''/s", "arcseconds_per_second"},
+	{"s",    "seconds"},
+	{"d",    "days"},
+	{"degC", "celsius"},
+	{"mmHg", "mmhg"},
+	{"m/s",  "meters_per_second"},
+	{"MPa",  "megapascals"},
+	{"%",    "percent"},
+	{"mkm",  "micrometers"},
+	{"mm",   "millimeters"},
+	{"min",  "minutes"},
+	{"A",    "amperes"},
+	{"rpm",  "rpm"},
+};
+
+static void sputom(double v){
+	if(isnan(v)) sputs("NaN");
+	else if(isinf(v)) sputs(v > 0. ? "+Inf" : "-Inf");
+	else sputnum(v);
+}
+
+/**
+ * Render all fields of new snapshot in OpenMetrics text format (without "# EOF")
+ * @param buf  - buffer for text
+ * @param size - its size
+ * @return length of text (0 if buffer is too small)
+ */
+size_t bta_print_metrics(char *buf, size_t size){
+	double v[BTA_FLD_MAXVALS];
+	char name[64];
+	const char *unit;
+	size_t j, l;
+	int f, i, n;
+	if(!loaded && !get_bta_snapshot(&Snap))
+		WARNX(_("Data was changing while reading, values could be inconsistent"));
+	sptr = sbuf;
+	for(f = 0; f < FLD_AMOUNT; ++f){
+		const bta_field *fld = &bta_fields[f];
+		unit = NULL;
+		for(j = 0; j < sizeof(omunits) / sizeof(omunits[0]); ++j)
+			if(strcmp(fld->unit, omunits[j].unit) == 0) unit = omunits[j].om;
+		if(unit) snprintf(name, sizeof(name), "bta_%s_%s", fld->name, unit);
+		else snprintf(name, sizeof(name), "bta_%s", fld->name);
+		sprint("# TYPE %s gauge\n", name);
+		if(unit) sprint("# UNIT %s %s\n", name, unit);
+		sprint("# HELP %s %s\n", name, fld->help);
+		n = field_values(f, v);
+		if(fld->flags & FF_LABEL){
+			sputs(name); sputs("{state=\""); sputtext(f, v); sputs("\"} ");
+			sputom(v[0]);
+			sputc('\n');
+		}else for(i = 0; i < n; ++i){
+			sputs(name);
+			if(n > 1) sprint("{n=\"%d\"}", i);
+			sputc(' ');
+			sputom(v[i]);
+			sputc('\n');
 		}
-		SMSG(CurAzim, "current", angle_fmt(tag_A,"%c%03d:%02d:%04.1f"));
-		SMSG(CurZenD, "current", angle_fmt(tag_Z,"%02d:%02d:%04.1f"));
-		SMSG(InpAzim, "input", angle_fmt(InpAzim,"%c%03d:%02d:%04.1f"));
-		SMSG(InpZenD, "input", angle_fmt(InpZdist,"%02d:%02d:%04.1f"));
-		SMSG(CurPA, "current", angle_fmt(tag_P,"%03d:%02d:%04.1f"));
-		SMSG(SrcPA, "source", angle_fmt(calc_PA(SrcAlpha,SrcDelta,S_time),"%03d:%02d:%04.1f"));
-		SMSG(InpPA, "input", angle_fmt(calc_PA(InpAlpha,InpDelta,S_time),"%03d:%02d:%04.1f"));
-		SMSG(TelPA, "telescope", angle_fmt(calc_PA(val_Alp, val_Del, S_time),"%03d:%02d:%04.1f"));
-
-		FMSG(ValFoc, "focus value", "%0.2f", val_F);
 	}
-	if(lvl & EXTENDED_COORDS){
-		SMSG(ValAzim, "from encoder", angle_fmt(val_A,"%c%03d:%02d:%04.1f"));
-		SMSG(ValZenD, "from encoder", angle_fmt(val_Z,"%02d:%02d:%04.1f"));
-		SMSG(ValP2, "from encoder", angle_fmt(val_P,"%03d:%02d:%04.1f"));
-		SMSG(ValDome, "from encoder", angle_fmt(val_D,"%c%03d:%02d:%04.1f"));
-
-		SMSG(DiffAzim, "A difference", angle_fmt(Diff_A,"%c%03d:%02d:%04.1f"));
-		SMSG(DiffZenD, "Z difference", angle_fmt(Diff_Z,"%c%02d:%02d:%04.1f"));
-		SMSG(DiffP2, "P2 difference", angle_fmt(Diff_P,"%c%03d:%02d:%04.1f"));
-		SMSG(DiffDome, "DomeAz difference", angle_fmt(val_A-val_D,"%c%03d:%02d:%04.1f"));
-
-		SMSG(VelAzim, "A velocity", angle_fmt(vel_A,"%c%02d:%02d:%04.1f"));
-		SMSG(VelZenD, "Z velocity", angle_fmt(vel_Z,"%c%02d:%02d:%04.1f"));
-		SMSG(VelP2, "P2 velocity", angle_fmt(vel_P,"%c%02d:%02d:%04.1f"));
-		SMSG(VelPA, "object PA velocity", angle_fmt(vel_objP,"%c%02d:%02d:%04.1f"));
-		SMSG(VelDome, "DomeAz velocity", angle_fmt(vel_D,"%c%02d:%02d:%04.1f"));
-
-		double corAlp = 0.,corDel = 0.,corA = 0.,corZ = 0.;
-		double PCSA = 0., PCSZ = 0., refr = 0.;
-		if(verb){
-			if(Sys_Mode == SysTrkSeek || Sys_Mode == SysTrkOk || Sys_Mode == SysTrkCorr){
-				double curA,curZ,srcA,srcZ;
-				corAlp = CurAlpha-SrcAlpha;
-				corDel = CurDelta-SrcDelta;
-				if(corAlp >  23*3600.) corAlp -= 24*3600.;
-				if(corAlp < -23*3600.) corAlp += 24*3600.;
-				calc_AZ(SrcAlpha, SrcDelta, S_time, &srcA, &srcZ);
-				calc_AZ(CurAlpha, CurDelta, S_time, &curA, &curZ);
-				corA = curA - srcA;
-				corZ = curZ - srcZ;
-				PCSA = tel_cor_A; PCSZ = tel_cor_Z; refr = tel_ref_Z;
-			}
-		}
-		FMSG(CorrPCS, "Point Correction System value",
-			"A=%s, Z=%s", angle_fmt(PCSA, "%c%01d:%02d:%04.1f"),
-			angle_fmt(PCSZ, "%c%01d:%02d:%04.1f"));
-		SMSG(Refraction, "calculated refraction value", angle_fmt(refr, "%c%01d:%02d:%04.1f"));
-		SMSG(CorrAlpha, "correction by RA", angle_fmt(corAlp,"%c%01d:%02d:%05.2f"));
-		SMSG(CorrDelta, "correction by Decl", angle_fmt(corDel,"%c%01d:%02d:%04.1f"));
-		SMSG(CorrAzim, "correction by A", angle_fmt(corA,"%c%01d:%02d:%04.1f"));
-		SMSG(CorrZenD, "correction by Z", angle_fmt(corZ,"%c%01d:%02d:%04.1f"));
-		if(verb){
-			switch(Foc_State){
-				case Foc_Hminus :
-				case Foc_Hplus  : value = "fast move"; break;
-				case Foc_Lminus :
-				case Foc_Lplus  : value = "slow move"; break;
-				default         : value = "stopped";
-			}
+	l = (size_t)(sptr - sbuf);
+	if(SLEFT() < 2 || l >= size) return 0; // truncated
+	memcpy(buf, sbuf, l);
+	return l;
+}
+
+// messages of ACS system
+static void sput_messages(){
+	int i;
+	const char *value;
+	for(i = 0; i < MesgNum; ++i){
+		switch (Sys_Mesg(i).type){
+			case MesgInfor  : value = "information"; break;
+			case MesgWarn   : value = "warning";     break;
+			case MesgFault  : value = "FAULT";       break;
+			case MesgLog    : value = "log";         break;
+			default         : value = NULL;
 		}
-		SMSG(Foc_State, "focus motor state", value);
+		if(!value) continue;
+		sprint("\nMessage[%d](num=%d, status=\"%s\")=\"%s\"", i,
+			Sys_Mesg(i).seq_num, value, Sys_Mesg(i).text);
+	}
+}
 
-		FMSG(polarX, "X polar motion", "%g", polarX);
-		FMSG(polarY, "Y polar motion", "%g", polarY);
-		FMSG(DUT1, "UT1 - UTC", "%g", DUT1);
+/**
+ * print requested information
+ * @param lvl      - requested information level
+ * @param par_list - list of parameters (any separator) if lvl == REQUESTED_LIST
+ * @return 0 in case of some error
+ */
+int bta_print(info_level lvl, char *par_list){
+	static uint8_t chg[FLD_AMOUNT];
+	const uint8_t *show = parameters_to_show;
+	int i, verb = 1, sel = 0, key = 1;
+	double v[BTA_FLD_MAXVALS];
+	DBG("lvl: 0x%X, list: %s", lvl, par_list);
+	if(lvl == NO_INFO && par_list) lvl = REQUESTED_LIST;
+	else if(lvl == REQUESTED_LIST && !par_list) return 0;
+	if(lvl == REQUESTED_LIST){
+		select_fields(par_list, parameters_to_show); // forget previous list
+		sel = 1;
+	}else for(i = 0; i < FLD_AMOUNT; ++i)
+		parameters_to_show[i] = (bta_fields[i].lvl & lvl) ? 1 : 0;
+	if(lvl == NO_INFO) verb = 0; // show all parameters but without values
+	else{
+		if(!loaded && !get_bta_snapshot(&Snap))
+			WARNX(_("Data was changing while reading, values could be inconsistent"));
+		if(Dkeyper >= 0.){
+			if((key = delta_select(parameters_to_show, chg)) < 0) return 1; // nothing changed
+			show = chg;
+		}
+		if(Pfmt != PF_TEXT) return bta_serialize(parameters_to_show, show, key);
 	}
-/************************** METEO_INFO ****************************************/
-	if(lvl & METEO_INFO){
-		FMSG(ValTout, "outern temperature (DegrC)", "%+05.1f", val_T1);
-		FMSG(ValTind, "indome temperature (DegrC)", "%+05.1f", val_T2);
-		FMSG(ValTmir, "mirror temperature (DegrC)", "%+05.1f", val_T3);
-		FMSG(ValPres, "atm. pressure (mmHg)", "%+05.1f", val_B);
-		FMSG(ValWind, "wind speed (m/s)", "%04.1f", val_Wnd);
-		double w10 = -1., w15 = -1., pre = -1.;
-		if(verb){
-			if(Wnd10_time > 0.1 && Wnd10_time <= M_time){
-				w10 = (M_time-Wnd10_time)/60.;
-				w15 = (M_time-Wnd15_time)/60.;
-			}
-			if(Precip_time > 0.1 && Precip_time <= M_time)
-				pre = (M_time-Precip_time)/60.;
+	sptr = sbuf;
+	if(verb && Pstamp >= 0.){
+		time_t t = (time_t)Pstamp;
+		struct tm tm;
+		gmtime_r(&t, &tm);
+		sprint("\nSample_time=\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\"", tm.tm_year + 1900,
+			tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+			(int)((Pstamp - (double)t) * 1000.));
+	}
+	if(verb && Dkeyper >= 0. && key) sputs("\nKeyframe=\"yes\"");
+	for(i = 0; i < FLD_AMOUNT; ++i){
+		const bta_field *f = &bta_fields[i];
+		if(!verb){
+			sprint("\n%s (%s)", f->name, f->help);
+			continue;
 		}
-		FMSG(Blast10, "wind blast >=10m/s (minutes ago)", "%.1f", w10);
-		FMSG(Blast15, "wind blast >=15m/s (minutes ago)", "%.1f", w15);
-		FMSG(Precipitation, "last precipitation (minutes ago)", "%.1f", pre);
-		FMSG(ValHumd, "Humidity, %%", "%04.1f", val_Hmd);
+		if(!show[i]) continue;
+		if((f->flags & FF_OBJ) && Sys_Target != TagObject) continue;
+		if(i == FLD_Lock_Flags && !sel && key) sput_messages();
+		field_values(i, v);
+		sputc('\n'); sputs(f->name); sputs("=\"");
+		sputtext(i, v);
+		sputc('"');
 	}
-// FMSG("", "", "", ));
-/******************************************************************************/
-	printf("\n");
-#undef SMSG
-#undef FMSG
-	return 1;
+	sputc('\n');
+	return swrite(sbuf, (size_t)(sptr - sbuf));
 }
 
 void show_infolevels(){
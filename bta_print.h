@@ -23,6 +23,9 @@
 #ifndef __BTA_PRINT_H__
 #define __BTA_PRINT_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef enum{
 	 NO_INFO          = 0      // don't show anything
 	,BASIC_COORDS     = 1      // show basic coordinates
@@ -34,8 +37,41 @@ typedef enum{
 	,REQUESTED_LIST   = 0x8000 // show only parameters given in list
 } info_level;
 
+// output format of bta_print()
+typedef enum{
+	 PF_TEXT = 0      // Name="value" lines
+	,PF_JSON          // one JSON object per snapshot
+	,PF_CSV           // CSV line per snapshot (header when columns changed)
+	,PF_BIN           // bta_ser_hdr & array of doubles
+	,PF_AMOUNT
+} print_format;
+
+#define BTA_SER_MAGIC  (0x53415442)  // "BTAS"
+#define BTA_SER_VER    (3)
+// flags of binary snapshot
+#define BTA_SER_KEYFRAME (1)         // all parameters selected are present
+#define BTA_SER_DELTA    (2)         // change-only output: absent parameters didn't change
+// header of binary snapshot
+typedef struct{
+	uint32_t magic;     // BTA_SER_MAGIC
+	uint16_t version;   // BTA_SER_VER
+	uint16_t nvals;     // amount of doubles after header
+	double mtime;       // M_time of snapshot
+	uint32_t mask[4];   // bit N is set if parameter N (in order of `-l` list) present
+	uint32_t flags;     // BTA_SER_KEYFRAME | BTA_SER_DELTA
+	uint32_t reserved;
+} bta_ser_hdr;
+
 int bta_print (info_level lvl, char *par_list);
+int bta_print_format(const char *name);
+void bta_print_output(int fd);
+void bta_print_stamp(double t);
+int bta_print_delta(double keyper, const char *bands);
+size_t bta_print_metrics(char *buf, size_t size);
 void show_infolevels();
 info_level get_infolevel(char* infostr);
+struct BTA_Data;
+struct BTA_Local;
+void bta_print_set(struct BTA_Data *data, struct BTA_Local *local);
 
 #endif // __BTA_PRINT_H__
@@ -1,3 +1,6 @@
+#include <crypt.h>
+#include <math.h>
+#include <signal.h>
 #include "bta_shdata.h"
 #include "usefull_macros.h"
 
@@ -31,6 +34,7 @@ volatile struct SHM_Block sdat = {
 int snd_id = -1;        // client sender ID
 int cmd_src_pid = 0;    // next command source PID
 uint32_t cmd_src_ip = 0;// next command source IP
+void (*cmd_sent_hook)(int, int) = NULL; // hook after sending (e.g. latency tracker)
 
 /**
  * Init data
@@ -185,6 +189,103 @@ int check_shm_block(volatile struct SHM_Block *sb) {
 	else return(0);
 }
 
+// max amount of attempts to get coherent copy of shared data
+#define SNAPSHOT_MAXTRIES   (16)
+static struct BTA_SnapStat snapstat = {0};
+
+/**
+ * Copy shared data into local structure
+ * Copying repeats until M_time stays unchanged during whole copy (but no more than
+ * SNAPSHOT_MAXTRIES times)
+ * @param s (o) - snapshot to fill
+ * @return 1 if copy is coherent, 0 if data was changing all the time or there's no data
+ */
+int get_bta_snapshot(struct BTA_Snapshot *s){
+	double t0, t1;
+	uint32_t tries;
+	if(!s || !sdt || !sdtl) return 0;
+	for(tries = 1; tries <= SNAPSHOT_MAXTRIES; ++tries){
+		t0 = M_time;
+		__sync_synchronize();
+		memcpy(&s->data, (void*)sdt, sizeof(struct BTA_Data));
+		memcpy(&s->local, (void*)sdtl, sizeof(struct BTA_Local));
+		__sync_synchronize();
+		t1 = M_time;
+		// compare with copied value too: double in shared memory could be torn itself
+		if(t0 == t1 && s->data.m_time == t0) break;
+		__sync_fetch_and_add(&snapstat.retries, 1);
+	}
+	__sync_fetch_and_add(&snapstat.copies, 1);
+	s->mtime = s->data.m_time;
+	s->rtime = dtime();
+	if(tries > SNAPSHOT_MAXTRIES){
+		__sync_fetch_and_add(&snapstat.torn, 1);
+		s->tries = SNAPSHOT_MAXTRIES;
+		s->coherent = 0;
+		return 0;
+	}
+	s->tries = tries;
+	s->coherent = 1;
+	return 1;
+}
+
+/**
+ * Cheap check of server activity: read only M_time
+ * @return current M_time value in shared memory or -1. if there's no data
+ */
+double get_shm_mtime(){
+	if(!sdt) return -1.;
+	return M_time;
+}
+
+/**
+ * Get statistics of snapshots made by get_bta_snapshot()
+ * @param st (o) - statistics
+ */
+void get_snapshot_stat(struct BTA_SnapStat *st){
+	if(!st) return;
+	st->copies  = snapstat.copies;
+	st->retries = snapstat.retries;
+	st->torn    = snapstat.torn;
+}
+
+// 1 if process exists, 0 if not, -1 if unknown
+static int pid_alive(pid_t pid){
+	if(pid < 1) return -1;
+	if(kill(pid, 0) == 0 || errno == EPERM) return 1;
+	if(errno == ESRCH) return 0;
+	return -1;
+}
+
+/**
+ * Check link with server without waiting of new data: by existance of server's
+ * process (ServPID, it is local for emulator or server on the same host) & creator
+ * of shared memory segment, amount of attached processes & lag of M_time relative
+ * to system clock. Attach/change times of segment don't show writing, so they aren't used.
+ * @param st (o) - evidences (could be NULL)
+ * @return LINK_FRESH, LINK_STALE or LINK_UNKNOWN if caller should wait for new tick
+ */
+bta_link check_bta_link(struct BTA_LinkStat *st){
+	struct BTA_LinkStat l = {-1, -1, -1, 0.};
+	struct shmid_ds ds;
+	bta_link ret = LINK_UNKNOWN;
+	if(!sdt) return LINK_STALE;
+	l.servpid = pid_alive(ServPID);
+	if(shmctl(sdat.id, IPC_STAT, &ds) == 0){
+		l.creator = pid_alive(ds.shm_cpid);
+		l.nattch = (int)ds.shm_nattch;
+	}
+	l.lag = fmod(dtime(), 86400.) - M_time;
+	if(l.lag > 43200.) l.lag -= 86400.;
+	else if(l.lag < -43200.) l.lag += 86400.;
+	if((l.servpid == 1 || l.creator == 1) && fabs(l.lag) < LINK_FRESH_LAG)
+		ret = LINK_FRESH;
+	else if(l.servpid == 0 && l.creator == 0 && l.nattch == 1) // only we are attached
+		ret = LINK_STALE;
+	if(st) *st = l;
+	return ret;
+}
+
 /**
  * Set access key in current channel
  */
@@ -230,7 +331,9 @@ void send_cmd(int cmd_code, char *buf, int size) {
 		mbuf.mtext[0] = 0;
 		size = 1;
 	}
-	msgsnd(snd_id, (struct msgbuf *)&mbuf, size+12, IPC_NOWAIT);
+	int err = 0;
+	if(msgsnd(snd_id, (struct msgbuf *)&mbuf, size+12, IPC_NOWAIT)) err = errno;
+	if(cmd_sent_hook) cmd_sent_hook(cmd_code, err);
 }
 
 void send_cmd_noarg(int cmd_code) {
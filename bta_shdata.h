@@ -64,6 +64,8 @@ void send_cmd_d2(int, double, double);
 void send_cmd_i1d1(int, int32_t, double);
 void send_cmd_i2d1(int, int32_t, int32_t, double);
 void send_cmd_i3d1(int, int32_t, int32_t, int32_t, double);
+// called after each command sending: err is 0 or errno of msgsnd (e.g. EAGAIN if queue is full)
+extern void (*cmd_sent_hook)(int cmd_code, int err);
 
 /*******************************************************************************
 *                             Command list                                     *
@@ -823,6 +825,7 @@ extern volatile struct BTA_Local *sdtl;
 extern int snd_id;
 extern int cmd_src_pid;
 extern uint32_t cmd_src_ip;
+void set_cmd_src(uint32_t ip, int pid);
 
 #define ClientSide 0
 #define ServerSide 1
@@ -847,4 +850,56 @@ void set_acckey(uint32_t newkey);
 #pragma pack(pop)
 //#pragma GCC diagnostic pop
 
+/*******************************************************************************
+*                    Coherent local copy of shared data                        *
+*******************************************************************************/
+/*
+ * Both blocks are copied during one server tick (M_time wasn't changed while
+ * copying), so all values belong to the same moment. Copy lays in private
+ * aligned memory, so it is safe & cheap to read it many times.
+ */
+struct BTA_Snapshot {
+	struct BTA_Data data;   // copy of BTA_Data
+	struct BTA_Local local; // copy of BTA_Local
+	double mtime;           // M_time of copy
+	double rtime;           // local time (dtime()) of copy
+	uint32_t tries;         // amount of copy attempts
+	int coherent;           // ==0 if data was changed during all attempts
+} __attribute__((aligned(64)));
+
+// snapshots statistics
+struct BTA_SnapStat {
+	uint64_t copies;  // total amount of snapshots
+	uint64_t retries; // amount of repeated copies (M_time changed while copying)
+	uint64_t torn;    // amount of snapshots which wasn't coherent after all attempts
+};
+
+int get_bta_snapshot(struct BTA_Snapshot *s);
+double get_shm_mtime();
+void get_snapshot_stat(struct BTA_SnapStat *st);
+
+/*******************************************************************************
+*                    Freshness of data without waiting                         *
+*******************************************************************************/
+// data is fresh if M_time differs from system clock less than this value (seconds)
+#ifndef LINK_FRESH_LAG
+#define LINK_FRESH_LAG  (1.)
+#endif
+
+typedef enum{
+	 LINK_STALE = 0 // there's no process writing data
+	,LINK_FRESH     // writer is alive & data is close to system time
+	,LINK_UNKNOWN   // can't say without waiting for next server tick
+} bta_link;
+
+// evidences of link check
+struct BTA_LinkStat {
+	int servpid;    // ServPID process: 1 - exists, 0 - not exists, -1 - unknown
+	int creator;    // same for creator of shared memory segment
+	int nattch;     // amount of processes attached to shared memory segment
+	double lag;     // system time minus M_time (seconds, -43200..43200)
+};
+
+bta_link check_bta_link(struct BTA_LinkStat *st);
+
 #endif // __BTA_SHDATA_H__
@@ -0,0 +1,337 @@
+/*
+ * catalog.c - memory-mapped binary catalogs with declination zones
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "coords.h"
+#include "angle_functions.h"
+
+/*
+ * Text catalog is parsed once by cat_compile(); binary file is mapped read-only, objects
+ * are sorted by declination zones & by R.A. inside zone, so cone search looks only at
+ * zones crossing cone & binary-searches R.A. range in each of them (no parsing & no
+ * allocations except growing of reused array of results).
+ */
+// max length of text catalog line
+#define CAT_LINELEN     (256)
+// index of zone
+static uint32_t zone_of(double dec, double h, uint32_t nz){
+	double z = floor((dec + 324000.) / h);
+	if(z < 0.) return 0;
+	if(z >= nz) return nz - 1;
+	return (uint32_t)z;
+}
+
+/**
+ * Parse line of text catalog: "name RA Decl [pmRA pmDecl [mag]]" (RA in hours, Decl in
+ * degrees, formats of get_degrees(); proper motion in mas/year), text after '#' is comment
+ * (if there's proper motion or magnitude, Decl should be decimal or dd:mm:ss)
+ * @param line (io) - line (would be modified)
+ * @param o    (o)  - object
+ * @return 1 if OK, 0 for empty line & -1 for wrong line
+ */
+int cat_parse(char *line, cat_obj *o){
+	char *s, *e;
+	double ra, dec, v[3];
+	int n = 0;
+	if((s = strchr(line, '#'))) *s = 0;
+	for(e = line + strlen(line); e > line && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'); --e);
+	*e = 0;
+	for(s = line; *s == ' ' || *s == '\t'; ++s);
+	if(!*s) return 0;
+	for(e = s; *e && *e != ' ' && *e != '\t'; ++e);
+	if(!*e || e - s >= CAT_NAMELEN) return -1;
+	*e++ = 0;
+	if(!(e = get_degrees(&ra, e)) || !*e || !(e = get_degrees(&dec, e))) return -1;
+	while(*e && n < 3){
+		char *end;
+		v[n] = strtod(e, &end);
+		if(end == e) return -1;
+		e = end; ++n;
+		while(*e == ' ' || *e == '\t') ++e;
+	}
+	if(*e || n == 1) return -1;
+	if(ra < 0. || ra >= 24. || dec < -90. || dec > 90.) return -1;
+	memset(o, 0, sizeof(cat_obj));
+	strcpy(o->name, s);
+	o->ra = ra * 3600.;
+	o->dec = dec * 3600.;
+	if(n > 1){
+		o->pmra = (float)v[0];
+		o->pmdec = (float)v[1];
+	}
+	o->mag = (n > 2) ? (float)v[2] : NAN;
+	return 1;
+}
+
+/**
+ * Read text catalog
+ * @param name - file name
+ * @param n (o) - amount of objects
+ * @return array of objects (in order of file) or NULL if there's no objects
+ */
+cat_obj *cat_read_text(char *name, size_t *n){
+	mmapbuf *m = My_mmap(name);
+	cat_obj *o = NULL;
+	size_t N = 0, size = 0, lineno = 0, bad = 0;
+	char *p = m->data, *end = m->data + m->len;
+	while(p < end){
+		char line[CAT_LINELEN], *eol = memchr(p, '\n', end - p);
+		size_t l;
+		int r;
+		if(!eol) eol = end;
+		l = eol - p;
+		++lineno;
+		if(l >= CAT_LINELEN){
+			WARNX(_("%s:%zd: line too long"), name, lineno);
+			++bad; p = eol + 1;
+			continue;
+		}
+		memcpy(line, p, l); line[l] = 0;
+		p = eol + 1;
+		if(N == size){
+			size = size ? size * 2 : 1024;
+			if(!(o = realloc(o, size * sizeof(cat_obj)))) ERR("realloc()");
+		}
+		if((r = cat_parse(line, &o[N])) > 0) ++N;
+		else if(r < 0){
+			WARNX(_("%s:%zd: wrong object"), name, lineno);
+			++bad;
+		}
+	}
+	My_munmap(m);
+	if(bad) WARNX(_("%zd wrong lines in %s"), bad, name);
+	if(!N){
+		WARNX(_("There's no objects in %s"), name);
+		FREE(o);
+	}
+	*n = N;
+	return o;
+}
+
+/**
+ * Check whether file is binary catalog
+ */
+int cat_is_binary(char *name){
+	uint32_t magic = 0;
+	FILE *f = fopen(name, "r");
+	if(!f) return 0;
+	if(fread(&magic, sizeof(magic), 1, f) != 1) magic = 0;
+	fclose(f);
+	return magic == CAT_MAGIC;
+}
+
+static int objcmp(const void *a, const void *b){
+	const cat_obj *o1 = a, *o2 = b;
+	uint32_t nz = (uint32_t)ceil(648000. / CAT_ZONE), z1 = zone_of(o1->dec, CAT_ZONE, nz),
+		z2 = zone_of(o2->dec, CAT_ZONE, nz);
+	if(z1 != z2) return (z1 < z2) ? -1 : 1;
+	if(o1->ra != o2->ra) return (o1->ra < o2->ra) ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Convert text catalog into binary one
+ * @param text - text catalog
+ * @param bin  - binary catalog (written into temporary file & renamed)
+ * @return 1 if all OK
+ */
+int cat_compile(char *text, char *bin){
+	cat_hdr hdr = {.magic = CAT_MAGIC, .version = CAT_VER, .objsize = sizeof(cat_obj),
+		.zone = CAT_ZONE};
+	uint64_t *zidx;
+	size_t n, i;
+	uint32_t z;
+	char tmp[PATH_MAX];
+	FILE *f;
+	int ret = 0;
+	cat_obj *o = cat_read_text(text, &n);
+	if(!o) return 0;
+	hdr.nzones = (uint32_t)ceil(648000. / CAT_ZONE);
+	hdr.count = n;
+	qsort(o, n, sizeof(cat_obj), objcmp);
+	zidx = MALLOC(uint64_t, hdr.nzones + 1);
+	for(i = 0, z = 0; z <= hdr.nzones; ++z){
+		while(i < n && zone_of(o[i].dec, CAT_ZONE, hdr.nzones) < z) ++i;
+		zidx[z] = i;
+	}
+	zidx[hdr.nzones] = n;
+	snprintf(tmp, PATH_MAX, "%s.tmp", bin);
+	if(!(f = fopen(tmp, "w"))){
+		WARN(_("Can't open %s"), tmp);
+		goto ret;
+	}
+	if(fwrite(&hdr, sizeof(hdr), 1, f) != 1 || fwrite(zidx, sizeof(uint64_t), hdr.nzones + 1, f)
+		!= hdr.nzones + 1 || fwrite(o, sizeof(cat_obj), n, f) != n){
+		WARN(_("Can't write %s"), tmp);
+		fclose(f);
+		unlink(tmp);
+		goto ret;
+	}
+	if(fclose(f) || rename(tmp, bin)){
+		WARN(_("Can't write %s"), bin);
+		unlink(tmp);
+		goto ret;
+	}
+	printf(_("%zd objects in %u zones written to %s\n"), n, hdr.nzones, bin);
+	ret = 1;
+ret:
+	FREE(zidx);
+	FREE(o);
+	return ret;
+}
+
+/**
+ * Map binary catalog
+ * @return catalog or NULL if file isn't right catalog
+ */
+catalog *cat_open(char *name){
+	mmapbuf *m = My_mmap(name);
+	const cat_hdr *h = (const cat_hdr*)m->data;
+	const uint64_t *zidx = (const uint64_t*)(m->data + sizeof(cat_hdr));
+	catalog *c;
+	size_t z, idxlen;
+	if(m->len < sizeof(cat_hdr) || h->magic != CAT_MAGIC || h->version != CAT_VER
+		|| h->objsize != sizeof(cat_obj)){
+		WARNX(_("%s isn't a catalog of this version"), name);
+		goto bad;
+	}
+	// all further access is checked once here: zones should cover all sky & index should
+	// point only inside of objects table
+	idxlen = sizeof(cat_hdr) + ((size_t)h->nzones + 1) * sizeof(uint64_t);
+	if(!(h->zone > 0. && h->zone <= 648000.) || h->nzones != (uint32_t)ceil(648000. / h->zone)
+		|| m->len < idxlen || (m->len - idxlen) % sizeof(cat_obj)
+		|| h->count != (m->len - idxlen) / sizeof(cat_obj))
+		goto corrupted;
+	if(zidx[0]) goto corrupted;
+	for(z = 0; z < h->nzones; ++z)
+		if(zidx[z] > zidx[z+1]) goto corrupted;
+	if(zidx[h->nzones] != h->count) goto corrupted; // so all entries <= count
+	c = MALLOC(catalog, 1);
+	c->map = m;
+	c->hdr = h;
+	c->zidx = zidx;
+	c->obj = (const cat_obj*)(zidx + h->nzones + 1);
+	return c;
+corrupted:
+	WARNX(_("Catalog %s is corrupted"), name);
+bad:
+	My_munmap(m);
+	return NULL;
+}
+
+void cat_close(catalog *c){
+	if(!c) return;
+	My_munmap(c->map);
+	FREE(c);
+}
+
+// add objects of zone `z` with R.A. from `ra0` to `ra1` if they are inside cone
+static size_t cone_range(const catalog *c, uint32_t z, double ra0, double ra1, double ra,
+		double cos_d, double dec, double hav_r, cat_hit **hits, size_t *size, size_t n){
+	size_t lo = c->zidx[z], hi = c->zidx[z+1], i;
+	while(lo < hi){ // first object with R.A. >= ra0
+		size_t mid = (lo + hi) / 2;
+		if(c->obj[mid].ra < ra0) lo = mid + 1;
+		else hi = mid;
+	}
+	for(i = lo; i < c->zidx[z+1] && c->obj[i].ra <= ra1; ++i){
+		const cat_obj *o = &c->obj[i];
+		double sd = sin((o->dec - dec) * S2R / 2.), sa = sin((o->ra - ra) * 15. * S2R / 2.);
+		double hav = sd * sd + cos_d * cos(o->dec * S2R) * sa * sa;
+		if(hav > hav_r) continue;
+		if(n == *size){
+			*size = *size ? *size * 2 : 64;
+			if(!(*hits = realloc(*hits, *size * sizeof(cat_hit)))) ERR("realloc()");
+		}
+		(*hits)[n].obj = o;
+		(*hits)[n].dist = 2. * asin(sqrt(hav)) * R2S;
+		++n;
+	}
+	return n;
+}
+
+/**
+ * Find all objects inside cone
+ * @param c    - catalog
+ * @param ra, dec - center of cone (seconds of time & arcseconds, J2000.0)
+ * @param r    - radius of cone (arcseconds)
+ * @param hits (io) - array of found objects (reallocated if needed)
+ * @param size (io) - size of `hits`
+ * @return amount of objects found (in order of catalog)
+ */
+size_t cat_cone(const catalog *c, double ra, double dec, double r, cat_hit **hits, size_t *size){
+	double d = dec * S2R, rr, hav_r, cos_d = cos(d), alpha = 43200.;
+	uint32_t z, z0, z1, nz = c->hdr->nzones;
+	size_t n = 0;
+	if(r > 648000.) r = 648000.;
+	rr = r * S2R;
+	hav_r = sin(rr / 2.) * sin(rr / 2.);
+	if(fabs(dec) + r < 323999.) // R.A. half-width of cone (seconds of time)
+		alpha = atan(sin(rr) / sqrt(fabs(cos(d - rr) * cos(d + rr)))) * R2S / 15.;
+	z0 = zone_of(dec - r, c->hdr->zone, nz);
+	z1 = zone_of(dec + r, c->hdr->zone, nz);
+	for(z = z0; z <= z1; ++z){
+		if(alpha >= 43200.){
+			n = cone_range(c, z, 0., 86400., ra, cos_d, dec, hav_r, hits, size, n);
+		}else if(ra - alpha < 0.){
+			n = cone_range(c, z, 0., ra + alpha, ra, cos_d, dec, hav_r, hits, size, n);
+			n = cone_range(c, z, ra - alpha + 86400., 86400., ra, cos_d, dec, hav_r, hits, size, n);
+		}else if(ra + alpha >= 86400.){
+			n = cone_range(c, z, 0., ra + alpha - 86400., ra, cos_d, dec, hav_r, hits, size, n);
+			n = cone_range(c, z, ra - alpha, 86400., ra, cos_d, dec, hav_r, hits, size, n);
+		}else
+			n = cone_range(c, z, ra - alpha, ra + alpha, ra, cos_d, dec, hav_r, hits, size, n);
+	}
+	return n;
+}
+
+static int hitcmp(const void *a, const void *b){
+	double d1 = ((const cat_hit*)a)->dist, d2 = ((const cat_hit*)b)->dist;
+	return (d1 < d2) ? -1 : (d1 > d2);
+}
+
+// sort found objects by distance
+void cat_sort(cat_hit *hits, size_t n){
+	qsort(hits, n, sizeof(cat_hit), hitcmp);
+}
+
+/**
+ * Find `k` nearest objects (cone is widened until it has at least `k` objects)
+ * @return amount of objects found (sorted by distance)
+ */
+size_t cat_nearest(const catalog *c, double ra, double dec, size_t k, cat_hit **hits, size_t *size){
+	size_t n;
+	double r;
+	if(k > c->hdr->count) k = c->hdr->count;
+	if(!k) return 0;
+	// radius of cone with ~4k objects for uniform distribution
+	r = 4. * sqrt((double)k / c->hdr->count) * R2S;
+	if(r < 1.) r = 1.;
+	while((n = cat_cone(c, ra, dec, r, hits, size)) < k && r < 648000.) r *= 4.;
+	cat_sort(*hits, n);
+	return (n < k) ? n : k;
+}
@@ -0,0 +1,83 @@
+/*
+ * catalog.h - memory-mapped binary catalogs with declination zones
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __CATALOG_H__
+#define __CATALOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "usefull_macros.h"
+
+#define CAT_MAGIC       (0x43415442) // "BTAC"
+#define CAT_VER         (1)
+#define CAT_NAMELEN     (32)
+// height of declination zone (arcseconds)
+#define CAT_ZONE        (1800.)
+
+/*
+ * File: header, zone index (nzones+1 numbers of first objects of zones) & objects
+ * sorted by zone & R.A. inside zone; all in host byte order
+ */
+typedef struct{
+	uint32_t magic;     // CAT_MAGIC
+	uint32_t version;   // CAT_VER
+	uint32_t nzones;    // amount of declination zones
+	uint32_t objsize;   // sizeof(cat_obj)
+	uint64_t count;     // amount of objects
+	double zone;        // height of zone (arcseconds)
+	uint64_t reserved[4];
+} cat_hdr;
+
+typedef struct{
+	double ra;          // mean J2000.0 R.A. (seconds of time)
+	double dec;         // mean J2000.0 Decl. (arcseconds)
+	float pmra;         // proper motion by R.A. (mas/year)
+	float pmdec;        // proper motion by Decl. (mas/year)
+	float mag;          // magnitude (NAN if unknown)
+	uint32_t reserved;
+	char name[CAT_NAMELEN];
+} cat_obj;
+
+typedef struct{
+	mmapbuf *map;
+	const cat_hdr *hdr;
+	const uint64_t *zidx;   // zone index
+	const cat_obj *obj;     // objects
+} catalog;
+
+// found object
+typedef struct{
+	const cat_obj *obj;
+	double dist;        // distance (arcseconds)
+} cat_hit;
+
+int cat_parse(char *line, cat_obj *o);
+cat_obj *cat_read_text(char *name, size_t *n);
+int cat_is_binary(char *name);
+int cat_compile(char *text, char *bin);
+catalog *cat_open(char *name);
+void cat_close(catalog *c);
+size_t cat_cone(const catalog *c, double ra, double dec, double r, cat_hit **hits, size_t *size);
+void cat_sort(cat_hit *hits, size_t n);
+size_t cat_nearest(const catalog *c, double ra, double dec, size_t k, cat_hit **hits, size_t *size);
+
+#endif // __CATALOG_H__
@@ -19,46 +19,27 @@
  * MA 02110-1301, USA.
  */
 
+#define _GNU_SOURCE // O_NOFOLLOW
 #include "ch4run.h"
+#include "usefull_macros.h" // dtime
 #include <stdio.h>		// printf, fopen, ...
 #include <unistd.h>		// getpid
-#include <stdio.h>		// perror
-#include <sys/types.h>	// opendir
-#include <dirent.h>		// opendir
+#include <errno.h>		// errno
+#include <sys/file.h>	// flock
 #include <sys/stat.h>	// stat
-#include <fcntl.h>		// fcntl
+#include <fcntl.h>		// open
 #include <stdlib.h>		// exit
 #include <string.h>		// memset
+#include <time.h>		// nanosleep
 
-/**
- * read process name from /proc/PID/cmdline
- * @param pid - PID of interesting process
- * @return filename or NULL if not found
- * 		don't use this function twice for different names without copying
- * 		its returning by strdup, because `name` contains in static array
+/*
+ * Instance & resources control by advisory locks: lock is held while file descriptor
+ * is open, so it is released by kernel when process dies and stale pidfiles don't
+ * need any checking; daemon's children inherit its lock. Locks of resources are shared by
+ * all users, so their files are created with mode 0666 and never removed. Files are in
+ * world-writable directory: symlinks & hard links aren't followed (they could point to
+ * files of user, which would be truncated).
  */
-char *readname(pid_t pid){
-	static char name[256];
-	char *pp = name, byte, path[256];
-	FILE *file;
-	int cntr = 0;
-	size_t sz;
-	snprintf (path, 255, PROC_BASE "/%d/cmdline", pid);
-	file = fopen(path, "r");
-	if(!file) return NULL; // there's no such file
-	do{	// read basename
-		sz = fread(&byte, 1, 1, file);
-		if(sz != 1) break;
-		if(byte != '/') *pp++ = byte;
-		else{
-			pp = name;
-			cntr = 0;
-		}
-	}while(byte && cntr++ < 255);
-	name[cntr] = 0;
-	fclose(file);
-	return name;
-}
 
 void iffound_default(pid_t pid){
 	fprintf(stderr, "\nFound running process (pid=%d), exit.\n", pid);
@@ -66,56 +47,120 @@ void iffound_default(pid_t pid){
 }
 
 /**
- * check wether there is a same running process
- * exit if there is a running process or error
- * Checking have 3 steps:
- * 		1) lock executable file
- * 		2) check pidfile (if you run a copy?)
- * 		3) check /proc for executables with the same name (no/wrong pidfile)
- * @param argv - argument of main() or NULL for non-locking, call this function before getopt()
- * @param pidfilename - name of pidfile or NULL if none
+ * open & lock file; check that it wasn't removed by previous owner after we opened it
+ * @param path  - filename
+ * @param nonblock - ==1 for LOCK_NB
+ * @param mode  - permissions of file (umask is ignored)
+ * @return fd (read-only if file belongs to another user & isn't writable) or -1 if file
+ *          is locked by another process
+ */
+static int lockfile(const char *path, int nonblock, mode_t mode){
+	int fd;
+	struct stat fs, ps;
+	while(1){
+		// flock() don't need write access, so file of another user is enough to lock
+		if((fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW, mode)) < 0 && (errno != EACCES
+			|| (fd = open(path, O_RDONLY | O_NOFOLLOW)) < 0)){
+			perror(path);
+			exit(1);
+		}
+		if(fstat(fd, &fs) || !S_ISREG(fs.st_mode) || fs.st_nlink != 1){
+			fprintf(stderr, "%s isn't a regular file or has links\n", path);
+			exit(1);
+		}
+		// umask could cut permissions of new file
+		if(fs.st_uid == geteuid() && (fs.st_mode & 0777) != mode)
+			fchmod(fd, mode);
+		while(flock(fd, LOCK_EX | (nonblock ? LOCK_NB : 0))){
+			if(errno == EINTR) continue;
+			close(fd);
+			if(errno == EWOULDBLOCK) return -1;
+			perror("flock()");
+			exit(1);
+		}
+		if(fstat(fd, &fs) == 0 && stat(path, &ps) == 0 && fs.st_ino == ps.st_ino
+			&& fs.st_dev == ps.st_dev) return fd;
+		close(fd); // file was unlinked & created again: try once more
+	}
+}
+
+/**
+ * check wether there is a same running process (one `flock` instead of /proc scan)
+ * exit if there is a running process or error; lock is held until process ends
+ * @param pidfilename - name of pidfile
  * @param iffound - action to run if file found or NULL for exit(0)
  */
 void check4running(char *pidfilename, void (*iffound)(pid_t pid)){
-	DIR *dir;
-	FILE *pidfile;
-	struct dirent *de;
-	struct stat s_buf;
-	pid_t pid = 0, self;
-	char *name, *myname;
+	int fd;
+	char buf[32];
 	if(!iffound) iffound = iffound_default;
-	self = getpid(); // get self PID
-	if(!(dir = opendir(PROC_BASE))){ // open /proc directory
-		perror(PROC_BASE);
-		exit(1);
-	}
-	if(!(name = readname(self))){ // error reading self name
-		perror("Can't read self name");
-		exit(1);
-	}
-	myname = strdup(name);
-	if(pidfilename && stat(pidfilename, &s_buf) == 0){ // pidfile exists
-		pidfile = fopen(pidfilename, "r");
+	if(!pidfilename) return;
+	if((fd = lockfile(pidfilename, 1, 0644)) < 0){ // locked: read PID of running process
+		pid_t pid = 0;
+		FILE *pidfile = fopen(pidfilename, "r");
 		if(pidfile){
-			if(fscanf(pidfile, "%d", &pid) > 0){ // read PID of (possibly) running process
-				if((name = readname(pid)) && strncmp(name, myname, 255) == 0)
-					iffound(pid);
-			}
+			if(fscanf(pidfile, "%d", &pid) != 1) pid = 0;
 			fclose(pidfile);
 		}
+		iffound(pid);
+		return;
 	}
-	// There is no pidfile or it consists a wrong record
-	while((de = readdir(dir))){ // scan /proc
-		if(!(pid = (pid_t)atoi(de->d_name)) || pid == self) // pass non-PID files and self
-			continue;
-		if((name = readname(pid)) && strncmp(name, myname, 255) == 0)
-			iffound(pid);
+	// old content is stale anyway
+	int l = snprintf(buf, 32, "%d\n", getpid());
+	if(ftruncate(fd, 0) || write(fd, buf, l) != l) perror(pidfilename);
+	// don't close fd: it holds the lock
+}
+
+/**
+ * Lock resource (file LOCK_DIR/bta_control.`name`.lock)
+ * @param name    - resource name
+ * @param timeout - max time of waiting (seconds): <0 - forever, 0 - don't wait
+ * @return file descriptor of lock or -1 if resource is busy
+ */
+int lock_resource(const char *name, double timeout){
+	char path[256];
+	int fd;
+	snprintf(path, 256, LOCK_DIR "/bta_control.%s.lock", name);
+	if(timeout < 0.) fd = lockfile(path, 0, 0666);
+	else{
+		struct timespec ts = {0, 10000000L}; // check each 10ms
+		double deadline = dtime() + timeout;
+		while((fd = lockfile(path, 1, 0666)) < 0 && dtime() < deadline)
+			nanosleep(&ts, NULL);
 	}
-	closedir(dir);
-	if(pidfilename){
-		pidfile = fopen(pidfilename, "w");
-		fprintf(pidfile, "%d\n", self); // write self PID to pidfile
-		fclose(pidfile);
+	if(fd > -1 && (fcntl(fd, F_GETFL) & O_ACCMODE) == O_RDWR){ // store owner's PID
+		int l = snprintf(path, 256, "%d\n", getpid());
+		if(ftruncate(fd, 0) || pwrite(fd, path, l, 0) != l) perror("lock_resource()");
 	}
-	free(myname);
+	return fd;
+}
+
+/**
+ * Get PID of process locked resource
+ * @return PID or 0 if unknown
+ */
+pid_t resource_owner(const char *name){
+	char path[256];
+	int pid = 0, fd;
+	struct stat st;
+	FILE *f;
+	snprintf(path, 256, LOCK_DIR "/bta_control.%s.lock", name);
+	if((fd = open(path, O_RDONLY | O_NOFOLLOW)) < 0) return 0;
+	// owner could lock file which isn't writable for him, then PID in file is stale
+	if(fstat(fd, &st) || !S_ISREG(st.st_mode) || (st.st_mode & 0666) != 0666 || !(f = fdopen(fd, "r"))){
+		close(fd);
+		return 0;
+	}
+	if(fscanf(f, "%d", &pid) != 1) pid = 0;
+	fclose(f);
+	return (pid_t)pid;
+}
+
+/**
+ * Release lock got by lock_resource
+ */
+void unlock_resource(int fd){
+	if(fd < 0) return;
+	flock(fd, LOCK_UN);
+	close(fd);
 }
@@ -18,11 +18,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
  * MA 02110-1301, USA.
  */
-#ifndef PROC_BASE
-#define PROC_BASE "/proc"
+#ifndef LOCK_DIR
+#define LOCK_DIR "/tmp"
 #endif
 
 #include <unistd.h>  // pid_t
 
 void iffound_default(pid_t pid);
 void check4running(char *pidfilename, void (*iffound)(pid_t pid));
+int lock_resource(const char *name, double timeout);
+void unlock_resource(int fd);
+pid_t resource_owner(const char *name);
@@ -0,0 +1,228 @@
+/*
+ * cmdlat.c - latency of commands: from sending to reaction in shared data
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <math.h>
+
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+#include "angle_functions.h"
+#include "timers.h"
+#include "cmdlat.h"
+
+/*
+ * Each command sent is stored with values of shared data fields it should change;
+ * after each refresh of data these fields are compared with stored, the first change
+ * gives latency of ACS reaction. When a new command watches the same fields as pending one,
+ * their reactions can't be told apart: change is credited only to the newest command and
+ * older is counted as superseded. Latencies are collected into histograms by command
+ * codes with log2 bins: [0, 1ms), [1, 2ms), [2, 4ms) ... [2^(CMDLAT_NBINS-2)ms, inf).
+ */
+#define CMDLAT_MAXCODE   (64)
+#define CMDLAT_NBINS     (16)
+#define CMDLAT_MAXPEND   (32)
+
+// reads fields which should be changed by command
+typedef void (*watcher)(double v[2]);
+#define WATCH(name, f1, f2)  static void w_ ## name(double v[2]){v[0] = (double)(f1); v[1] = (double)(f2);}
+WATCH(radec,  InpAlpha, InpDelta)
+WATCH(azimz,  InpAzim, InpZdist)
+WATCH(mode,   Sys_Mode, 0)
+WATCH(target, Sys_Target, 0)
+WATCH(p2mode, P2_Mode, 0)
+WATCH(p2,     P2_State, 0)
+WATCH(focus,  Foc_State, 0)
+WATCH(pcs,    Pos_Corr, 0)
+WATCH(azrev,  Az_Mode, 0)
+WATCH(telmode,Tel_Mode, 0)
+WATCH(dome,   Dome_State, 0)
+#undef WATCH
+
+typedef struct{
+	const char *name;
+	watcher w;
+	const char *fields;
+} cmddescr;
+
+static const cmddescr cmds[CMDLAT_MAXCODE] = {
+	[StopTel]   = {"StopTeleskope", w_mode,   "Sys_Mode"},
+	[SetTmr]    = {"SetTimerMode",  NULL,     NULL},
+	[SetModMod] = {"SetModelMode",  NULL,     NULL},
+	[SetVA]     = {"SetSpeedA",     NULL,     NULL},
+	[SetVZ]     = {"SetSpeedZ",     NULL,     NULL},
+	[SetVP]     = {"SetSpeedP",     NULL,     NULL},
+	[SetAD]     = {"SetRADec",      w_radec,  "InpAlpha/InpDelta"},
+	[SetAZ]     = {"SetAzimZ",      w_azimz,  "InpAzim/InpZdist"},
+	[GoToAD]    = {"GoToObject",    w_mode,   "Sys_Mode"},
+	[MoveToAD]  = {"MoveToObject",  w_mode,   "Sys_Mode"},
+	[GoToAZ]    = {"GoToAzimZ",     w_mode,   "Sys_Mode"},
+	[SetModP]   = {"SetPMode",      w_p2mode, "P2_Mode"},
+	[P2Move]    = {"MoveP2",        w_p2,     "P2_State"},
+	[FocMove]   = {"MoveFocus",     w_focus,  "Foc_State"},
+	[UsePCorr]  = {"SwitchPosCorr", w_pcs,    "Pos_Corr"},
+	[SetRevA]   = {"SetAzRevers",   w_azrev,  "Az_Mode"},
+	[SetTarg]   = {"SetSysTarg",    w_target, "Sys_Target"},
+	[CorrAD]    = {"DoADcorr",      w_mode,   "Sys_Mode"},
+	[CorrAZ]    = {"DoAZcorr",      w_mode,   "Sys_Mode"},
+	[P2MoveTo]  = {"MoveP2To",      w_p2,     "P2_State"},
+	[StartTel]  = {"StartTeleskope",w_mode,   "Sys_Mode"},
+	[SetTMod]   = {"SetTelMode",    w_telmode,"Tel_Mode"},
+	[SetModD]   = {"SetDomeMode",   w_dome,   "Dome_State"},
+	[DomeMove]  = {"MoveDome",      w_dome,   "Dome_State"},
+};
+
+// command waiting for reaction
+typedef struct{
+	int code;
+	double tsend;     // mtime() of sending
+	double v[2];      // values of watched fields at sending
+} pending;
+
+// statistics by command code
+typedef struct{
+	uint32_t sent;
+	uint32_t failed;      // msgsnd errors
+	uint32_t eagain;      // ... because queue was full
+	uint32_t reacted;     // amount of commands with detected reaction
+	uint32_t noreact;     // no reaction during CMDLAT_TMOUT
+	uint32_t superseded;  // newer command watching the same fields was sent before reaction
+	double sum, max;      // latencies
+	uint32_t hist[CMDLAT_NBINS];
+} cmdstat;
+
+static pending pend[CMDLAT_MAXPEND];
+static int npend = 0;
+static cmdstat cstat[CMDLAT_MAXCODE];
+static FILE *cmdlog = NULL;
+
+static const char *cmdname(int code){
+	static char buf[16];
+	if(code > 0 && code < CMDLAT_MAXCODE && cmds[code].name) return cmds[code].name;
+	snprintf(buf, 16, "cmd%d", code);
+	return buf;
+}
+
+static void cmd_sent(int code, int err){
+	double t = mtime();
+	int i;
+	if(code < 1 || code >= CMDLAT_MAXCODE) return;
+	cmdstat *s = &cstat[code];
+	++s->sent;
+	if(cmdlog) fprintf(cmdlog, "%s %s", time_asc(fmod(dtime(), 86400.)), cmdname(code));
+	if(err){
+		++s->failed;
+		if(err == EAGAIN) ++s->eagain;
+		if(cmdlog) fprintf(cmdlog, ": send failed (%s)\n", strerror(err));
+		return;
+	}
+	if(!cmds[code].w || !sdt){
+		if(cmdlog) fprintf(cmdlog, "\n");
+		return;
+	}
+	if(cmdlog) fprintf(cmdlog, ", wait for %s\n", cmds[code].fields);
+	for(i = 0; i < npend;){ // reaction to older commands on these fields would be credited to this one
+		if(cmds[pend[i].code].w != cmds[code].w){
+			++i;
+			continue;
+		}
+		++cstat[pend[i].code].superseded;
+		if(cmdlog) fprintf(cmdlog, "%s %s: superseded by %s\n", time_asc(fmod(dtime(), 86400.)),
+			cmdname(pend[i].code), cmdname(code));
+		memmove(pend + i, pend + i + 1, sizeof(pending) * (--npend - i));
+	}
+	if(npend == CMDLAT_MAXPEND){ // forget the oldest
+		++cstat[pend[0].code].noreact;
+		memmove(pend, pend + 1, sizeof(pending) * (--npend));
+	}
+	pend[npend].code = code;
+	pend[npend].tsend = t;
+	cmds[code].w(pend[npend].v);
+	++npend;
+}
+
+/**
+ * Start tracking of all commands sent
+ * @param log - file to log each command or NULL
+ */
+void cmdlat_init(FILE *log){
+	cmdlog = log;
+	cmd_sent_hook = cmd_sent;
+}
+
+/**
+ * Check reaction to commands sent (call it after each data refresh)
+ */
+void cmdlat_check(){
+	int i = 0;
+	double t = mtime(), v[2];
+	while(i < npend){
+		pending *p = &pend[i];
+		cmdstat *s = &cstat[p->code];
+		double dt = t - p->tsend;
+		cmds[p->code].w(v);
+		if(v[0] != p->v[0] || v[1] != p->v[1]){
+			int bin = (dt < 1e-3) ? 0 : 1 + (int)log2(dt * 1e3);
+			if(bin >= CMDLAT_NBINS) bin = CMDLAT_NBINS - 1;
+			++s->hist[bin];
+			++s->reacted;
+			s->sum += dt;
+			if(dt > s->max) s->max = dt;
+			if(cmdlog) fprintf(cmdlog, "%s %s: %s changed after %.1fms\n", time_asc(fmod(dtime(), 86400.)),
+				cmdname(p->code), cmds[p->code].fields, dt * 1e3);
+		}else if(dt > CMDLAT_TMOUT){
+			++s->noreact;
+			if(cmdlog) fprintf(cmdlog, "%s %s: no changes of %s\n", time_asc(fmod(dtime(), 86400.)),
+				cmdname(p->code), cmds[p->code].fields);
+		}else{
+			++i;
+			continue;
+		}
+		memmove(p, p + 1, sizeof(pending) * (--npend - i));
+	}
+}
+
+/**
+ * Show statistics & histograms of latencies
+ */
+void cmdlat_report(FILE *f){
+	int code, i;
+	for(code = 1; code < CMDLAT_MAXCODE; ++code){
+		cmdstat *s = &cstat[code];
+		if(!s->sent) continue;
+		fprintf(f, "%s: sent %u, failed %u (queue full: %u)", cmdname(code), s->sent, s->failed, s->eagain);
+		if(!cmds[code].w){
+			fprintf(f, "\n");
+			continue;
+		}
+		int n = 0;
+		for(i = 0; i < npend; ++i) if(pend[i].code == code) ++n;
+		fprintf(f, ", reaction: %u, without reaction: %u", s->reacted, s->noreact);
+		if(s->superseded) fprintf(f, ", superseded: %u", s->superseded);
+		if(n) fprintf(f, ", still waiting: %d", n);
+		if(s->reacted) fprintf(f, ", latency avr %.1fms, max %.1fms", s->sum / s->reacted * 1e3, s->max * 1e3);
+		fprintf(f, "\n");
+		for(i = 0; i < CMDLAT_NBINS; ++i){
+			if(!s->hist[i]) continue;
+			if(i == 0) fprintf(f, "\t     <1ms");
+			else if(i == CMDLAT_NBINS - 1) fprintf(f, "\t%6dms+  ", 1 << (i - 1));
+			else fprintf(f, "\t%6d-%dms", 1 << (i - 1), 1 << i);
+			fprintf(f, "\t%u\n", s->hist[i]);
+		}
+	}
+}
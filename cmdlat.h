@@ -0,0 +1,36 @@
+/*
+ * cmdlat.h - latency of commands: from sending to reaction in shared data
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __CMDLAT_H__
+#define __CMDLAT_H__
+
+#include <stdio.h>
+
+// max waiting of reaction (seconds), after it command is counted as "without reaction"
+#ifndef CMDLAT_TMOUT
+#define CMDLAT_TMOUT    (10.)
+#endif
+
+void cmdlat_init(FILE *log);
+void cmdlat_check();
+void cmdlat_report(FILE *f);
+
+#endif // __CMDLAT_H__
@@ -20,6 +20,8 @@
  */
 #include "cmdlnopts.h"
 #include "usefull_macros.h"
+#include "recorder.h"
+#include "daemon.h"
 #include <assert.h>
 
 /*
@@ -50,6 +52,47 @@ glob_pars Gdefault = {
 	,.getinfo        = NULL
 	,.infoargs       = NULL
 	,.listinfo       = 0
+	,.record         = NULL
+	,.recsize        = REC_DEFSIZE
+	,.recnseg        = 0
+	,.recdur         = 0.
+	,.recread        = NULL
+	,.recat          = NULL
+	,.daemon         = 0
+	,.client         = 0
+	,.socket         = NULL
+	,.lockwait       = -1.
+	,.keycache       = 0
+	,.forget         = 0
+	,.starttimes     = 0
+	,.script         = NULL
+	,.stoponerr      = 0
+	,.steptimes      = 0
+	,.serial         = 0
+	,.cmdlat         = 0
+	,.format         = NULL
+	,.monitor        = -1.
+	,.mondur         = 0.
+	,.monout         = NULL
+	,.rotsize        = 0
+	,.rottime        = 0.
+	,.stamps         = 0
+	,.delta          = -1.
+	,.deadband       = NULL
+	,.exporter       = NULL
+	,.plan           = NULL
+	,.plandate       = NULL
+	,.planstep       = 5.
+	,.planzmax       = 80.
+	,.planzmin       = 5.
+	,.plansun        = -12.
+	,.plancurves     = NULL
+	,.planthreads    = 0
+	,.aptol          = 60.
+	,.catalog        = NULL
+	,.catcompile     = NULL
+	,.cone           = NULL
+	,.nearest        = 0
 };
 
 /*
@@ -72,6 +115,7 @@ myoption cmdlnopts[] = {
 	{"epoch",   2,	NULL,	'E',	arg_string,	APTR(&G.epoch),		N_("epoch for given RA/Decl (without argument is \"now\")")},
 	{"pm-ra",	1,	NULL,	'x',	arg_double,	APTR(&G.pmra),		N_("proper motion by R.A.  (mas/year)")},
 	{"pm-decl",	1,	NULL,	'y',	arg_double,	APTR(&G.pmdecl),	N_("proper motion by Decl. (mas/year)")},
+	{"ap-tolerance",1,NULL,	1,		arg_double,	APTR(&G.aptol),		N_("max age of cached star-independent parameters of apparent place (seconds, default: 60)")},
 	{"pcs-off",	0,	NULL,	'O',	arg_int,	APTR(&G.PCSoff),	N_("turn OFF pointing correction system")},
 	{"az-corr",	1,	NULL,	1,		arg_string,	APTR(&G.corrAZ),	N_("run correction by A/Z (arg in arcsec: dA,dZ)")},
 	{"rad-corr",1,	NULL,	1,		arg_string,	APTR(&G.corrRAD),	N_("run correction by RA/Decl (arg in arcsec: dRA,dDecl)")},
@@ -79,6 +123,46 @@ myoption cmdlnopts[] = {
 	{"get-info",2,	NULL,	'I',	arg_string,	APTR(&G.getinfo),	N_("show information (default: all, \"help\" for list)")},
 	{"info-args",1,	NULL,	'i',	arg_string,	APTR(&G.infoargs),	N_("show values of given ACS parameters")},
 	{"list-info",0,	NULL,	'l',	arg_string,	APTR(&G.listinfo),	N_("list all ACS parameters available")},
+	{"record",	1,	NULL,	'r',	arg_string,	APTR(&G.record),	N_("record all data changes into files with given prefix")},
+	{"rec-size",1,	NULL,	1,		arg_int,	APTR(&G.recsize),	N_("amount of records in one file")},
+	{"rec-nseg",1,	NULL,	1,		arg_int,	APTR(&G.recnseg),	N_("amount of files in ring (0 - unlimited)")},
+	{"rec-duration",1,NULL,	1,		arg_double,	APTR(&G.recdur),	N_("recording duration in seconds (0 - until signal)")},
+	{"rec-read",1,	NULL,	1,		arg_string,	APTR(&G.recread),	N_("read record file (without -t show its summary)")},
+	{"rec-at",	1,	NULL,	't',	arg_string,	APTR(&G.recat),		N_("show recorded data at given time (HH:MM:SS)")},
+	{"daemon",	0,	NULL,	'D',	arg_int,	APTR(&G.daemon),	N_("run as daemon serving requests of clients")},
+	{"client",	0,	NULL,	'C',	arg_int,	APTR(&G.client),	N_("send request to daemon (run locally if there's no daemon)")},
+	{"socket",	1,	NULL,	1,		arg_string,	APTR(&G.socket),	N_("path to daemon's socket (default: " BTA_SOCKET ")")},
+	{"lock-wait",1,	NULL,	1,		arg_double,	APTR(&G.lockwait),	N_("max time to wait for busy actuator (seconds, <0 - forever)")},
+	{"keycache",0,	NULL,	1,		arg_int,	APTR(&G.keycache),	N_("use cached access key & store it after login")},
+	{"forget-key",0,NULL,	1,		arg_int,	APTR(&G.forget),	N_("remove cached access key and exit")},
+	{"startup-times",0,NULL,1,		arg_int,	APTR(&G.starttimes),N_("show time spent in each phase before first command")},
+	{"script",	1,	NULL,	's',	arg_string,	APTR(&G.script),	N_("run commands from file (\"-\" - stdin), each line - options of one run")},
+	{"stop-on-error",0,NULL,1,		arg_int,	APTR(&G.stoponerr),	N_("stop script at first failed step")},
+	{"step-times",0,NULL,	1,		arg_int,	APTR(&G.steptimes),	N_("show running time of each script step")},
+	{"serial",	0,	NULL,	1,		arg_int,	APTR(&G.serial),	N_("move P2, focus & telescope one by one (not simultaneously)")},
+	{"cmd-latency",0,NULL,	1,		arg_int,	APTR(&G.cmdlat),	N_("log commands sent & latency of ACS reaction, show histograms at exit")},
+	{"format",	1,	NULL,	1,		arg_string,	APTR(&G.format),	N_("output format of information: text (default), json, csv or bin")},
+	{"monitor",	1,	NULL,	1,		arg_double,	APTR(&G.monitor),	N_("show information periodically with given period (seconds, 0 - on each server tick)")},
+	{"mon-duration",1,NULL,	1,		arg_double,	APTR(&G.mondur),	N_("monitoring duration in seconds (0 - until signal)")},
+	{"mon-output",1,NULL,	1,		arg_string,	APTR(&G.monout),	N_("write monitoring output into given file")},
+	{"rotate-size",1,NULL,	1,		arg_int,	APTR(&G.rotsize),	N_("rotate monitoring output when its size exceeds given amount of kB")},
+	{"rotate-time",1,NULL,	1,		arg_double,	APTR(&G.rottime),	N_("rotate monitoring output each given amount of seconds (aligned to UTC)")},
+	{"timestamps",0,NULL,	1,		arg_int,	APTR(&G.stamps),	N_("show timestamp of each sample")},
+	{"delta",	1,	NULL,	1,		arg_double,	APTR(&G.delta),		N_("show only changed values, all of them each given amount of seconds (0 - only first time)")},
+	{"deadband",1,	NULL,	1,		arg_string,	APTR(&G.deadband),	N_("min changes shown by --delta: Name=value[,Name=value...]")},
+	{"exporter",1,	NULL,	1,		arg_string,	APTR(&G.exporter),	N_("serve OpenMetrics page on given [host:]port (default host: 127.0.0.1)")},
+	{"plan",	1,	NULL,	1,		arg_string,	APTR(&G.plan),		N_("plan night for targets from file (lines \"name RA Decl\") & exit")},
+	{"plan-date",1,	NULL,	1,		arg_string,	APTR(&G.plandate),	N_("evening date of planned night (YYYY-MM-DD, default: current night)")},
+	{"plan-step",1,	NULL,	1,		arg_double,	APTR(&G.planstep),	N_("time step of planning (minutes, default: 5)")},
+	{"plan-zmax",1,	NULL,	1,		arg_double,	APTR(&G.planzmax),	N_("horizon limit of planning: max Z (degrees, default: 80)")},
+	{"plan-zmin",1,	NULL,	1,		arg_double,	APTR(&G.planzmin),	N_("zenith-avoidance zone of planning: min Z (degrees, default: 5)")},
+	{"plan-sun",1,	NULL,	1,		arg_double,	APTR(&G.plansun),	N_("night is when Sun is lower than given altitude (degrees, default: -12)")},
+	{"plan-curves",1,NULL,	1,		arg_string,	APTR(&G.plancurves),N_("write A/Z, airmass & PA of targets on each step into given CSV file")},
+	{"plan-threads",1,NULL,	1,		arg_int,	APTR(&G.planthreads),N_("amount of planning threads (default: by number of CPUs)")},
+	{"catalog",	1,	NULL,	1,		arg_string,	APTR(&G.catalog),	N_("binary catalog for --cone & --nearest (or output of --cat-compile)")},
+	{"cat-compile",1,NULL,	1,		arg_string,	APTR(&G.catcompile),N_("compile text catalog (lines \"name RA Decl [pmRA pmDecl [mag]]\") into --catalog & exit")},
+	{"cone",	1,	NULL,	1,		arg_string,	APTR(&G.cone),		N_("show catalog objects in cone (arg: \"RA Decl radius\", J2000.0) & exit")},
+	{"nearest",	2,	NULL,	1,		arg_int,	APTR(&G.nearest),	N_("show given amount (default: 1) of catalog objects nearest to current telescope position")},
 	// ...
 	end_option
 };
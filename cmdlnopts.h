@@ -51,6 +51,47 @@ typedef struct{
 	char *getinfo;  // level of requested information (meteo, coords, etc)
 	char *infoargs; // list of requested information (certain parameters)
 	int listinfo;   // show list of information parameters available
+	char *record;   // prefix of record files (recorder mode)
+	int recsize;    // amount of records in one segment
+	int recnseg;    // amount of segments in ring (0 - unlimited)
+	double recdur;  // recording duration (seconds, 0 - until signal)
+	char *recread;  // record file to read
+	char *recat;    // time of record to show
+	int daemon;     // run as daemon: serve requests from clients
+	int client;     // send request to daemon
+	char *socket;   // path to daemon's socket
+	double lockwait;// max time to wait for busy resource (seconds, <0 - forever)
+	int keycache;   // use cached access key
+	int forget;     // remove cached access key
+	int starttimes; // show startup latency of each phase
+	char *script;   // file with commands ("-" - stdin)
+	int stoponerr;  // stop script at first failed step
+	int steptimes;  // show running time of each script step
+	int serial;     // move P2, focus & telescope one by one
+	int cmdlat;     // track latency of commands
+	char *format;   // output format of information (text/json/csv/bin)
+	double monitor; // period of information output (seconds, 0 - each server tick, <0 - once)
+	double mondur;  // monitoring duration (seconds, 0 - until signal)
+	char *monout;   // monitoring output file
+	int rotsize;    // rotate monitoring output when its size exceeds (kB)
+	double rottime; // rotate monitoring output each rottime seconds
+	int stamps;     // show timestamp of each sample
+	double delta;   // show only changed values with keyframe each `delta` seconds (<0 - all values)
+	char *deadband; // dead-bands of changes: Name=value,...
+	char *exporter; // [host:]port of OpenMetrics exporter
+	char *plan;     // file with targets to plan night
+	char *plandate; // evening date of planned night
+	double planstep;// time step of planning (minutes)
+	double planzmax;// horizon limit (degrees)
+	double planzmin;// zenith-avoidance zone (degrees)
+	double plansun; // max Sun altitude at night (degrees)
+	char *plancurves;// output file for curves of targets
+	int planthreads;// amount of planning threads
+	double aptol;   // time tolerance of cached star-independent parameters of apparent place (seconds)
+	char *catalog;  // binary catalog
+	char *catcompile;// text catalog to compile
+	char *cone;     // cone to search in catalog: "RA Decl radius"
+	int nearest;    // amount of nearest objects to show
 }glob_pars;
 
 glob_pars *parce_args(int argc, char **argv);
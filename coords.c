@@ -0,0 +1,239 @@
+/*
+ * coords.c - conversion of coordinates for SAO RAS 6-m telescope
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE // for sincos()
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "coords.h"
+
+// By google maps: 43.646683 (43 38 48.0588), 41.440681 (41 26 26.4516)
+// (real coordinates should be measured relative to mass center, not geoid)
+const double longitude = 149189.175;   // SAO longitude 41 26 29.175 (-2:45:45.945)
+const double Fi = 157152.7;            // SAO latitude 43 39 12.7
+const double cos_fi = 0.7235272793;    // Cos of SAO latitude
+const double sin_fi = 0.6902957888;    // Sin  ---  ""  -----
+
+void calc_AZ(double alpha, double delta, double stime, double *az, double *zd){
+	double sin_t,cos_t, sin_d,cos_d,  cos_z;
+	double t, d, z, a, x, y;
+
+	t = (stime - alpha) * 15.;
+	if (t < 0.)
+	t += S360;      // +360degr
+	t *= S2R;          // -> rad
+	d = delta * S2R;
+	sincos(t, &sin_t, &cos_t);
+	sincos(d, &sin_d, &cos_d);
+
+	cos_z = cos_fi * cos_d * cos_t + sin_fi * sin_d;
+	z = acos(cos_z);
+
+	y = cos_d * sin_t;
+	x = cos_d * sin_fi * cos_t - cos_fi * sin_d;
+	a = atan2(y, x);
+
+	*zd = z * R2S;
+	*az = a * R2S;
+}
+
+double calc_PA(double alpha, double delta, double stime){
+	double sin_t,cos_t, sin_d,cos_d;
+	double t, d, p, sp, cp;
+
+	t = (stime - alpha) * 15.;
+	if (t < 0.)
+		t += S360;      // +360degr
+	t *= S2R;          // -> rad
+	d = delta * S2R;
+	sin_t = sin(t);
+	cos_t = cos(t);
+	sin_d = sin(d);
+	cos_d = cos(d);
+
+	sp = sin_t * cos_fi;
+	cp = sin_fi * cos_d - sin_d * cos_fi * cos_t;
+	p = atan2(sp, cp);
+	if (p < 0.0)
+		p += 2.0*M_PI;
+
+	return(p * R2S);
+}
+
+void calc_AD(double az, double zd, double stime, double *alpha, double *delta){
+	double sin_d, sin_a, cos_a, sin_z, cos_z;
+	double t, d, z, a, x, y;
+	a = az * S2R;
+	z = zd * S2R;
+	sin_a = sin(a);
+	cos_a = cos(a);
+	sin_z = sin(z);
+	cos_z = cos(z);
+
+	y = sin_z * sin_a;
+	x = cos_a * sin_fi * sin_z + cos_fi * cos_z;
+	t = atan2(y, x);
+	if (t < 0.0)
+		t += 2.0*M_PI;
+
+	sin_d = sin_fi * cos_z - cos_fi * cos_a * sin_z;
+	d = asin(sin_d);
+
+	*delta = d * R2S;
+	*alpha = (stime - t * R2S / 15.);
+	if (*alpha < 0.0)
+		*alpha += S360/15.;      // +24h
+}
+
+/*
+ * Batch versions: loops without branches & calls, which compiler vectorizes (coords.c
+ * is built with -O3 -fno-math-errno -fno-trapping-math, see Makefile); on x86-64 there
+ * is also AVX2 clone selected at runtime. sincos: Cody-Waite reduction to [-pi/4, pi/4] & Cephes
+ * polynomials, atan2: reduction to [0, 0.66] & Cephes rational approximation;
+ * acos/asin through atan2. Error of kernels is < 1e-15 rad (2e-10''). With
+ * -DCOORDS_SCALAR batch functions simply call scalar ones.
+ */
+#ifndef COORDS_SCALAR
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define BATCH_FN  __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_FN
+#endif
+
+// 1.5*2^52: adding it rounds double to integer (kept in low bits of mantissa)
+#define RNDC    (6755399441055744.)
+// pi/2 = PIO2_1 + PIO2_2 + PIO2_3 (33 bits each)
+#define PIO2_1  (1.57079632673412561417e+00)
+#define PIO2_2  (6.07710050630396597660e-11)
+#define PIO2_3  (2.02226624871116645580e-21)
+
+static inline uint64_t d2i(double x){ uint64_t i; memcpy(&i, &x, 8); return i; }
+static inline double i2d(uint64_t i){ double x; memcpy(&x, &i, 8); return x; }
+
+static inline void v_sincos(double x, double *s, double *c){
+	double t = x * M_2_PI + RNDC, q = t - RNDC, r, z, ps, pc;
+	uint64_t n = d2i(t), swap = -(n & 1), is, ic;
+	r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+	z = r * r;
+	ps = r + r * z * (((((1.58962301576546568060e-10 * z - 2.50507477628578072866e-8) * z
+		+ 2.75573136213857245213e-6) * z - 1.98412698295895385996e-4) * z
+		+ 8.33333333332211858878e-3) * z - 1.66666666666666307295e-1);
+	pc = 1. - 0.5 * z + z * z * (((((-1.13585365213876817300e-11 * z + 2.08757008419747316778e-9) * z
+		- 2.75573141792967388112e-7) * z + 2.48015872888517045348e-5) * z
+		- 1.38888888888730564116e-3) * z + 4.16666666666665929218e-2);
+	// quadrant n: odd - swap sin & cos; sin < 0 in 2, 3; cos < 0 in 1, 2
+	is = (d2i(ps) & ~swap) | (d2i(pc) & swap);
+	ic = (d2i(pc) & ~swap) | (d2i(ps) & swap);
+	*s = i2d(is ^ ((n & 2) << 62));
+	*c = i2d(ic ^ (((n + 1) & 2) << 62));
+}
+
+static inline double v_atan2(double y, double x){
+	double ax = fabs(x), ay = fabs(y), mx = (ax > ay) ? ax : ay, mn = (ax > ay) ? ay : ax;
+	double t = mn / ((mx > 0.) ? mx : 1.), tr = (t - 1.) / (t + 1.), z, a, off;
+	// t > 0.66: atan(t) = pi/4 + atan((t-1)/(t+1))
+	off = (t > 0.66) ? M_PI_4 : 0.;
+	t = (t > 0.66) ? tr : t;
+	z = t * t;
+	a = off + t + t * z * ((((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z
+		- 7.500855792314704667340e1) * z - 1.228866684490136173410e2) * z - 6.485021904942025371773e1)
+		/ (((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z
+		+ 4.328810604912902668951e2) * z + 4.853903996359136964868e2) * z + 1.945506571482613964425e2);
+	a = (ay > ax) ? M_PI_2 - a : a;
+	a = (x < 0.) ? M_PI - a : a;
+	return (y < 0.) ? -a : a;
+}
+
+static inline double v_acos(double x){
+	double w = (1. - x) * (1. + x);
+	return v_atan2(sqrt((w > 0.) ? w : 0.), x);
+}
+
+static inline double v_asin(double x){
+	double w = (1. - x) * (1. + x);
+	return v_atan2(x, sqrt((w > 0.) ? w : 0.));
+}
+
+BATCH_FN
+void calc_AZ_n(size_t n, const double *restrict alpha, const double *restrict delta,
+		const double *restrict stime, double *restrict az, double *restrict zd){
+	size_t i;
+	for(i = 0; i < n; ++i){
+		double sin_t, cos_t, sin_d, cos_d, t = (stime[i] - alpha[i]) * 15.;
+		t = (t < 0.) ? t + S360 : t;
+		v_sincos(t * S2R, &sin_t, &cos_t);
+		v_sincos(delta[i] * S2R, &sin_d, &cos_d);
+		zd[i] = v_acos(cos_fi * cos_d * cos_t + sin_fi * sin_d) * R2S;
+		az[i] = v_atan2(cos_d * sin_t, cos_d * sin_fi * cos_t - cos_fi * sin_d) * R2S;
+	}
+}
+
+BATCH_FN
+void calc_PA_n(size_t n, const double *restrict alpha, const double *restrict delta,
+		const double *restrict stime, double *restrict pa){
+	size_t i;
+	for(i = 0; i < n; ++i){
+		double sin_t, cos_t, sin_d, cos_d, p, t = (stime[i] - alpha[i]) * 15.;
+		t = (t < 0.) ? t + S360 : t;
+		v_sincos(t * S2R, &sin_t, &cos_t);
+		v_sincos(delta[i] * S2R, &sin_d, &cos_d);
+		p = v_atan2(sin_t * cos_fi, sin_fi * cos_d - sin_d * cos_fi * cos_t);
+		pa[i] = ((p < 0.) ? p + 2. * M_PI : p) * R2S;
+	}
+}
+
+BATCH_FN
+void calc_AD_n(size_t n, const double *restrict az, const double *restrict zd,
+		const double *restrict stime, double *restrict alpha, double *restrict delta){
+	size_t i;
+	for(i = 0; i < n; ++i){
+		double sin_a, cos_a, sin_z, cos_z, t, a;
+		v_sincos(az[i] * S2R, &sin_a, &cos_a);
+		v_sincos(zd[i] * S2R, &sin_z, &cos_z);
+		t = v_atan2(sin_z * sin_a, cos_a * sin_fi * sin_z + cos_fi * cos_z);
+		t = (t < 0.) ? t + 2. * M_PI : t;
+		delta[i] = v_asin(sin_fi * cos_z - cos_fi * cos_a * sin_z) * R2S;
+		a = stime[i] - t * R2S / 15.;
+		alpha[i] = (a < 0.) ? a + S360 / 15. : a;
+	}
+}
+
+#else // COORDS_SCALAR
+
+void calc_AZ_n(size_t n, const double *alpha, const double *delta, const double *stime,
+		double *az, double *zd){
+	size_t i;
+	for(i = 0; i < n; ++i) calc_AZ(alpha[i], delta[i], stime[i], &az[i], &zd[i]);
+}
+
+void calc_PA_n(size_t n, const double *alpha, const double *delta, const double *stime, double *pa){
+	size_t i;
+	for(i = 0; i < n; ++i) pa[i] = calc_PA(alpha[i], delta[i], stime[i]);
+}
+
+void calc_AD_n(size_t n, const double *az, const double *zd, const double *stime,
+		double *alpha, double *delta){
+	size_t i;
+	for(i = 0; i < n; ++i) calc_AD(az[i], zd[i], stime[i], &alpha[i], &delta[i]);
+}
+
+#endif // COORDS_SCALAR
@@ -0,0 +1,52 @@
+/*
+ * coords.h - conversion of coordinates for SAO RAS 6-m telescope
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __COORDS_H__
+#define __COORDS_H__
+
+#include <stddef.h>
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846)
+#endif
+
+#define R2D  (180./M_PI)     // rad. to degr.
+#define D2R  (M_PI/180.)     // degr. to rad.
+#define R2S  (648000./M_PI)  // rad. to sec
+#define S2R  (M_PI/648000.)  // sec. to rad.
+#define S360 (1296000.)    // sec in 360degr
+
+extern const double longitude, Fi, cos_fi, sin_fi;
+
+/*
+ * Times & RA are in seconds of time, angles in arcseconds; batch versions get
+ * structure of arrays (n items each) & differ from scalar ones less than 1e-6''
+ */
+void calc_AZ(double alpha, double delta, double stime, double *az, double *zd);
+double calc_PA(double alpha, double delta, double stime);
+void calc_AD(double az, double zd, double stime, double *alpha, double *delta);
+void calc_AZ_n(size_t n, const double *alpha, const double *delta, const double *stime,
+	double *az, double *zd);
+void calc_PA_n(size_t n, const double *alpha, const double *delta, const double *stime, double *pa);
+void calc_AD_n(size_t n, const double *az, const double *zd, const double *stime,
+	double *alpha, double *delta);
+
+#endif // __COORDS_H__
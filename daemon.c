@@ -0,0 +1,290 @@
+/*
+ * daemon.c - persistent session: commands over local socket
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+
+#include "usefull_macros.h"
+#include "daemon.h"
+
+/*
+ * Daemon keeps shared memory, command queue & access key (all of them are set up
+ * before run_daemon()) and runs each request in forked child, which inherits all this; child
+ * reads request itself, so main loop only accepts connections & sends exit codes (woken up
+ * by SIGCHLD) and never blocks on slow client.
+ * Request:  uint32_t argc with client's stdout & stderr descriptors (SCM_RIGHTS), then argc
+ *           NUL-terminated strings; child writes directly into client's descriptors, so
+ *           any output (even binary) isn't mixed with response.
+ * Response: int32_t exit code.
+ */
+// max size of request
+#define REQ_MAXSIZE     (65536)
+#define REQ_MAXARGS     (256)
+// max amount of simultaneous requests
+#define MAX_CLIENTS     (32)
+// max time of request reading (seconds)
+#define REQ_TMOUT       (1.)
+
+typedef struct{
+	pid_t pid;
+	int fd;
+} dclient;
+
+static dclient clients[MAX_CLIENTS];
+static char *sockname = NULL;
+static pid_t daemonpid = 0;
+static int chldpipe[2] = {-1, -1}; // SIGCHLD wakes up poll() through this pipe
+
+static void sigchld(int sig){
+	int e = errno;
+	(void)sig;
+	if(write(chldpipe[1], "", 1) < 0){} // pipe is full: poll() will wake up anyway
+	errno = e;
+}
+
+static void rm_socket(){
+	if(sockname && getpid() == daemonpid) unlink(sockname);
+}
+
+static int readall(int fd, void *buf, size_t len){
+	uint8_t *p = buf;
+	while(len){
+		ssize_t r = read(fd, p, len);
+		if(r <= 0){
+			if(r < 0 && errno == EINTR) continue;
+			return 0;
+		}
+		p += r;
+		len -= r;
+	}
+	return 1;
+}
+
+static int writeall(int fd, const void *buf, size_t len){
+	const uint8_t *p = buf;
+	while(len){
+		ssize_t w = write(fd, p, len);
+		if(w <= 0){
+			if(w < 0 && errno == EINTR) continue;
+			return 0;
+		}
+		p += w;
+		len -= w;
+	}
+	return 1;
+}
+
+/**
+ * read request from client (socket has receiving timeout, all request should come
+ * during REQ_TMOUT: silent client can't hold slot of request)
+ * @param argv (o) - arguments (pointers to buf)
+ * @return argc or -1 if error
+ */
+static int read_request(int fd, char *buf, char **argv, int *ofd){
+	uint32_t argc, i;
+	size_t len = 0;
+	union{
+		char buf[CMSG_SPACE(2 * sizeof(int))];
+		struct cmsghdr align;
+	} ctl;
+	struct iovec iov = {&argc, sizeof(argc)};
+	struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf)};
+	struct cmsghdr *c;
+	ssize_t r;
+	double t0 = dtime();
+	ofd[0] = ofd[1] = -1;
+	while((r = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR);
+	if((c = CMSG_FIRSTHDR(&msg)) && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS){
+		int n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		if(n > 0) memcpy(ofd, CMSG_DATA(c), sizeof(int) * (n > 1 ? 2 : 1));
+		for(i = 2; i < (uint32_t)n; ++i) close(((int*)CMSG_DATA(c))[i]);
+	}
+	if(r < 1) return -1;
+	if(r < (ssize_t)sizeof(argc) && !readall(fd, (char*)&argc + r, sizeof(argc) - r)) return -1;
+	if(ofd[0] < 0 || ofd[1] < 0 || argc < 1 || argc >= REQ_MAXARGS) return -1;
+	for(i = 0; i < argc; ++i){
+		argv[i] = buf + len;
+		do{
+			if(len == REQ_MAXSIZE || dtime() - t0 > REQ_TMOUT || !readall(fd, buf + len, 1)) return -1;
+		}while(buf[len++]);
+	}
+	argv[argc] = NULL;
+	return (int)argc;
+}
+
+// send exit codes of finished requests to clients
+static void reap(){
+	pid_t pid;
+	int st, i;
+	while((pid = waitpid(-1, &st, WNOHANG)) > 0){
+		for(i = 0; i < MAX_CLIENTS; ++i){
+			if(clients[i].pid != pid) continue;
+			int32_t code = WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+			writeall(clients[i].fd, &code, sizeof(code));
+			close(clients[i].fd);
+			clients[i].pid = 0;
+			DBG("Request %d done, code %d", pid, code);
+			break;
+		}
+	}
+}
+
+/**
+ * Serve requests until signal
+ * @param sockpath - path of UNIX socket
+ * @param handler  - function to run requests
+ */
+void run_daemon(char *sockpath, daemon_handler handler){
+	struct sockaddr_un addr;
+	static char buf[REQ_MAXSIZE];
+	static char *argv[REQ_MAXARGS + 1];
+	int sock, i;
+	if(!sockpath) sockpath = BTA_SOCKET;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(sockpath) >= sizeof(addr.sun_path)) ERRX(_("Too long socket path"));
+	strcpy(addr.sun_path, sockpath);
+	if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) ERR("socket()");
+	// socket file could be stale (daemon was killed) or belong to running daemon
+	if(connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+		ERRX(_("Another daemon is listening on %s"), sockpath);
+	close(sock);
+	if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) ERR("socket()");
+	unlink(sockpath);
+	// socket is the only protection of access key: owner only
+	mode_t oldmask = umask(0077);
+	if(bind(sock, (struct sockaddr*)&addr, sizeof(addr))) ERR(_("Can't bind to %s"), sockpath);
+	umask(oldmask);
+	if(listen(sock, MAX_CLIENTS)) ERR("listen()");
+	sockname = strdup(sockpath);
+	daemonpid = getpid();
+	atexit(rm_socket);
+	signal(SIGPIPE, SIG_IGN); // client could disconnect before request ends
+	if(pipe(chldpipe)) ERR("pipe()");
+	fcntl(chldpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(chldpipe[1], F_SETFL, O_NONBLOCK);
+	struct sigaction sa = {.sa_handler = sigchld, .sa_flags = SA_RESTART | SA_NOCLDSTOP};
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+	memset(clients, 0, sizeof(clients));
+	green(_("Daemon is listening on %s\n"), sockpath);
+	while(1){
+		struct pollfd pfd[2] = {{sock, POLLIN, 0}, {chldpipe[0], POLLIN, 0}};
+		struct timeval tmout = {(time_t)REQ_TMOUT, 0};
+		int fd, argc, ofd[2], j;
+		pid_t pid;
+		char c;
+		if(poll(pfd, 2, -1) < 1) continue;
+		if(pfd[1].revents){
+			while(read(chldpipe[0], &c, 1) > 0);
+			reap();
+		}
+		if(!pfd[0].revents || (fd = accept(sock, NULL, NULL)) < 0) continue;
+		for(i = 0; i < MAX_CLIENTS && clients[i].pid; ++i);
+		if(i == MAX_CLIENTS){
+			WARNX(_("Too much requests"));
+			close(fd);
+			continue;
+		}
+		if((pid = fork()) < 0){
+			WARN("fork()");
+			close(fd);
+			continue;
+		}
+		if(pid == 0){ // child: read request (slow client blocks only itself) & run it
+			// connections of other requests shouldn't wait for end of this one
+			for(j = 0; j < MAX_CLIENTS; ++j) if(clients[j].pid) close(clients[j].fd);
+			close(sock);
+			signal(SIGPIPE, SIG_DFL);
+			signal(SIGCHLD, SIG_DFL);
+			close(chldpipe[0]); close(chldpipe[1]);
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tmout, sizeof(tmout));
+			if((argc = read_request(fd, buf, argv, ofd)) < 1){
+				WARNX(_("Wrong request"));
+				exit(1);
+			}
+			close(fd);
+			DBG("Request %s... run in %d", argv[1] ? argv[1] : "", getpid());
+			// stdout & stderr to client
+			dup2(ofd[0], STDOUT_FILENO);
+			dup2(ofd[1], STDERR_FILENO);
+			close(ofd[0]); close(ofd[1]);
+			exit(handler(argc, argv));
+		}
+		clients[i].pid = pid;
+		clients[i].fd = fd;
+	}
+}
+
+/**
+ * Send request to daemon & show its output
+ * @param sockpath - path of UNIX socket
+ * @return exit code of request or -1 if there's no connection
+ */
+int run_client(char *sockpath, int argc, char **argv){
+	struct sockaddr_un addr;
+	int sock, i;
+	uint32_t n = (uint32_t)argc;
+	int32_t code;
+	int ofd[2] = {STDOUT_FILENO, STDERR_FILENO};
+	union{
+		char buf[CMSG_SPACE(sizeof(ofd))];
+		struct cmsghdr align;
+	} ctl;
+	struct iovec iov = {&n, sizeof(n)};
+	struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf)};
+	struct cmsghdr *c;
+	ssize_t r;
+	if(!sockpath) sockpath = BTA_SOCKET;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, sockpath, sizeof(addr.sun_path) - 1);
+	if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+	if(connect(sock, (struct sockaddr*)&addr, sizeof(addr))){
+		close(sock);
+		return -1;
+	}
+	memset(&ctl, 0, sizeof(ctl));
+	c = CMSG_FIRSTHDR(&msg);
+	c->cmsg_level = SOL_SOCKET;
+	c->cmsg_type = SCM_RIGHTS;
+	c->cmsg_len = CMSG_LEN(sizeof(ofd));
+	memcpy(CMSG_DATA(c), ofd, sizeof(ofd));
+	while((r = sendmsg(sock, &msg, 0)) < 0 && errno == EINTR);
+	if(r < 0) goto bad;
+	if(r < (ssize_t)sizeof(n) && !writeall(sock, (char*)&n + r, sizeof(n) - r)) goto bad;
+	for(i = 0; i < argc; ++i)
+		if(!writeall(sock, argv[i], strlen(argv[i]) + 1)) goto bad;
+	if(!readall(sock, &code, sizeof(code))){
+		close(sock);
+		WARNX(_("Connection with daemon lost"));
+		return 1;
+	}
+	close(sock);
+	return code;
+bad:
+	close(sock);
+	return -1;
+}
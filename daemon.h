@@ -0,0 +1,35 @@
+/*
+ * daemon.h - persistent session: commands over local socket
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#ifndef BTA_SOCKET
+#define BTA_SOCKET  "/tmp/bta_control.sock"
+#endif
+
+// function to run request (its return value is the exit code for client)
+typedef int (*daemon_handler)(int argc, char **argv);
+
+void run_daemon(char *sockpath, daemon_handler handler);
+int run_client(char *sockpath, int argc, char **argv);
+
+#endif // __DAEMON_H__
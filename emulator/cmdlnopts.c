@@ -0,0 +1,94 @@
+/*
+ * cmdlnopts.c - the only function that parce cmdln args and returns glob parameters
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include "cmdlnopts.h"
+#include "usefull_macros.h"
+#include <assert.h>
+
+/*
+ * here are global parameters initialisation
+ */
+glob_pars G;  // internal global parameters structure
+int help = 0; // whether to show help string
+
+glob_pars Gdefault = {
+	 .tick           = 0.1
+	,.passwd         = NULL
+	,.vAZ            = 2400.
+	,.aAZ            = 300.
+	,.vP2            = 2700.
+	,.aP2            = 2700.
+	,.vF             = 0.63
+	,.aF             = 1.
+	,.vD             = 1800.
+	,.aD             = 300.
+	,.A0             = 0.
+	,.Z0             = 45.
+	,.P0             = 0.
+	,.F0             = 100.
+};
+
+/*
+ * Define command line options by filling structure:
+ *	name	has_arg	flag	val		type		argptr			help
+*/
+myoption cmdlnopts[] = {
+	{"help",	0,	NULL,	'h',	arg_int,	APTR(&help),		N_("show this help")},
+	{"tick",	1,	NULL,	't',	arg_double,	APTR(&G.tick),		N_("data publishing period (seconds)")},
+	{"passwd",	1,	NULL,	'w',	arg_string,	APTR(&G.passwd),	N_("password for all access levels (default: no access control)")},
+	{"vel-az",	1,	NULL,	1,		arg_double,	APTR(&G.vAZ),		N_("max A/Z speed (''/s)")},
+	{"acc-az",	1,	NULL,	1,		arg_double,	APTR(&G.aAZ),		N_("max A/Z acceleration (''/s^2)")},
+	{"vel-p2",	1,	NULL,	1,		arg_double,	APTR(&G.vP2),		N_("max P2 speed (''/s)")},
+	{"acc-p2",	1,	NULL,	1,		arg_double,	APTR(&G.aP2),		N_("max P2 acceleration (''/s^2)")},
+	{"vel-foc",	1,	NULL,	1,		arg_double,	APTR(&G.vF),		N_("max focus speed (mm/s)")},
+	{"acc-foc",	1,	NULL,	1,		arg_double,	APTR(&G.aF),		N_("max focus acceleration (mm/s^2)")},
+	{"vel-dome",1,	NULL,	1,		arg_double,	APTR(&G.vD),		N_("max dome speed (''/s)")},
+	{"acc-dome",1,	NULL,	1,		arg_double,	APTR(&G.aD),		N_("max dome acceleration (''/s^2)")},
+	{"azimuth",	1,	NULL,	'A',	arg_double,	APTR(&G.A0),		N_("initial azimuth (degrees)")},
+	{"zenith",	1,	NULL,	'Z',	arg_double,	APTR(&G.Z0),		N_("initial zenith distance (degrees)")},
+	{"p2",		1,	NULL,	'P',	arg_double,	APTR(&G.P0),		N_("initial P2 angle (degrees)")},
+	{"focus",	1,	NULL,	'F',	arg_double,	APTR(&G.F0),		N_("initial focus (mm)")},
+	end_option
+};
+
+
+/**
+ * Parce command line options and return dynamically allocated structure
+ * 		to global parameters
+ * @param argc - copy of argc from main
+ * @param argv - copy of argv from main
+ * @return allocated structure with global parameters
+ */
+glob_pars *parce_args(int argc, char **argv){
+	int i;
+	void *ptr;
+	ptr = memcpy(&G, &Gdefault, sizeof(G)); assert(ptr);
+	// format of help: "Usage: progname [args]\n"
+	change_helpstring("Usage: %s [args]\n\n\tWhere args are:\n");
+	// parse arguments
+	parceargs(&argc, &argv, cmdlnopts);
+	if(help) showhelp(-1, cmdlnopts);
+	if(argc > 0){
+		printf("\nIgnore argument[s]:\n");
+		for (i = 0; i < argc; i++)
+			printf("\t%s\n", argv[i]);
+	}
+	return &G;
+}
@@ -0,0 +1,52 @@
+/*
+ * cmdlnopts.h - comand line options for parceargs
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#pragma once
+#ifndef __CMDLNOPTS_H__
+#define __CMDLNOPTS_H__
+
+#include "parceargs.h"
+
+/*
+ * here are some typedef's for global data
+ */
+
+typedef struct{
+	double tick;    // data publishing period (seconds)
+	char *passwd;   // password for all access levels
+	double vAZ;     // max A/Z speed (''/s)
+	double aAZ;     // max A/Z acceleration (''/s^2)
+	double vP2;     // max P2 speed (''/s)
+	double aP2;     // max P2 acceleration (''/s^2)
+	double vF;      // max focus speed (mm/s)
+	double aF;      // max focus acceleration (mm/s^2)
+	double vD;      // max dome speed (''/s)
+	double aD;      // max dome acceleration (''/s^2)
+	double A0;      // initial azimuth (degrees)
+	double Z0;      // initial zenith distance (degrees)
+	double P0;      // initial P2 angle (degrees)
+	double F0;      // initial focus (mm)
+}glob_pars;
+
+glob_pars *parce_args(int argc, char **argv);
+extern glob_pars *GP;
+
+#endif // __CMDLNOPTS_H__
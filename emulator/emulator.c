@@ -0,0 +1,513 @@
+/*
+ * emulator.c - ACS stand-in: telescope axes dynamics & commands processing
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // sincos, tm_gmtoff
+#endif
+#include <math.h>
+#include <time.h>
+
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+#include "emulator.h"
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846)
+#endif
+#define S2R  (M_PI/648000.)  // sec. to rad.
+#define R2S  (648000./M_PI)  // rad. to sec
+#define S360 (1296000.)      // sec in 360degr
+
+// SAO longitude (in seconds of time) & latitude (in arcsec), the same as in bta_print.c
+static const double longitude = 149189.175 / 15.;
+static const double Fi = 157152.7;
+
+// pointing is over when difference less than this value (arcsec)
+#define POINT_THRES   (60.)
+// tracking is OK when difference less than this value (arcsec)
+#define TRACK_THRES   (1.)
+// position of axis in AXIS_GOTO mode is reached (in units of axis)
+#define GOTO_EPS      (1e-3)
+// focus limits, mm
+#define FOCUS_MIN     (0.)
+#define FOCUS_MAX     (200.)
+// ratio of low to high focus speed (0.13 / 0.63 mm/s)
+#define FOC_LOWSPEED  (0.2)
+// azimuth end-switches, arcsec
+#define AZ_LIMIT      (864000.)
+
+emul_stat Estat = {0};
+
+static struct{
+	int haspass;       // ==1 if access keys are set
+	uint32_t key[6];   // access keys for levels 1..5
+	double corrA;      // user corrections by A/Z (arcsec)
+	double corrZ;
+	double corrAlp;    // user corrections by RA (sec) / Decl (arcsec)
+	double corrDel;
+	int savedmode;     // Sys_Mode before correction
+	double p2vel;      // P2 velocity for P2Move command
+} E = {0};
+
+/**
+ * convert equatorial coordinates into horizontal (the same algorithm as calc_AZ())
+ * @param alpha, delta - RA (seconds of time) & Decl (arcsec)
+ * @param stime        - sidereal time (seconds)
+ * @param az, zd (o)   - azimuth & zenith distance (arcsec)
+ */
+static void eq2hor(double alpha, double delta, double stime, double *az, double *zd){
+	double sin_t, cos_t, sin_d, cos_d, sin_fi, cos_fi;
+	double t = (stime - alpha) * 15.;
+	if(t < 0.) t += S360;
+	sincos(t * S2R, &sin_t, &cos_t);
+	sincos(delta * S2R, &sin_d, &cos_d);
+	sincos(Fi * S2R, &sin_fi, &cos_fi);
+	*zd = acos(cos_fi * cos_d * cos_t + sin_fi * sin_d) * R2S;
+	*az = atan2(cos_d * sin_t, cos_d * sin_fi * cos_t - cos_fi * sin_d) * R2S;
+}
+
+/**
+ * convert horizontal coordinates into equatorial (the same algorithm as calc_AD())
+ */
+static void hor2eq(double az, double zd, double stime, double *alpha, double *delta){
+	double sin_a, cos_a, sin_z, cos_z, sin_fi, cos_fi, t;
+	sincos(az * S2R, &sin_a, &cos_a);
+	sincos(zd * S2R, &sin_z, &cos_z);
+	sincos(Fi * S2R, &sin_fi, &cos_fi);
+	t = atan2(sin_z * sin_a, cos_a * sin_fi * sin_z + cos_fi * cos_z);
+	if(t < 0.) t += 2.*M_PI;
+	*delta = asin(sin_fi * cos_z - cos_fi * cos_a * sin_z) * R2S;
+	*alpha = stime - t * R2S / 15.;
+	if(*alpha < 0.) *alpha += S360 / 15.;
+}
+
+/**
+ * calculate all time values by system clock
+ */
+static void set_times(){
+	double t = dtime(), gmst, jd;
+	time_t tt = (time_t)t;
+	struct tm tm;
+	jd = t / 86400. + 2440587.5;
+	// mean sidereal time, hours
+	gmst = fmod(18.697374558 + 24.06570982441908 * (jd - 2451545.0), 24.);
+	if(gmst < 0.) gmst += 24.;
+	M_time = fmod(t, 86400.);
+	S_time = fmod(gmst * 3600. + longitude, 86400.);
+	EE_time = 0.;
+	JDate = jd;
+	localtime_r(&tt, &tm);
+	L_time = fmod(M_time + tm.tm_gmtoff + 86400., 86400.);
+}
+
+/**
+ * Initial values of shared data & axes
+ * @param T - axes with positions & limits set from command line
+ */
+void emul_init(telescope *T){
+	ServPID = getpid();
+	UseModel = FullModel;
+	ClockType = SysTimer;
+	Sys_Mode = SysStop;
+	Sys_Target = TagPosition;
+	Tel_Focus = Prime;
+	Tel_State = Req_State = Stopping;
+	Tel_Hardware = Hard_On;
+	Tel_Mode = Automatic;
+	Az_Mode = Rev_Off;
+	P2_State = P2_Mode = P2_Off;
+	Foc_State = Foc_Off;
+	Dome_State = D_Off;
+	Pos_Corr = PC_On;
+	set_times();
+	InpAzim = T->A.pos; InpZdist = T->Z.pos;
+	hor2eq(T->A.pos, T->Z.pos, S_time, (double*)&InpAlpha, (double*)&InpDelta);
+	SrcAlpha = CurAlpha = InpAlpha;
+	SrcDelta = CurDelta = InpDelta;
+	T->A.target = T->A.pos; T->Z.target = T->Z.pos;
+	T->P.target = T->P.pos; T->F.target = T->F.pos; T->D.target = T->D.pos;
+	val_T1 = inp_T1 = 5.; val_T2 = inp_T2 = 8.; val_T3 = inp_T3 = 7.;
+	val_B = inp_B; val_Wnd = inp_Wnd = 2.; val_Hmd = 40.;
+	Temper = val_T1;
+	PressOilA = PressOilZ = 10.; PressOilTank = 1.;
+	OilTemper1 = 15.; OilTemper2 = 10.;
+	E.p2vel = T->P.vmax;
+}
+
+/**
+ * Set access levels codes & keys by password (the same for all levels)
+ * @param passwd - password or NULL for no access control
+ */
+void emul_set_passwd(char *passwd){
+	int n;
+	uint32_t code;
+	if(!passwd){
+		E.haspass = 0;
+		return;
+	}
+	for(n = 1; n < 6; ++n){
+		encode_lev_passwd(passwd, n, &E.key[n], &code);
+		code_Lev(n) = code;
+	}
+	E.haspass = 1;
+}
+
+// start moving axis to given position
+static void axis_goto(axis *a, double pos){
+	a->target = pos;
+	a->tvel = 0.;
+	a->ttime = 0.;
+	a->mode = AXIS_GOTO;
+}
+
+// start moving axis with given speed for a given time
+static void axis_move(axis *a, double vel, double time){
+	if(vel > a->vmax) vel = a->vmax;
+	else if(vel < -a->vmax) vel = -a->vmax;
+	a->tvel = vel;
+	a->tend = dtime() + time;
+	a->mode = (time > 0. && fabs(vel) > 0.) ? AXIS_VEL : AXIS_STOP;
+}
+
+/**
+ * Make one step of axis dynamics
+ * @param a  - axis
+ * @param dt - time interval
+ * @param t  - current time
+ */
+static void axis_step(axis *a, double dt, double t){
+	double vreq = 0., dv = a->amax * dt;
+	switch(a->mode){
+		case AXIS_GOTO:{
+			double d = a->target - a->pos;
+			// trapezoidal profile: speed allowing to stop at target + target speed
+			vreq = sqrt(2. * a->amax * fabs(d));
+			if(d < 0.) vreq = -vreq;
+			vreq += a->tvel;
+			if(fabs(d) < GOTO_EPS && fabs(a->vel - a->tvel) < dv){
+				a->pos = a->target;
+				a->vel = a->tvel;
+				return;
+			}
+		}
+		break;
+		case AXIS_VEL:
+			if(t < a->tend) vreq = a->tvel;
+			else a->mode = AXIS_STOP;
+		break;
+		default:
+		break;
+	}
+	if(vreq > a->vmax) vreq = a->vmax;
+	else if(vreq < -a->vmax) vreq = -a->vmax;
+	if(vreq > a->vel + dv) vreq = a->vel + dv;
+	else if(vreq < a->vel - dv) vreq = a->vel - dv;
+	a->pos += (a->vel + vreq) / 2. * dt;
+	a->vel = vreq;
+}
+
+// get value of type T from message data with offset `off` (data packed by 4 bytes)
+#define GETARG(T, off)  ({T __x; if((off) + (int)sizeof(T) > len) goto badlen; \
+		memcpy(&__x, data + (off), sizeof(T)); __x;})
+
+/**
+ * Process client command
+ * @param T      - telescope
+ * @param code   - command code
+ * @param acckey - client access key
+ * @param data   - command arguments
+ * @param len    - length of arguments
+ * @return 1 if command accepted
+ */
+int emul_command(telescope *T, int code, uint32_t acckey, char *data, int len){
+	int i;
+	++Estat.commands;
+	if(code > 0 && code < 64) ++Estat.bycode[code];
+	if(E.haspass){
+		for(i = 1; i < 6 && E.key[i] != acckey; ++i);
+		if(i == 6){
+			DBG("Wrong access key for command %d", code);
+			++Estat.rejected;
+			return 0;
+		}
+	}
+	switch(code){
+		case StopTel:
+			Sys_Mode = SysStop;
+			T->A.mode = T->Z.mode = AXIS_STOP;
+		break;
+		case SetAD:
+			InpAlpha = GETARG(double, 0);
+			InpDelta = GETARG(double, 8);
+		break;
+		case SetAZ:
+			InpAzim  = GETARG(double, 0);
+			InpZdist = GETARG(double, 8);
+		break;
+		case GoToAD:
+		case MoveToAD:
+		case GoToTD:
+		case MoveToTD:
+			SrcAlpha = InpAlpha; SrcDelta = InpDelta;
+			E.corrAlp = E.corrDel = E.corrA = E.corrZ = 0.;
+			Sys_Target = TagObject;
+			Sys_Mode = SysWait;
+		break;
+		case GoToAZ:
+			E.corrAlp = E.corrDel = E.corrA = E.corrZ = 0.;
+			Sys_Target = TagPosition;
+			Sys_Mode = SysWait;
+		break;
+		case StartTel:
+			if(Sys_Mode != SysWait) break;
+			Sys_Mode = (Sys_Target == TagObject) ? SysPointAD : SysPointAZ;
+			axis_goto(&T->A, T->A.pos);
+			axis_goto(&T->Z, T->Z.pos);
+		break;
+		case SetTarg:
+			Sys_Target = GETARG(int32_t, 0);
+		break;
+		case SetModP:
+			P2_Mode = GETARG(int32_t, 0);
+		break;
+		case P2Move:
+			i = GETARG(int32_t, 0);
+			if(i) axis_move(&T->P, (i > 0) ? E.p2vel : -E.p2vel, 1e9);
+			else T->P.mode = AXIS_STOP;
+		break;
+		case SetVP2:
+			E.p2vel = fabs(GETARG(double, 0));
+		break;
+		case P2MoveTo:
+			axis_move(&T->P, GETARG(double, 0), GETARG(double, 8));
+		break;
+		case FocMove:
+			i = GETARG(int32_t, 0);
+			if(i < Foc_Hminus || i > Foc_Hplus) break;
+			Foc_State = i;
+			{double v = (abs(i) == 2) ? T->F.vmax : T->F.vmax * FOC_LOWSPEED;
+			axis_move(&T->F, (i < 0) ? -v : v, GETARG(double, 4));}
+		break;
+		case DomeMove:
+			i = GETARG(int32_t, 0);
+			if(i < D_Hminus || i > D_Hplus) break;
+			axis_move(&T->D, T->D.vmax * i / 3., GETARG(double, 4));
+			Dome_State = T->D.mode == AXIS_STOP ? D_Off : i;
+		break;
+		case SetModD:
+			Dome_State = GETARG(int32_t, 0);
+			if(Dome_State == D_On) axis_goto(&T->D, T->A.pos);
+			else T->D.mode = AXIS_STOP;
+		break;
+		case UsePCorr:
+			Pos_Corr = GETARG(int32_t, 0);
+		break;
+		case SetTrkFlags:
+			TrkOk_Mode = GETARG(int32_t, 0);
+		break;
+		case SetTFoc:
+			Tel_Focus = GETARG(int32_t, 0);
+		break;
+		case SetRevA:
+			Az_Mode = GETARG(int32_t, 0);
+		break;
+		case SetTMod:
+			Tel_Mode = GETARG(int32_t, 0);
+		break;
+		case CorrAD:
+		case CorrAZ: // corrections are possible only when telescope follows target
+			if(Sys_Mode < SysPointAZ || Sys_Mode > SysTrkCorr) break;
+			if(code == CorrAD){
+				E.corrAlp += GETARG(double, 0) / 15.;
+				E.corrDel += GETARG(double, 8);
+			}else{
+				E.corrA += GETARG(double, 0);
+				E.corrZ += GETARG(double, 8);
+			}
+			if(Sys_Mode != SysTrkCorr) E.savedmode = Sys_Mode;
+			Sys_Mode = SysTrkCorr;
+		break;
+		case SendMsg:
+			for(i = MesgNum - 1; i > 0; --i)
+				memcpy((void*)&Sys_Mesg(i), (void*)&Sys_Mesg(i-1), sizeof(struct SysMesg));
+			Sys_Mesg(0).seq_num++;
+			Sys_Mesg(0).type = MesgInfor;
+			snprintf((char*)Sys_Mesg(0).text, MesgLen, "%.*s", len, data);
+		break;
+		case SetMet:{
+			double val = GETARG(double, 4);
+			switch(GETARG(int32_t, 0)){
+				case INPUT_B:   inp_B = val_B = val;      break;
+				case INPUT_T1:  inp_T1 = val_T1 = val;    break;
+				case INPUT_T2:  inp_T2 = val_T2 = val;    break;
+				case INPUT_T3:  inp_T3 = val_T3 = val;    break;
+				case INPUT_WND: inp_Wnd = val_Wnd = val;  break;
+				case INPUT_HMD: val_Hmd = val;            break;
+				default: break;
+			}
+		}
+		break;
+		case SetDUT1:
+			DUT1 = GETARG(double, 0);
+		break;
+		case SetPM:
+			polarX = GETARG(double, 0);
+			polarY = GETARG(double, 8);
+		break;
+		case SetLocks:
+			LockFlags |= GETARG(int32_t, 0);
+		break;
+		case ClearLocks:
+			LockFlags &= ~GETARG(int32_t, 0);
+		break;
+		case NullCom:
+		break;
+		default:
+			DBG("Unsupported command %d", code);
+			++Estat.unknown;
+			return 0;
+	}
+	return 1;
+badlen:
+	WARNX(_("Too short data (%d bytes) for command %d"), len, code);
+	return 0;
+}
+
+/**
+ * calculate target position of main axes for current Sys_Mode
+ */
+static void calc_target(telescope *T){
+	double A, Z;
+	if(Sys_Target == TagObject){
+		CurAlpha = SrcAlpha + E.corrAlp;
+		CurDelta = SrcDelta + E.corrDel;
+		eq2hor(CurAlpha, CurDelta, S_time, &A, &Z);
+	}else{
+		A = InpAzim; Z = InpZdist;
+		hor2eq(A, Z, S_time, (double*)&CurAlpha, (double*)&CurDelta);
+	}
+	A += E.corrA; Z += E.corrZ;
+	if(T->A.ttime > 0.){ // keep continuity with previous target & calculate target velocity
+		double dt = M_time - T->A.ttime;
+		while(A - T->A.target > S360/2.) A -= S360;
+		while(A - T->A.target < -S360/2.) A += S360;
+		if(dt > 0. && dt < 10.){
+			T->A.tvel = (A - T->A.target) / dt;
+			T->Z.tvel = (Z - T->Z.target) / dt;
+		}
+	}else{ // new target: choose nearest (or longest if reverce is on) way inside end-switches
+		while(A - T->A.pos > S360/2.) A -= S360;
+		while(A - T->A.pos < -S360/2.) A += S360;
+		if(Az_Mode == Rev_On) A += (A > T->A.pos) ? -S360 : S360;
+		if(A > AZ_LIMIT) A -= S360;
+		else if(A < -AZ_LIMIT) A += S360;
+	}
+	T->A.ttime = T->Z.ttime = M_time;
+	T->A.target = A;
+	T->Z.target = Z;
+	tag_A = A; tag_Z = Z;
+}
+
+/**
+ * Move all axes for time interval dt, change system state
+ */
+void emul_step(telescope *T, double dt){
+	double t = dtime(), dA, dZ, diff;
+	set_times();
+	if(Sys_Mode != SysStop && Sys_Mode != SysWait) calc_target(T);
+	if(!A_Locked) axis_step(&T->A, dt, t);
+	else T->A.vel = 0.;
+	if(!Z_Locked) axis_step(&T->Z, dt, t);
+	else T->Z.vel = 0.;
+	if(!P_Locked) axis_step(&T->P, dt, t);
+	else T->P.vel = 0.;
+	if(!F_Locked) axis_step(&T->F, dt, t);
+	else T->F.vel = 0.;
+	if(Dome_State == D_On) axis_goto(&T->D, T->A.pos);
+	if(!D_Locked) axis_step(&T->D, dt, t);
+	else T->D.vel = 0.;
+	// focus end-switches
+	if(T->F.pos < FOCUS_MIN || T->F.pos > FOCUS_MAX){
+		T->F.pos = (T->F.pos < FOCUS_MIN) ? FOCUS_MIN : FOCUS_MAX;
+		T->F.vel = 0.;
+		T->F.mode = AXIS_STOP;
+	}
+	// P2 angle is cyclic
+	if(T->P.pos < 0.) T->P.pos += S360, T->P.target += S360;
+	else if(T->P.pos >= S360) T->P.pos -= S360, T->P.target -= S360;
+	// states of motors
+	if(T->P.mode == AXIS_STOP && T->P.vel == 0.) P2_State = P2_Mode;
+	else P2_State = (T->P.vel > 0. || (T->P.vel == 0. && T->P.tvel > 0.)) ? P2_Plus : P2_Minus;
+	if(T->F.mode == AXIS_STOP && T->F.vel == 0.) Foc_State = Foc_Off;
+	if(Dome_State != D_On && T->D.mode == AXIS_STOP && T->D.vel == 0.) Dome_State = D_Off;
+	// system mode
+	dA = T->A.target - T->A.pos;
+	dZ = T->Z.target - T->Z.pos;
+	diff = sqrt(dA*dA + dZ*dZ);
+	switch(Sys_Mode){
+		case SysStop:
+			T->A.mode = T->Z.mode = AXIS_STOP;
+			Tel_State = Stopping;
+		break;
+		case SysPointAZ:
+		case SysPointAD:
+			Tel_State = Pointing;
+			if(diff < POINT_THRES) Sys_Mode = SysTrkSeek;
+		break;
+		case SysTrkSeek:
+			Tel_State = Tracking;
+			if(diff < TRACK_THRES) Sys_Mode = SysTrkOk;
+		break;
+		case SysTrkOk:
+			if(diff > POINT_THRES) Sys_Mode = SysTrkSeek;
+		break;
+		case SysTrkCorr:
+			if(diff < TRACK_THRES) Sys_Mode = E.savedmode;
+		break;
+		default:
+		break;
+	}
+}
+
+/**
+ * Write current state of axes into shared memory
+ */
+void emul_publish(telescope *T){
+	val_A = T->A.pos; vel_A = T->A.vel;
+	val_Z = T->Z.pos; vel_Z = T->Z.vel;
+	val_P = T->P.pos; vel_P = T->P.vel;
+	val_F = T->F.pos; vel_F = T->F.vel;
+	val_D = T->D.pos; vel_D = T->D.vel;
+	if(Sys_Mode == SysStop || Sys_Mode == SysWait){
+		tag_A = val_A; tag_Z = val_Z;
+	}
+	tag_P = val_P;
+	Diff_A = val_A - tag_A;
+	Diff_Z = val_Z - tag_Z;
+	Diff_P = 0.;
+	speedA = req_speedA = vel_A;
+	speedZ = req_speedZ = vel_Z;
+	speedP = req_speedP = vel_P;
+	A_time = Z_time = P_time = M_time;
+	hor2eq(val_A, val_Z, S_time, (double*)&val_Alp, (double*)&val_Del);
+	Pressure = val_B;
+	Temper = val_T1;
+	++Estat.ticks;
+}
@@ -0,0 +1,74 @@
+/*
+ * emulator.h - ACS stand-in: telescope axes dynamics & commands processing
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __EMULATOR_H__
+#define __EMULATOR_H__
+
+#include <stdint.h>
+
+// axis moving modes
+typedef enum{
+	 AXIS_STOP = 0  // stopped or decelerating to stop
+	,AXIS_GOTO      // moving to target position
+	,AXIS_VEL       // moving with given speed until given time
+} axis_mode;
+
+// parameters & state of single axis
+typedef struct{
+	double pos;     // current position
+	double vel;     // current velocity
+	double target;  // target position (AXIS_GOTO)
+	double tvel;    // required velocity (AXIS_VEL) or target velocity (AXIS_GOTO)
+	double tend;    // time of moving end (AXIS_VEL)
+	double ttime;   // time of last target change (AXIS_GOTO)
+	double vmax;    // max velocity
+	double amax;    // max acceleration
+	axis_mode mode;
+} axis;
+
+// all axes of telescope
+typedef struct{
+	axis A;   // azimuth, ''
+	axis Z;   // zenith distance, ''
+	axis P;   // P2, ''
+	axis F;   // focus, mm
+	axis D;   // dome azimuth, ''
+} telescope;
+
+// statistics
+typedef struct{
+	uint64_t ticks;       // amount of published ticks
+	uint64_t overruns;    // amount of ticks published too late (more than one period)
+	uint64_t commands;    // commands received
+	uint64_t rejected;    // commands with wrong access key
+	uint64_t unknown;     // unsupported commands
+	uint64_t bycode[64];  // commands by code
+} emul_stat;
+
+extern emul_stat Estat;
+
+void emul_init(telescope *T);
+void emul_set_passwd(char *passwd);
+int emul_command(telescope *T, int code, uint32_t acckey, char *data, int len);
+void emul_step(telescope *T, double dt);
+void emul_publish(telescope *T);
+
+#endif // __EMULATOR_H__
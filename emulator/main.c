@@ -0,0 +1,169 @@
+/*
+ * main.c - stand-in of BTA ACS server: creates shared memory & command queues,
+ *          processes commands & moves model of telescope
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <assert.h>
+#include <signal.h>
+#include <math.h>
+#include <time.h>
+
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+#include "cmdlnopts.h"
+#include "emulator.h"
+
+glob_pars *GP = NULL;
+
+static struct CMD_Queue *queues[] = {&mcmd, &ocmd, &ucmd, NULL};
+// IPC objects created by us (only they are removed at exit)
+static int shmid = -1, qids[] = {-1, -1, -1};
+
+static void print_stat(){
+	int i;
+	printf("\nTicks: %llu (overruns: %llu), commands: %llu (rejected: %llu, unsupported: %llu)\n",
+		(unsigned long long)Estat.ticks, (unsigned long long)Estat.overruns,
+		(unsigned long long)Estat.commands, (unsigned long long)Estat.rejected,
+		(unsigned long long)Estat.unknown);
+	for(i = 1; i < 64; ++i)
+		if(Estat.bycode[i]) printf("\tcode %d: %llu\n", i, (unsigned long long)Estat.bycode[i]);
+}
+
+void signals(int sig){
+	int i;
+	if(sig)
+		WARNX(_("Get signal %d, quit.\n"), sig);
+	else
+		sig = -1;
+	if(shmid > -1){
+		if(sdat.addr) close_shm_block(&sdat);
+		else shmctl(shmid, IPC_RMID, NULL);
+	}
+	for(i = 0; queues[i]; ++i)
+		if(qids[i] > -1) msgctl(qids[i], IPC_RMID, NULL);
+	print_stat();
+	exit(sig);
+}
+
+// add `dt` seconds to `t`
+static void ts_add(struct timespec *t, double dt){
+	long ns = t->tv_nsec + (long)(dt * 1e9);
+	t->tv_sec += ns / 1000000000L;
+	t->tv_nsec = ns % 1000000000L;
+}
+
+static double ts_diff(struct timespec *t1, struct timespec *t0){
+	return (double)(t1->tv_sec - t0->tv_sec) + (double)(t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/**
+ * Get all commands from all queues
+ */
+static void get_commands(telescope *T){
+	struct CMD_Queue **q;
+	struct{
+		struct my_msgbuf m;
+		char reserve[16]; // sizeof(long) could be more than sizeof(int32_t)
+	} buf;
+	ssize_t n;
+	for(q = queues; *q; ++q){
+		while((n = msgrcv((*q)->id, (struct msgbuf *)&buf, 112, 0, IPC_NOWAIT | MSG_NOERROR)) > 0){
+			DBG("Got command %d from %s, len=%zd", buf.m.mtype, (*q)->key.name, n);
+			emul_command(T, buf.m.mtype, buf.m.acckey, buf.m.mtext, (int)n - 12);
+		}
+	}
+}
+
+/**
+ * Create IPC object exclusively: shared memory & queues of running ACS or another emulator
+ * should never be used (& removed at exit)
+ * @param what - kind of object for messages
+ * @param name - its key name
+ * @param id   - result of shmget/msgget with IPC_CREAT | IPC_EXCL
+ * @return id
+ */
+static int excl_id(const char *what, const char *name, int id){
+	if(id > -1) return id;
+	if(errno == EEXIST)
+		WARNX(_("%s '%s' exists: ACS server or another emulator is running"), what, name);
+	else
+		WARN(_("Can't create %s '%s'"), what, name);
+	signals(0);
+	return -1;
+}
+
+int main(int argc, char **argv){
+	telescope T;
+	struct timespec next, now, last;
+	int i;
+	initial_setup();
+	GP = parce_args(argc, argv);
+	assert(GP);
+	if(GP->tick < 0.001 || GP->tick > 10.)
+		ERRX(_("Tick should be from 1ms to 10s"));
+	memset(&T, 0, sizeof(T));
+	T.A.vmax = GP->vAZ; T.A.amax = GP->aAZ; T.A.pos = GP->A0 * 3600.;
+	T.Z.vmax = GP->vAZ; T.Z.amax = GP->aAZ; T.Z.pos = GP->Z0 * 3600.;
+	T.P.vmax = GP->vP2; T.P.amax = GP->aP2; T.P.pos = GP->P0 * 3600.;
+	T.F.vmax = GP->vF;  T.F.amax = GP->aF;  T.F.pos = GP->F0;
+	T.D.vmax = GP->vD;  T.D.amax = GP->aD;  T.D.pos = T.A.pos;
+	signal(SIGTERM, signals);
+	signal(SIGHUP, signals);
+	signal(SIGINT, signals);
+	signal(SIGQUIT, signals);
+	signal(SIGTSTP, SIG_IGN);
+	// server needs to write shared memory & read queues
+	sdat.mode = 0644;
+	sdat.atflag = 0;
+	shmid = excl_id(_("Shared memory block"), (const char*)sdat.key.name, shmget(sdat.key.code,
+		(sdat.size > sdat.maxsize) ? sdat.size : sdat.maxsize, IPC_CREAT | IPC_EXCL | sdat.mode));
+	if(!get_shm_block(&sdat, ServerSide)){
+		WARNX(_("Can't create shared memory block"));
+		sdat.addr = NULL; // could be (void*)-1 after shmat() error
+		signals(0);
+	}
+	for(i = 0; queues[i]; ++i){
+		queues[i]->mode = 0622;
+		qids[i] = excl_id(_("Command queue"), queues[i]->key.name,
+			msgget(queues[i]->key.code, IPC_CREAT | IPC_EXCL | queues[i]->mode));
+		get_cmd_queue(queues[i], ServerSide);
+		if(queues[i]->id < 0) signals(0);
+	}
+	emul_set_passwd(GP->passwd);
+	if(!GP->passwd) WARNX(_("No password given, clients won't be able to get access level"));
+	emul_init(&T);
+	printf("ACS emulator started, tick=%gs\n", GP->tick);
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	last = next;
+	while(1){
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		get_commands(&T);
+		emul_step(&T, ts_diff(&now, &last));
+		emul_publish(&T);
+		last = now;
+		ts_add(&next, GP->tick);
+		if(ts_diff(&now, &next) > 0.){ // we are late more than one period
+			++Estat.overruns;
+			next = now;
+			ts_add(&next, GP->tick);
+		}
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+	}
+	return 0;
+}
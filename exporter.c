@@ -0,0 +1,278 @@
+/*
+ * exporter.c - OpenMetrics (Prometheus) exporter of BTA data over HTTP
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE // for accept4()
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "exporter.h"
+#include "bta_print.h"
+#include "bta_shdata.h"
+#include "timers.h"
+#include "usefull_macros.h"
+
+/*
+ * One process serves all scrapers by poll() without allocations after start. Page is
+ * rendered from one snapshot not more than once per server tick (and at least each
+ * EXP_MAXAGE seconds if server is silent), so amount of scrapers doesn't change load
+ * on shared memory. Pages are double-buffered: slow clients get old page while new
+ * one is rendered.
+ */
+#define EXP_DEFHOST     "127.0.0.1"
+#define EXP_MAXCLIENTS  (256)
+#define EXP_REQSIZE     (2048)
+#define EXP_BUFSIZE     (65536)
+#define EXP_HDRSIZE     (256)
+// max age of page when server's data don't change (seconds)
+#define EXP_MAXAGE      (1.)
+// connection is closed if it lasts longer (seconds)
+#define EXP_TIMEOUT     (10.)
+
+typedef struct{
+	char hdr[EXP_HDRSIZE];
+	char body[EXP_BUFSIZE];
+	struct iovec iov[2];    // header & body
+	double mtime;           // M_time of page
+	int users;              // amount of clients sending this page
+} page;
+
+typedef struct{
+	int fd;                 // -1 - free slot
+	char req[EXP_REQSIZE];
+	size_t rlen;
+	struct iovec iov[2];    // part of response left
+	page *pg;
+	double t0;              // time of connection
+} eclient;
+
+static page pages[2];
+static page *curpage = NULL;
+static eclient eclients[EXP_MAXCLIENTS];
+static struct pollfd pfds[EXP_MAXCLIENTS + 1]; // listening socket & clients
+static struct{
+	unsigned long long scrapes;  // pages sent
+	unsigned long long renders;  // pages rendered
+	unsigned long long rejected; // connections rejected (too much clients)
+	unsigned long long errors;   // wrong requests
+} estat = {0};
+static double last_mtime = -1., last_change = 0., last_render = 0.;
+
+#define ANS(code)  "HTTP/1.1 " code "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+static const char ans_notfound[] = ANS("404 Not Found");
+static const char ans_badreq[] = ANS("400 Bad Request");
+#undef ANS
+
+/**
+ * render new page if data changed
+ * @param now - current time
+ */
+static void render(double now){
+	page *p = (curpage == &pages[0]) ? &pages[1] : &pages[0];
+	double m = get_shm_mtime();
+	size_t l;
+	if(m != last_mtime){
+		last_mtime = m;
+		last_change = now;
+	}else if(curpage && curpage->mtime == m && now - last_render < EXP_MAXAGE) return;
+	if(p->users) return; // previous page is still sending
+	if(!(l = bta_print_metrics(p->body, EXP_BUFSIZE - 1024))){
+		WARNX(_("Metrics don't fit into buffer"));
+		return;
+	}
+	++estat.renders;
+	l += (size_t)snprintf(p->body + l, EXP_BUFSIZE - l,
+		"# TYPE bta_data_age_seconds gauge\n# UNIT bta_data_age_seconds seconds\n"
+		"# HELP bta_data_age_seconds time since last change of M_time\n"
+		"bta_data_age_seconds %.3f\n"
+		"# TYPE bta_exporter_scrapes counter\n# HELP bta_exporter_scrapes pages sent\n"
+		"bta_exporter_scrapes_total %llu\n"
+		"# TYPE bta_exporter_renders counter\n# HELP bta_exporter_renders pages rendered\n"
+		"bta_exporter_renders_total %llu\n"
+		"# TYPE bta_exporter_rejected counter\n# HELP bta_exporter_rejected connections rejected\n"
+		"bta_exporter_rejected_total %llu\n"
+		"# EOF\n", now - last_change, estat.scrapes, estat.renders, estat.rejected);
+	p->iov[0].iov_base = p->hdr;
+	p->iov[0].iov_len = (size_t)snprintf(p->hdr, EXP_HDRSIZE, "HTTP/1.1 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+		"Content-Length: %zu\r\nConnection: close\r\n\r\n", l);
+	p->iov[1].iov_base = p->body;
+	p->iov[1].iov_len = l;
+	p->mtime = m;
+	curpage = p;
+	last_render = now;
+}
+
+static void cl_close(int i){
+	eclient *c = &eclients[i];
+	if(c->pg) --c->pg->users;
+	close(c->fd);
+	c->fd = pfds[i + 1].fd = -1;
+	c->pg = NULL;
+}
+
+/**
+ * prepare response to full request
+ */
+static void cl_answer(int i, double now){
+	eclient *c = &eclients[i];
+	const char *a = NULL;
+	c->req[c->rlen] = 0;
+	if(strncmp(c->req, "GET ", 4)) a = ans_badreq;
+	else if(strncmp(c->req + 4, "/metrics ", 9) && strncmp(c->req + 4, "/ ", 2)) a = ans_notfound;
+	if(a){
+		++estat.errors;
+		c->iov[0].iov_base = (void*)a;
+		c->iov[0].iov_len = strlen(a);
+		c->iov[1].iov_len = 0;
+	}else{
+		render(now);
+		if(!curpage){
+			cl_close(i);
+			return;
+		}
+		c->pg = curpage;
+		++c->pg->users;
+		memcpy(c->iov, curpage->iov, sizeof(c->iov));
+		++estat.scrapes;
+	}
+	pfds[i + 1].events = POLLOUT;
+}
+
+/**
+ * read request or send answer
+ */
+static void cl_process(int i, double now){
+	eclient *c = &eclients[i];
+	struct msghdr msg = {.msg_iov = c->iov, .msg_iovlen = 2};
+	ssize_t n;
+	int j;
+	if(pfds[i + 1].events == POLLIN){
+		n = recv(c->fd, c->req + c->rlen, EXP_REQSIZE - 1 - c->rlen, 0);
+		if(n <= 0){
+			if(n == 0 || (errno != EAGAIN && errno != EINTR)) cl_close(i);
+			return;
+		}
+		c->rlen += (size_t)n;
+		c->req[c->rlen] = 0;
+		if(strstr(c->req, "\r\n\r\n") || strstr(c->req, "\n\n")) cl_answer(i, now);
+		else if(c->rlen == EXP_REQSIZE - 1){
+			++estat.errors;
+			cl_close(i);
+		}
+		return;
+	}
+	n = sendmsg(c->fd, &msg, MSG_NOSIGNAL);
+	if(n < 0){
+		if(errno != EAGAIN && errno != EINTR) cl_close(i);
+		return;
+	}
+	for(j = 0; j < 2; ++j){
+		size_t s = ((size_t)n < c->iov[j].iov_len) ? (size_t)n : c->iov[j].iov_len;
+		c->iov[j].iov_base = (char*)c->iov[j].iov_base + s;
+		c->iov[j].iov_len -= s;
+		n -= (ssize_t)s;
+	}
+	if(!c->iov[0].iov_len && !c->iov[1].iov_len) cl_close(i);
+}
+
+/**
+ * open listening socket
+ * @param addr - [host:]port
+ * @return socket or -1
+ */
+static int open_socket(char *addr){
+	struct addrinfo hints = {0}, *res, *p;
+	char host[256], *port = strrchr(addr, ':');
+	int sock = -1, en = 1, err;
+	if(port){
+		snprintf(host, sizeof(host), "%.*s", (int)(port - addr), addr);
+		++port;
+	}else{
+		strcpy(host, EXP_DEFHOST);
+		port = addr;
+	}
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	if((err = getaddrinfo(*host ? host : NULL, port, &hints, &res))){
+		WARNX(_("Wrong address %s: %s"), addr, gai_strerror(err));
+		return -1;
+	}
+	for(p = res; p; p = p->ai_next){
+		if((sock = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, p->ai_protocol)) < 0)
+			continue;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &en, sizeof(en));
+		if(bind(sock, p->ai_addr, p->ai_addrlen) == 0 && listen(sock, EXP_MAXCLIENTS) == 0) break;
+		close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(res);
+	if(sock < 0) WARN(_("Can't bind to %s"), addr);
+	return sock;
+}
+
+/**
+ * Serve OpenMetrics page until signal
+ * @param addr - [host:]port to listen (default host is 127.0.0.1, empty host - any)
+ * @return 0 if failed
+ */
+int run_exporter(char *addr){
+	int sock, i, fd;
+	double now;
+	if(!addr || (sock = open_socket(addr)) < 0) return 0;
+	for(i = 0; i < EXP_MAXCLIENTS; ++i){
+		eclients[i].fd = pfds[i + 1].fd = -1;
+		eclients[i].pg = NULL;
+	}
+	pfds[0].fd = sock;
+	pfds[0].events = POLLIN;
+	green(_("Exporter is listening on %s\n"), addr);
+	while(1){
+		if(poll(pfds, EXP_MAXCLIENTS + 1, 100) < 0 && errno != EINTR){
+			WARN("poll()");
+			return 0;
+		}
+		now = mtime();
+		if(pfds[0].revents & POLLIN){
+			while((fd = accept4(sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) > -1){
+				for(i = 0; i < EXP_MAXCLIENTS && eclients[i].fd > -1; ++i);
+				if(i == EXP_MAXCLIENTS){
+					++estat.rejected;
+					close(fd);
+					continue;
+				}
+				eclients[i].fd = pfds[i + 1].fd = fd;
+				pfds[i + 1].events = POLLIN;
+				pfds[i + 1].revents = 0;
+				eclients[i].rlen = 0;
+				eclients[i].t0 = now;
+			}
+		}
+		for(i = 0; i < EXP_MAXCLIENTS; ++i){
+			if(eclients[i].fd < 0) continue;
+			if(pfds[i + 1].revents & (POLLERR | POLLNVAL)) cl_close(i);
+			else if(pfds[i + 1].revents) cl_process(i, now);
+			else if(now - eclients[i].t0 > EXP_TIMEOUT) cl_close(i);
+		}
+	}
+	return 1;
+}
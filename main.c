@@ -33,13 +33,26 @@
 #include <assert.h>
 #include <signal.h>
 #include <math.h>
+#include <time.h>
+#include <limits.h>
 
 #include "bta_control.h"
 #include "ch4run.h"
 #include "cmdlnopts.h"
 #include "usefull_macros.h"
 #include "bta_print.h"
+#include "timers.h"
+#include "recorder.h"
+#include "monitor.h"
+#include "exporter.h"
+#include "planner.h"
+#include "catalog.h"
+#include "apparent.h"
+#include "angle_functions.h"
 #include "bta_shdata.h"
+#include "daemon.h"
+#include "script.h"
+#include "cmdlat.h"
 
 glob_pars *GP = NULL;
 
@@ -47,20 +60,98 @@ glob_pars *GP = NULL;
 #define PIDFILE  "/tmp/bta_control.pid"
 #endif
 
+static pid_t mainpid = 0; // PID of process locked PIDFILE (daemon's children shouldn't remove it)
+static int cmdlat = 0;     // ==1 if latencies of commands are tracked
+
 void signals(int sig){
     if(sig)
         WARNX(_("Get signal %d, quit.\n"), sig);
     else
         sig = -1;
-    unlink(PIDFILE);
+    if(getpid() == mainpid) unlink(PIDFILE);
     restore_console();
     exit(sig);
 }
 
 #ifndef EMULATION
+#ifndef KEYCACHE
+#define KEYCACHE  "/dev/shm/bta_control"
+#endif
+#define KEYCACHE_MAGIC  (0x4b415442) // "BTAK"
+
+// cached access key: valid while server's codes of levels are the same
+typedef struct{
+    uint32_t magic;
+    passhash pass;
+    uint32_t code_lev[5];
+} keycache;
+
+static char *keycache_name(){
+    static char name[PATH_MAX];
+    snprintf(name, PATH_MAX, KEYCACHE ".%u.key", (unsigned)getuid());
+    return name;
+}
+
+/**
+ * Get access key from cache (tmpfs file of this user with mode 0600)
+ * @return 1 if key is valid for current server's levels codes
+ */
+static int keycache_read(passhash *p){
+    keycache k;
+    struct stat st;
+    int i, fd = open(keycache_name(), O_RDONLY | O_NOFOLLOW), ok = 0;
+    if(fd < 0) return 0;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == getuid()
+        && (st.st_mode & 077) == 0 && read(fd, &k, sizeof(k)) == sizeof(k)
+        && k.magic == KEYCACHE_MAGIC){
+        for(i = 1; i < 6 && k.code_lev[i-1] == code_Lev(i); ++i);
+        if(i == 6){
+            *p = k.pass;
+            ok = 1;
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+/**
+ * Store access key: it's written into new temporary file (mode 0600) & renamed to cache,
+ * so foreign file with the same name is never opened for writing
+ */
+static void keycache_write(passhash *p){
+    keycache k = {KEYCACHE_MAGIC, *p, {0}};
+    char tmp[PATH_MAX];
+    int i, fd;
+    if(snprintf(tmp, PATH_MAX, "%s.XXXXXX", keycache_name()) >= PATH_MAX){
+        WARNX(_("Too long name of key cache"));
+        return;
+    }
+    if((fd = mkstemp(tmp)) < 0){
+        WARN(_("Can't create %s"), tmp);
+        return;
+    }
+    for(i = 1; i < 6; ++i) k.code_lev[i-1] = code_Lev(i);
+    if(fchmod(fd, S_IRUSR | S_IWUSR) || write(fd, &k, sizeof(k)) != sizeof(k)){
+        WARN(_("Can't store key in %s"), tmp);
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    close(fd);
+    if(rename(tmp, keycache_name())){
+        WARN(_("Can't store key in %s"), keycache_name());
+        unlink(tmp);
+    }
+}
+
 void get_passhash(passhash *p){
     int fd = -1, i, c, nlev = 0;
     char *filename = GP->passfile;
+    if(GP->keycache && keycache_read(p)){
+        DBG("Got key from cache");
+        set_acckey(p->keylev);
+        return;
+    }
     if(filename){ // user give filename with [stored?] hash
         struct stat statbuf;
         if((fd = open(filename, O_RDWR | O_CREAT,  S_IRUSR | S_IWUSR)) < 0)
@@ -80,6 +171,7 @@ void get_passhash(passhash *p){
             if(i){
                 set_acckey(p->keylev);
                 close(fd);
+                if(GP->keycache) keycache_write(p);
                 return;
             }
         }
@@ -110,6 +202,7 @@ void get_passhash(passhash *p){
         ERRX(_("Tries excess!"));
     set_acckey(p->keylev);
     DBG("OK, level %d", nlev);
+    if(GP->keycache) keycache_write(p);
     if(fd > 0){
         PRINT(_("Store\n"));
         if(0 != lseek(fd, 0, SEEK_SET)){
@@ -121,9 +214,306 @@ void get_passhash(passhash *p){
 }
 #endif // EMULATION
 
+/**
+ * Show summary of record file or data stored at given time
+ * @param showinfo - information level requested
+ * @return 0 if all OK
+ */
+static int show_record(info_level showinfo){
+    rec_segment *s = rec_open(GP->recread);
+    bta_record *r;
+    double t;
+    if(!s) return 1;
+    if(!GP->recat){
+        time_t tstart = (time_t)s->hdr->tstart;
+        printf(_("Segment %u created %s"), s->hdr->segno, ctime(&tstart));
+        printf(_("Records: %u of %u, missed ticks: %u\n"), s->count, s->hdr->capacity, s->hdr->missed);
+        if(s->count){
+            printf(_("M_time from %s"), time_asc(fmod(s->idx[0], 86400.)));
+            printf(_(" to %s\n"), time_asc(fmod(s->idx[s->count-1], 86400.)));
+        }
+        rec_close(s);
+        return 0;
+    }
+    int h, m, n;
+    double sec = 0.;
+    n = sscanf(GP->recat, "%d:%d:%lf", &h, &m, &sec);
+    if(n < 2 || h < 0 || h > 23 || m < 0 || m > 59 || sec < 0. || sec >= 60.){
+        rec_close(s);
+        ERRX(_("Wrong time: %s"), GP->recat);
+    }
+    t = h * 3600. + m * 60. + sec;
+    if(!(r = rec_get(s, rec_find(s, t)))){
+        WARNX(_("No records after %s"), GP->recat);
+        rec_close(s);
+        return 1;
+    }
+    bta_print_set(&r->data, &r->local);
+    if(showinfo == NO_INFO) showinfo = ALL_INFO;
+    bta_print(showinfo, GP->infoargs);
+    if(!GP->format) printf("\n");
+    rec_close(s);
+    return 0;
+}
+
+/**
+ * Plan night for targets from GP->plan
+ * @return 0 if all OK
+ */
+static int plan_night(){
+    plan_params p = {.date = GP->plandate, .step = GP->planstep, .zmax = GP->planzmax,
+        .zmin = GP->planzmin, .sunalt = GP->plansun, .curves = GP->plancurves,
+        .nthreads = GP->planthreads};
+    return run_planner(GP->plan, &p) ? 0 : 1;
+}
+
+/**
+ * Show objects found in catalog
+ */
+static void show_hits(cat_hit *h, size_t n){
+    size_t i;
+    int w = 4;
+    char ra[16], dec[16], mag[16];
+    for(i = 0; i < n; ++i){
+        int l = (int)strlen(h[i].obj->name);
+        if(l > w) w = l;
+    }
+    printf("#%-*s %11s %11s %6s %10s\n", w - 1, "Name", "RA(J2000)", "Decl(J2000)", "Mag", "Dist('')");
+    for(i = 0; i < n; ++i){
+        const cat_obj *o = h[i].obj;
+        snprintf(ra, 16, "%s", time_asc(o->ra));
+        snprintf(dec, 16, "%s", angle_asc(o->dec));
+        if(isnan(o->mag)) strcpy(mag, "-");
+        else snprintf(mag, 16, "%.2f", o->mag);
+        printf("%-*s %s %s %6s %10.2f\n", w, o->name, ra, dec, mag, h[i].dist);
+    }
+}
+
+/**
+ * Compile text catalog GP->catcompile into GP->catalog
+ * @return 0 if all OK
+ */
+static int compile_catalog(){
+    if(!GP->catalog){
+        WARNX(_("Output catalog should be given by --catalog"));
+        return 1;
+    }
+    return cat_compile(GP->catcompile, GP->catalog) ? 0 : 1;
+}
+
+/**
+ * Show objects of GP->catalog inside cone GP->cone
+ * @return 0 if all OK
+ */
+static int show_cone(){
+    catalog *c;
+    cat_hit *hits = NULL;
+    size_t size = 0, n;
+    double ra, dec, r;
+    char *str = GP->cone;
+    if(!GP->catalog){
+        WARNX(_("Catalog should be given by --catalog"));
+        return 1;
+    }
+    if(!(str = get_degrees(&ra, str)) || !*str || !(str = get_degrees(&dec, str)) || !*str
+        || !(str = get_degrees(&r, str)) || *str){
+        WARNX(_("Wrong cone: %s (should be \"RA Decl radius\")"), GP->cone);
+        return 1;
+    }
+    if(!(c = cat_open(GP->catalog))) return 1;
+#ifdef EBUG
+    double t = dtime();
+#endif
+    n = cat_cone(c, ra * 3600., dec * 3600., r * 3600., &hits, &size);
+    DBG("Found %zd objects in %.1fus", n, (dtime() - t) * 1e6);
+    cat_sort(hits, n);
+    show_hits(hits, n);
+    FREE(hits);
+    cat_close(c);
+    return 0;
+}
+
+/**
+ * Show `k` objects of GP->catalog nearest to current telescope position
+ * @return 1 if all OK
+ */
+static int show_nearest(int k){
+    catalog *c;
+    cat_hit *hits = NULL;
+    size_t size = 0, n;
+    double ra, dec;
+    if(!GP->catalog){
+        WARNX(_("Catalog should be given by --catalog"));
+        return 0;
+    }
+    if(!(c = cat_open(GP->catalog))) return 0;
+    ap_setup(GP->aptol, 1);
+    ap_mean(JDate - 2400000.5, CurAlpha, CurDelta, &ra, &dec);
+    printf("# Nearest to %s", time_asc(ra));
+    printf(" %s (J2000.0)\n", angle_asc(dec));
+#ifdef EBUG
+    double t = dtime();
+#endif
+    n = cat_nearest(c, ra, dec, (size_t)k, &hits, &size);
+    DBG("Found %zd objects in %.1fus", n, (dtime() - t) * 1e6);
+    show_hits(hits, n);
+    FREE(hits);
+    cat_close(c);
+    return 1;
+}
+
+/**
+ * Check options & find out what to do
+ * @param showinfo  (o) - level of information to show
+ * @param needblock (o) - ==1 if shared memory block needed
+ * @param needqueue (o) - ==1 if command queue needed
+ * @return -1 if there's something to do or exit code
+ */
+static int parse_actions(info_level *showinfo, int *needblock, int *needqueue){
+    *showinfo = NO_INFO;
+    *needblock = 0; *needqueue = 0;
+    if(!bta_print_format(GP->format)) return 1;
+    if(GP->delta >= 0. && !bta_print_delta(GP->delta, GP->deadband)) return 1;
+    if(GP->getinfo){
+        *needblock = 1;
+        char *infostr = GP->getinfo;
+        if(strcmp(infostr, "1") == 0){ // show ALL args
+            *showinfo = ALL_INFO;
+        }else{
+            *showinfo = get_infolevel(infostr);
+        }
+    }
+    if(*showinfo == NO_INFO){
+        if(GP->infoargs){
+            *showinfo = REQUESTED_LIST;
+            *needblock = 1;
+        }else if(GP->getinfo){
+            show_infolevels();
+            return 0;
+        }
+    }
+    if(GP->p2move || GP->p2mode || GP->focmove > 0. || GP->eqcrds || GP->horcrds
+        || GP->azrev || GP->telstop || GP->gotoRaDec || GP->gotoAZ || GP->PCSoff
+        || GP->corrAZ || GP->corrRAD){
+        *needqueue = 1;
+    }
+    if(GP->monitor >= 0.){ // show all by default
+        if(*showinfo == NO_INFO) *showinfo = ALL_INFO;
+        *needblock = 1;
+    }
+    if(*needqueue || GP->record || GP->exporter || GP->nearest > 0){
+        *needblock = 1;
+    }
+    return -1;
+}
+
+/**
+ * Run all commands given (shared memory & queue should be ready)
+ * @return exit code
+ */
+static int run_actions(info_level showinfo, int needqueue){
+    int retcode = 0;
+    if(showinfo != NO_INFO){
+        if(GP->monitor < 0.) bta_print(showinfo, GP->infoargs); // else periodic output after all commands
+    }
+    else if(GP->listinfo) bta_print(NO_INFO, NULL); // show arguments available
+#define RUN(arg)     do{if(!arg) retcode = 1;}while(0)
+#define RUNBLK(arg)  do{if(!arg){return 1;}}while(0)
+    if(GP->telstop)      RUN(stop_telescope());
+    if(GP->eqcrds)       RUNBLK(setCoords(GP->eqcrds, TRUE));
+    else if(GP->horcrds) RUNBLK(setCoords(GP->horcrds, FALSE));
+    int nmotions = (GP->p2move != NULL) + (GP->focmove > 0.) + (GP->gotoRaDec || GP->gotoAZ);
+    if(nmotions > 1 && !GP->serial){ // P2, focus & telescope move simultaneously after all settings
+        if(GP->azrev)        RUN(azreverce());
+        if(GP->PCSoff)       RUNBLK(PCS_state(FALSE));
+        else                 RUNBLK(PCS_state(TRUE));
+        RUN(run_motions(GP->p2move, GP->focmove,
+            GP->gotoRaDec ? GOTO_RADEC : (GP->gotoAZ ? GOTO_AZ : GOTO_NONE)));
+        if(GP->p2mode)       RUN(setP2mode(GP->p2mode));
+        if(!GP->gotoRaDec && !GP->gotoAZ){
+            if(GP->corrAZ)       RUN(run_correction(GP->corrAZ, TRUE));
+            else if(GP->corrRAD) RUN(run_correction(GP->corrRAD, FALSE));
+        }
+    }else{
+        if(GP->p2move)       RUN(moveP2(GP->p2move));
+        if(GP->p2mode)       RUN(setP2mode(GP->p2mode));
+        if(GP->focmove > 0.) RUN(moveFocus(GP->focmove));
+        if(GP->azrev)        RUN(azreverce());
+        if(GP->PCSoff)       RUNBLK(PCS_state(FALSE));
+        else if(needqueue)   RUNBLK(PCS_state(TRUE));
+        if(GP->gotoRaDec)    RUNBLK(gotopos(TRUE));
+        else if(GP->gotoAZ)  RUNBLK(gotopos(FALSE));
+        else if(GP->corrAZ)  RUN(run_correction(GP->corrAZ, TRUE));
+        else if(GP->corrRAD) RUN(run_correction(GP->corrRAD, FALSE));
+    }
+    if(GP->monitor >= 0.){
+        mon_params mp = {.period = GP->monitor, .duration = GP->mondur, .output = GP->monout,
+            .rotsize = (long)GP->rotsize * 1024, .rottime = GP->rottime, .stamps = GP->stamps};
+        RUN(run_monitor(showinfo, GP->infoargs, &mp));
+    }
+    if(GP->nearest > 0)  RUN(show_nearest(GP->nearest));
+    if(GP->exporter)     RUN(run_exporter(GP->exporter));
+    if(GP->record)       RUN(run_recorder(GP->record, GP->recsize, GP->recnseg, GP->recdur));
+#undef RUN
+#undef RUNBLK
+    return retcode;
+}
+
+/**
+ * Run request of client (in daemon's child) or step of script: shared memory, queue
+ * & access key are already got
+ */
+static int serve(int argc, char **argv){
+    info_level showinfo;
+    int needblock, needqueue, retcode;
+    optind = 0; // reinit getopt
+    GP = parce_args(argc, argv);
+    assert(GP);
+    if(GP->daemon || GP->script){
+        WARNX(_("Can't run daemon or script from request"));
+        return 1;
+    }
+    if((retcode = parse_actions(&showinfo, &needblock, &needqueue)) > -1) return retcode;
+    if(GP->recread) return show_record(showinfo);
+    if(GP->plan) return plan_night();
+    if(GP->catcompile) return compile_catalog();
+    if(GP->cone) return show_cone();
+    if(needblock && !check_shm_block(&sdat)){
+        WARNX(_("There's no connection to BTA!"));
+        return 1;
+    }
+    return run_actions(showinfo, needqueue);
+}
+
+/**
+ * Step of script (in child process): latency statistics of its commands would be lost
+ * after exit, so show them here
+ */
+static int script_step(int argc, char **argv){
+    int retcode = serve(argc, argv);
+    if(cmdlat) cmdlat_report(stderr);
+    return retcode;
+}
+
+/**
+ * Startup latency benchmark (--startup-times): show time of each phase before first command
+ * @param name - name of finished phase or NULL to start
+ */
+static void startup_phase(const char *name){
+    static double tstart = 0., tlast = 0.;
+    double t = mtime();
+    if(!name){
+        tstart = tlast = t;
+        return;
+    }
+    if(GP && GP->starttimes)
+        fprintf(stderr, "%-14s %9.3fms (%9.3fms from start)\n", name, (t - tlast) * 1e3, (t - tstart) * 1e3);
+    tlast = t;
+}
+
 int main(int argc, char **argv){
-    check4running(PIDFILE, NULL);
     int retcode = 0;
+    startup_phase(NULL);
     initial_setup();
     info_level showinfo = NO_INFO;
 #ifndef EMULATION
@@ -132,76 +522,107 @@ int main(int argc, char **argv){
     int needblock = 0, needqueue = 0;
     GP = parce_args(argc, argv);
     assert(GP);
+#ifndef EMULATION
+    if(GP->forget){
+        if(unlink(keycache_name()) && errno != ENOENT) ERR(_("Can't remove %s"), keycache_name());
+        return 0;
+    }
+#endif
+    if(GP->client){ // send request to daemon or run it by itself if there's no daemon
+        if((retcode = run_client(GP->socket, argc, argv)) > -1) return retcode;
+        WARNX(_("Can't connect to daemon, run command locally"));
+        GP->client = 0;
+    }
     signal(SIGTERM, signals); // kill (-15) - quit
     signal(SIGHUP, signals);  // hup - quit
     signal(SIGINT, signals);  // ctrl+C - quit
     signal(SIGQUIT, signals); // ctrl+\ - quit
     signal(SIGTSTP, SIG_IGN); // ignore ctrl+Z
     setbuf(stdout, NULL);
-    if(GP->getinfo){
+    if(GP->daemon || GP->script){ // daemon & script need all: shared memory, queue & access key
         needblock = 1;
-        char *infostr = GP->getinfo;
-        if(strcmp(infostr, "1") == 0){ // show ALL args
-            showinfo = ALL_INFO;
-        }else{
-            showinfo = get_infolevel(infostr);
-        }
-    }
-    if(showinfo == NO_INFO){
-        if(GP->infoargs){
-            showinfo = REQUESTED_LIST;
-            needblock = 1;
-        }else if(GP->getinfo){
-            show_infolevels();
-            return 0;
-        }
-    }
-    if(GP->p2move || GP->p2mode || GP->focmove > 0. || GP->eqcrds || GP->horcrds
-        || GP->azrev || GP->telstop || GP->gotoRaDec || GP->gotoAZ || GP->PCSoff
-        || GP->corrAZ || GP->corrRAD){
         needqueue = 1;
+    }else{
+        if((retcode = parse_actions(&showinfo, &needblock, &needqueue)) > -1)
+            return retcode;
+        if(GP->recread)
+            return show_record(showinfo);
+        if(GP->plan)
+            return plan_night();
+        if(GP->catcompile)
+            return compile_catalog();
+        if(GP->cone)
+            return show_cone();
     }
-    if(needqueue){
-        needblock = 1;
+    if(GP->daemon){ // commands lock only actuators they drive, but daemon should be single
+        check4running(PIDFILE, NULL);
+        mainpid = getpid();
     }
+    startup_phase("setup");
     if(needblock){
         if(!get_shm_block(&sdat, ClientSide))
             ERRX(_("Can't find shared memory block"));
+        startup_phase("shm attach");
+    }
+    if(needqueue){
+        get_cmd_queue(&ucmd, ClientSide);
+        if((cmdlat = GP->cmdlat)) cmdlat_init(stderr);
+        startup_phase("queue");
     }
-    if(needqueue) get_cmd_queue(&ucmd, ClientSide);
     if(needblock){
         if(!check_shm_block(&sdat))
             ERRX(_("There's no connection to BTA!"));
+        startup_phase("shm check");
 #ifndef EMULATION
-        double last = M_time;
-        PRINT(_("Test multicast connection\n"));
-        WAIT_EVENT((fabs(M_time - last) > 0.02), 5);
-        if(tmout)
-            ERRX(_("Multicasts stale!"));
-        if(needqueue) get_passhash(&pass);
+        struct BTA_LinkStat ls;
+        bta_link link = check_bta_link(&ls);
+        DBG("Link: %d (ServPID: %d, creator: %d, nattch: %d, lag: %.3fs)", link, ls.servpid,
+            ls.creator, ls.nattch, ls.lag);
+        if(link == LINK_STALE)
+            ERRX(_("Multicasts stale: there's no server process!"));
+        if(link == LINK_UNKNOWN){ // wait for new data
+            double last = M_time;
+            PRINT(_("Test multicast connection\n"));
+            WAIT_EVENT((fabs(M_time - last) > 0.02), 5);
+            if(tmout)
+                ERRX(_("Multicasts stale!"));
+        }
+        startup_phase("link check");
+        if(needqueue){
+            get_passhash(&pass);
+            startup_phase("auth");
+        }
 #endif
     }
-    if(showinfo != NO_INFO) bta_print(showinfo, GP->infoargs);
-    else if(GP->listinfo) bta_print(NO_INFO, NULL); // show arguments available
-#define RUN(arg)     do{if(!arg) retcode = 1;}while(0)
-#define RUNBLK(arg)  do{if(!arg){retcode = 1; goto restoring;}}while(0)
-    if(GP->telstop)      RUN(stop_telescope());
-    if(GP->eqcrds)       RUNBLK(setCoords(GP->eqcrds, TRUE));
-    else if(GP->horcrds) RUNBLK(setCoords(GP->horcrds, FALSE));
-    if(GP->p2move)       RUN(moveP2(GP->p2move));
-    if(GP->p2mode)       RUN(setP2mode(GP->p2mode));
-    if(GP->focmove > 0.) RUN(moveFocus(GP->focmove));
-    if(GP->azrev)        RUN(azreverce());
-    if(GP->PCSoff)       RUNBLK(PCS_state(FALSE));
-    else if(needqueue)   RUNBLK(PCS_state(TRUE));
-    if(GP->gotoRaDec)    RUNBLK(gotopos(TRUE));
-    else if(GP->gotoAZ)  RUNBLK(gotopos(FALSE));
-    else if(GP->corrAZ)  RUN(run_correction(GP->corrAZ, TRUE));
-    else if(GP->corrRAD) RUN(run_correction(GP->corrRAD, FALSE));
-#undef RUN
-#undef RUNBLK
-restoring:
-    unlink(PIDFILE);
+    if(GP->daemon) run_daemon(GP->socket, serve); // never returns
+    startup_phase("total");
+    if(GP->script) // GP would be changed by each step
+        retcode = run_script(GP->script, script_step, GP->stoponerr, GP->steptimes);
+    else
+        retcode = run_actions(showinfo, needqueue);
+    if(needblock){
+        struct BTA_SnapStat st;
+        get_snapshot_stat(&st);
+        DBG("Snapshots: %llu, retries: %llu, torn: %llu", (unsigned long long)st.copies,
+            (unsigned long long)st.retries, (unsigned long long)st.torn);
+        if(st.torn)
+            WARNX(_("%llu of %llu data snapshots was inconsistent"),
+                (unsigned long long)st.torn, (unsigned long long)st.copies);
+    }
+    if(cmdlat) cmdlat_report(stderr);
+#ifdef EBUG
+    {
+        timers_stat ts;
+        get_timers_stat(&ts);
+        if(ts.created)
+            DBG("Timers: %llu (fired: %llu, cancelled: %llu), creation: avr %.1fus, max %.1fus; "
+                "overshoot: avr %.3fms, max %.3fms", (unsigned long long)ts.created,
+                (unsigned long long)ts.fired, (unsigned long long)ts.cancelled,
+                ts.create_sum / ts.created * 1e6, ts.create_max * 1e6,
+                ts.fired ? ts.over_sum / ts.fired * 1e3 : 0., ts.over_max * 1e3);
+    }
+#endif
+    if(mainpid) unlink(PIDFILE);
     restore_console();
     return retcode;
 }
@@ -0,0 +1,222 @@
+/*
+ * monitor.c - periodic output of BTA data with absolute deadlines
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "monitor.h"
+#include "bta_control.h"
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+
+/*
+ * Samples are taken at absolute moments N*period of CLOCK_REALTIME (grid is aligned
+ * to UTC, e.g. with 1s period each sample is at the beginning of second), so time
+ * of output doesn't shift next deadlines & there's no cumulative drift. Deadlines
+ * passed while sample was written are skipped & counted as missed. With zero period
+ * sample is taken on each M_time change (missed server ticks are counted as in
+ * recorder).
+ */
+#define NSEC            (1000000000LL)
+// min sampling period
+#define MON_MINPERIOD   (0.001)
+// next deadline further than this amount of periods means that clock was stepped back
+#define MON_RESYNC      (2)
+
+static struct{
+	uint64_t samples;   // samples written
+	uint64_t missed;    // deadlines (or server ticks) missed
+	uint64_t files;     // output files opened
+	double late_sum;    // total lateness of samples (seconds)
+	double late_max;    // max lateness
+	int ticks;          // sampling by server ticks
+} mstat = {0};
+
+static int mfd = -1;            // output file descriptor
+static char *mname = NULL;      // output file name (NULL - stdout)
+static time_t mopened;          // time of output file opening
+static long rotsize = 0;        // size-based rotation
+static int64_t rotperiod = 0;   // time-based rotation period (ns)
+static int64_t rotnext = 0;     // time of next time-based rotation (ns)
+
+// UNIX time in nanoseconds
+static int64_t now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * NSEC + ts.tv_nsec;
+}
+
+/**
+ * open output file (appending)
+ * @return 0 if failed
+ */
+static int mon_open(){
+	if(!mname){
+		mfd = STDOUT_FILENO;
+		return 1;
+	}
+	if((mfd = open(mname, O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0){
+		WARN(_("Can't open %s for writing"), mname);
+		return 0;
+	}
+	mopened = (time_t)(now_ns() / NSEC); // time() could lag behind CLOCK_REALTIME
+	++mstat.files;
+	bta_print_output(mfd);
+	return 1;
+}
+
+/**
+ * close output file
+ * @param rot - ==1 to rename it to name.YYYYMMDDTHHMMSS (UTC of opening)
+ */
+static void mon_close(int rot){
+	char name[PATH_MAX];
+	struct tm tm;
+	int l, i;
+	if(mfd < 0 || mfd == STDOUT_FILENO) return;
+	bta_print_output(STDOUT_FILENO);
+	close(mfd);
+	mfd = -1;
+	if(!rot) return;
+	gmtime_r(&mopened, &tm);
+	l = snprintf(name, PATH_MAX, "%s.%04d%02d%02dT%02d%02d%02d", mname, tm.tm_year + 1900,
+		tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+	if(l < 0 || l >= PATH_MAX - 8) return;
+	for(i = 1; i < 1000 && access(name, F_OK) == 0; ++i)
+		snprintf(name + l, PATH_MAX - l, "-%d", i);
+	if(rename(mname, name)) WARN(_("Can't rename %s to %s"), mname, name);
+	else DBG("Rotated: %s", name);
+}
+
+/**
+ * rotate output file if it's too large or its time is over
+ * @param now - current time (ns)
+ * @return 0 if can't open new file
+ */
+static int mon_rotate(int64_t now){
+	struct stat st;
+	int rot = 0;
+	if(mfd == STDOUT_FILENO) return 1;
+	if(rotsize > 0 && fstat(mfd, &st) == 0 && st.st_size >= rotsize) rot = 1;
+	if(rotnext && now >= rotnext){
+		rot = 1;
+		rotnext = (now / rotperiod + 1) * rotperiod;
+	}
+	if(!rot) return 1;
+	mon_close(1);
+	return mon_open();
+}
+
+static void mon_finish(){
+	mon_close(0);
+	if(GP->quiet) return;
+	fprintf(stderr, _("Monitoring: %llu samples"), (unsigned long long)mstat.samples);
+	if(mname) fprintf(stderr, _(" in %llu files"), (unsigned long long)mstat.files);
+	fprintf(stderr, _(", missed %s: %llu"), mstat.ticks ? _("server ticks") : _("deadlines"),
+		(unsigned long long)mstat.missed);
+	if(!mstat.ticks && mstat.samples)
+		fprintf(stderr, _(", lateness: mean %.3fms, max %.3fms"),
+			mstat.late_sum / (double)mstat.samples * 1e3, mstat.late_max * 1e3);
+	fprintf(stderr, "\n");
+}
+
+/**
+ * write one sample
+ * @param now  - time of sample (ns)
+ * @param late - delay after deadline (seconds)
+ * @return 0 if failed
+ */
+static int sample(info_level lvl, char *list, int stamps, int64_t now, double late){
+	if(!mon_rotate(now)) return 0;
+	if(stamps) bta_print_stamp((double)now / (double)NSEC);
+	if(!bta_print(lvl, list)) return 0;
+	++mstat.samples;
+	mstat.late_sum += late;
+	if(late > mstat.late_max) mstat.late_max = late;
+	return 1;
+}
+
+/**
+ * Show information periodically
+ * @param lvl  - information level (like bta_print())
+ * @param list - list of parameters (if lvl == REQUESTED_LIST)
+ * @param p    - monitoring parameters
+ * @return 0 if failed
+ */
+int run_monitor(info_level lvl, char *list, mon_params *p){
+	int64_t period, next, now = now_ns(), tend = 0, n;
+	double prev = -1., m, t;
+	if(!p || p->period < 0.) return 0;
+	if(p->period > 0. && p->period < MON_MINPERIOD){
+		WARNX(_("Monitoring period should be not less than %gs"), MON_MINPERIOD);
+		return 0;
+	}
+	mname = p->output;
+	rotsize = p->rotsize;
+	if(p->rottime > 0.){
+		rotperiod = llround(p->rottime * 1e9);
+		rotnext = (now / rotperiod + 1) * rotperiod;
+	}
+	if(!mon_open()) return 0;
+	atexit(mon_finish);
+	if(p->duration > 0.) tend = now + llround(p->duration * 1e9);
+	if(p->period == 0.){ // each server tick
+		mstat.ticks = 1;
+		while(!tend || now_ns() < tend){
+			if(!wait_data(1.)){
+				if(!check_shm_block(&sdat)) WARNX(_("There's no connection to BTA!"));
+				continue;
+			}
+			m = get_shm_mtime();
+			if(prev > 0.){
+				t = m - prev;
+				if(t < -43200.) t += 86400.; // midnight
+				if(Wstat.period > 0. && t > 1.5 * Wstat.period)
+					mstat.missed += (uint64_t)lround(t / Wstat.period) - 1;
+			}
+			prev = m;
+			if(!sample(lvl, list, p->stamps, now_ns(), 0.)) return 0;
+		}
+		return 1;
+	}
+	period = llround(p->period * 1e9);
+	next = (now / period + 1) * period;
+	while(!tend || next < tend){
+		struct timespec ts = {.tv_sec = next / NSEC, .tv_nsec = next % NSEC};
+		while(clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, NULL) == EINTR);
+		now = now_ns();
+		if(!sample(lvl, list, p->stamps, now, (double)(now - next) / (double)NSEC)) return 0;
+		next += period;
+		now = now_ns();
+		if(now >= next){ // too late: skip deadlines passed
+			n = (now - next) / period + 1;
+			mstat.missed += (uint64_t)n;
+			next += n * period;
+		}else if(next - now > MON_RESYNC * period){
+			WARNX(_("System clock stepped back, resynchronize deadlines"));
+			next = (now / period + 1) * period;
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,39 @@
+/*
+ * monitor.h - periodic output of BTA data with absolute deadlines
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __MONITOR_H__
+#define __MONITOR_H__
+
+#include "bta_print.h"
+
+// parameters of monitoring
+typedef struct{
+	double period;      // sampling period (seconds), 0 - each server tick
+	double duration;    // monitoring time (seconds), <= 0 - until signal
+	char *output;       // output file (NULL - stdout)
+	long rotsize;       // rotate output when its size exceeds rotsize bytes (0 - never)
+	double rottime;     // rotate output each rottime seconds of UTC (0 - never)
+	int stamps;         // show timestamp of each sample
+} mon_params;
+
+int run_monitor(info_level lvl, char *list, mon_params *p);
+
+#endif // __MONITOR_H__
@@ -0,0 +1,388 @@
+/*
+ * planner.c - night visibility planner for list of targets
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "planner.h"
+#include "apparent.h"
+#include "catalog.h"
+#include "coords.h"
+#include "usefull_macros.h"
+
+/*
+ * Night is the part of 24-hour window started at local mean noon of given date when
+ * Sun is lower than given altitude. Each object is calculated on each step of night's
+ * grid (mean J2000.0 RA/Decl are converted to apparent place at the middle of night),
+ * so targets are split in blocks & each block is shared between threads; results of
+ * block are output in order of input list.
+ */
+extern void sla_cldj(int*, int*, int*, double*, int*);
+extern double sla_dtt(double*);
+extern double sla_gmst(double*);
+extern double sla_eqeqx(double*);
+extern double sla_airmas(double*);
+extern void sla_rdplan(double*, int*, double*, double*, double*, double*, double*);
+
+// amount of targets in block
+#define PLAN_BLOCK      (16384)
+#define PLAN_MAXTHREADS (256)
+
+typedef struct{
+	const char *name;
+	double ra;          // apparent R.A. (seconds of time)
+	double dec;         // apparent Decl. (arcseconds)
+} target;
+
+// growing output buffer of thread
+typedef struct{
+	char *buf;
+	size_t len;
+	size_t size;
+} pbuf;
+
+typedef struct{
+	pthread_t thread;
+	const target *tgt;  // first target of thread
+	size_t n;           // amount of targets
+	pbuf sum;           // summary lines
+	pbuf crv;           // curves
+	double *alpha, *delta, *az, *zd, *pa; // scratch arrays of grid size
+} worker;
+
+// night grid
+static size_t Ngrid = 0;
+static double *Ut = NULL;       // UTC of grid points (seconds from 0h of date)
+static double *Lst = NULL;      // sidereal time of grid points (seconds)
+static char (*Utstr)[24] = NULL;// ISO UTC of grid points
+static double Step;             // grid step (seconds)
+static double Zmax, Zmin;       // zone limits (arcseconds)
+static int Curves = 0;          // calculate curves
+static int Namew = 4;           // width of name column
+static cat_obj *Tobj = NULL;    // objects of text list
+static catalog *Tcat = NULL;    // or binary catalog
+
+static void pb_printf(pbuf *b, const char *fmt, ...){
+	va_list ap;
+	int l;
+	while(1){
+		va_start(ap, fmt);
+		l = vsnprintf(b->buf + b->len, b->size - b->len, fmt, ap);
+		va_end(ap);
+		if(l < 0) return;
+		if(b->len + l < b->size) break;
+		b->size = (b->size + l + 1) * 2;
+		if(!(b->buf = realloc(b->buf, b->size))) ERR("realloc()");
+	}
+	b->len += l;
+}
+
+static int write_all(int fd, const char *buf, size_t len){
+	while(len){
+		ssize_t l = write(fd, buf, len);
+		if(l < 0){
+			if(errno == EINTR) continue;
+			WARN(_("Can't write planner output"));
+			return 0;
+		}
+		buf += l; len -= l;
+	}
+	return 1;
+}
+
+// UTC (UT1 is near enough) MJD -> apparent local sidereal time (seconds)
+static double sidereal(double mjd){
+	double tt = mjd + sla_dtt(&mjd) / 86400.;
+	double s = fmod((sla_gmst(&mjd) + sla_eqeqx(&tt)) * R2S / 15. + longitude / 15., 86400.);
+	if(s < 0.) s += 86400.;
+	return s;
+}
+
+// time (seconds from 0h of date) -> HH:MM rounded to nearest minute
+static char *hhmm(char s[8], double t){
+	int m = (int)floor(t / 60. + 0.5);
+	m %= 1440; if(m < 0) m += 1440;
+	snprintf(s, 8, "%02d:%02d", m / 60, m % 60);
+	return s;
+}
+
+/**
+ * Find night & fill its grid
+ * @return 0 if Sun doesn't go down below p->sunalt
+ */
+static int night_grid(plan_params *p, double mjd0){
+	double elong = longitude * S2R, phi = Fi * S2R;
+	double t0 = 43200. - longitude / 15.; // local mean noon
+	size_t i, nwin = (size_t)(86400. / Step), first = nwin, last = 0;
+	int np = 0; // Sun
+	for(i = 0; i <= nwin; ++i){
+		double mjd = mjd0 + (t0 + i * Step) / 86400., tt, ra, dec, diam, a, z;
+		tt = mjd + sla_dtt(&mjd) / 86400.;
+		sla_rdplan(&tt, &np, &elong, &phi, &ra, &dec, &diam);
+		calc_AZ(ra * R2S / 15., dec * R2S, sidereal(mjd), &a, &z);
+		if(90. - z / 3600. < p->sunalt){
+			if(first == nwin) first = i;
+			last = i;
+		}
+	}
+	if(first == nwin){
+		WARNX(_("Sun doesn't go down below %g degrees"), p->sunalt);
+		return 0;
+	}
+	Ngrid = last - first + 1;
+	Ut = MALLOC(double, Ngrid);
+	Lst = MALLOC(double, Ngrid);
+	Utstr = my_alloc(Ngrid, sizeof(*Utstr));
+	for(i = 0; i < Ngrid; ++i){
+		time_t t;
+		struct tm tm;
+		Ut[i] = t0 + (first + i) * Step;
+		Lst[i] = sidereal(mjd0 + Ut[i] / 86400.);
+		t = (time_t)floor((mjd0 - 40587.) * 86400. + Ut[i] + 0.5); // MJD of 1970-01-01
+		gmtime_r(&t, &tm);
+		strftime(Utstr[i], sizeof(*Utstr), "%Y-%m-%dT%H:%M:%S", &tm);
+	}
+	return 1;
+}
+
+/**
+ * Read targets from text list or binary catalog (cat_compile()) & calculate their apparent
+ * places
+ * @param list - file name
+ * @param mjd  - MJD of apparent places
+ * @param nthreads - amount of threads
+ * @param n (o) - amount of targets
+ * @return array of targets or NULL if there's no targets
+ */
+static target *get_targets(char *list, double mjd, int nthreads, size_t *n){
+	const cat_obj *o;
+	ap_star *s;
+	target *t;
+	double *ra, *dec;
+	size_t N, i;
+	if(cat_is_binary(list)){
+		if(!(Tcat = cat_open(list))) return NULL;
+		o = Tcat->obj;
+		if(!(N = Tcat->hdr->count)){
+			WARNX(_("There's no objects in %s"), list);
+			return NULL;
+		}
+	}else{
+		if(!(Tobj = cat_read_text(list, &N))) return NULL;
+		o = Tobj;
+	}
+	s = MALLOC(ap_star, N);
+	t = MALLOC(target, N);
+	ra = MALLOC(double, 2 * N);
+	dec = ra + N;
+	for(i = 0; i < N; ++i){
+		int l = (int)strlen(o[i].name);
+		if(l > Namew) Namew = l;
+		t[i].name = o[i].name;
+		s[i].ra = o[i].ra;
+		s[i].dec = o[i].dec;
+		s[i].pmra = o[i].pmra;
+		s[i].pmdec = o[i].pmdec;
+	}
+	ap_setup(0., nthreads);
+	ap_batch(N, s, mjd, ra, dec);
+	for(i = 0; i < N; ++i){
+		t[i].ra = ra[i];
+		t[i].dec = dec[i];
+	}
+	FREE(s);
+	FREE(ra);
+	*n = N;
+	return t;
+}
+
+// time of crossing `lim` between grid points i & i+1
+static double crossing(const double *zd, size_t i, double lim){
+	return Ut[i] + Step * (zd[i] - lim) / (zd[i] - zd[i+1]);
+}
+
+// calculate & show targets of worker
+static void *plan_worker(void *arg){
+	worker *w = (worker*)arg;
+	size_t j, i, N = Ngrid;
+	for(j = 0; j < w->n; ++j){
+		const target *t = &w->tgt[j];
+		double *zd = w->zd, zr;
+		size_t vfirst = N, vlast = 0, nvis = 0, zfirst = N, zlast = 0, nzen = 0, imin = 0;
+		char s1[8], s2[8], s3[8], s4[8], s5[8], sx[8];
+		for(i = 0; i < N; ++i){
+			w->alpha[i] = t->ra;
+			w->delta[i] = t->dec;
+		}
+		calc_AZ_n(N, w->alpha, w->delta, Lst, w->az, zd);
+		if(Curves) calc_PA_n(N, w->alpha, w->delta, Lst, w->pa);
+		for(i = 0; i < N; ++i){
+			if(zd[i] < zd[imin]) imin = i;
+			if(zd[i] >= Zmax) continue;
+			if(vfirst == N) vfirst = i;
+			vlast = i; ++nvis;
+			if(zd[i] < Zmin){
+				if(zfirst == N) zfirst = i;
+				zlast = i; ++nzen;
+			}
+			if(Curves){
+				zr = zd[i] * S2R;
+				pb_printf(&w->crv, "%s,%s,%.4f,%.4f,%.4f,%.3f\n", t->name, Utstr[i],
+					w->az[i] / 3600., zd[i] / 3600., sla_airmas(&zr), w->pa[i] / 3600.);
+			}
+		}
+		zr = zd[imin] * S2R;
+		if(nvis){
+			hhmm(s1, vfirst ? crossing(zd, vfirst - 1, Zmax) : Ut[0]);
+			hhmm(s2, vlast < N - 1 ? crossing(zd, vlast, Zmax) : Ut[N-1]);
+		}else{
+			strcpy(s1, "-"); strcpy(s2, "-");
+		}
+		if(nzen){
+			hhmm(s4, zfirst ? crossing(zd, zfirst - 1, Zmin) : Ut[0]);
+			hhmm(s5, zlast < N - 1 ? crossing(zd, zlast, Zmin) : Ut[N-1]);
+		}else{
+			strcpy(s4, "-"); strcpy(s5, "-");
+		}
+		if(nvis) snprintf(sx, 8, "%.3f", sla_airmas(&zr));
+		else strcpy(sx, "-");
+		pb_printf(&w->sum, "%-*s %5s %5s %5.2f %6.2f %7s %5s %6s %6s %8.2f\n", Namew, t->name,
+			s1, s2, nvis * Step / 3600., zd[imin] / 3600., sx, hhmm(s3, Ut[imin]),
+			s4, s5, nzen * Step / 3600.);
+	}
+	return NULL;
+}
+
+/**
+ * Calculate visibility of targets from list during night & show summary for each
+ * @param list - file with targets
+ * @param p    - parameters
+ * @return 1 if all OK
+ */
+int run_planner(char *list, plan_params *p){
+	int iy, im, id, j, nthr = p->nthreads, cfd = -1, ret = 0;
+	size_t ntgt, k;
+	double mjd0;
+	target *tgt = NULL;
+	worker *w = NULL;
+	char s1[8], s2[8];
+#ifdef EBUG
+	double tstart = dtime();
+#endif
+	if(p->step < 0.1 || p->step > 60.){
+		WARNX(_("Step of grid should be from 0.1 to 60 minutes"));
+		return 0;
+	}
+	if(p->zmax <= 0. || p->zmax > 90. || p->zmin < 0. || p->zmin >= p->zmax){
+		WARNX(_("Wrong zenith distance limits: should be 0 <= zmin < zmax <= 90"));
+		return 0;
+	}
+	if(p->date){
+		if(sscanf(p->date, "%d-%d-%d", &iy, &im, &id) != 3){
+			WARNX(_("Wrong date: %s (should be YYYY-MM-DD)"), p->date);
+			return 0;
+		}
+	}else{ // evening of current night
+		time_t t = time(NULL);
+		struct tm tm;
+		localtime_r(&t, &tm);
+		if(tm.tm_hour < 12){
+			t -= 86400;
+			localtime_r(&t, &tm);
+		}
+		iy = tm.tm_year + 1900; im = tm.tm_mon + 1; id = tm.tm_mday;
+	}
+	sla_cldj(&iy, &im, &id, &mjd0, &j);
+	if(j){
+		WARNX(_("Wrong date: %d-%02d-%02d"), iy, im, id);
+		return 0;
+	}
+	Step = p->step * 60.;
+	Zmax = p->zmax * 3600.;
+	Zmin = p->zmin * 3600.;
+	if(!night_grid(p, mjd0)) return 0;
+	if(!(tgt = get_targets(list, mjd0 + (Ut[0] + Ut[Ngrid-1]) / 2. / 86400., nthr, &ntgt))) goto ret;
+	if(p->curves){
+		if((cfd = open(p->curves, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+			WARN(_("Can't open %s"), p->curves);
+			goto ret;
+		}
+		Curves = 1;
+		static const char hdr[] = "Name,UTC,A,Z,Airmass,PA\n";
+		if(!write_all(cfd, hdr, sizeof(hdr) - 1)) goto ret;
+	}
+	if(nthr < 1) nthr = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(nthr < 1) nthr = 1;
+	if(nthr > PLAN_MAXTHREADS) nthr = PLAN_MAXTHREADS;
+	if((size_t)nthr > ntgt) nthr = (int)ntgt;
+	w = MALLOC(worker, nthr);
+	for(j = 0; j < nthr; ++j){
+		w[j].alpha = MALLOC(double, Ngrid * 5);
+		w[j].delta = w[j].alpha + Ngrid;
+		w[j].az = w[j].delta + Ngrid;
+		w[j].zd = w[j].az + Ngrid;
+		w[j].pa = w[j].zd + Ngrid;
+	}
+	printf("# Night %d-%02d-%02d: Sun is lower than %g degrees from %s to %s UTC, %zd steps of %g min\n",
+		iy, im, id, p->sunalt, hhmm(s1, Ut[0]), hhmm(s2, Ut[Ngrid-1]), Ngrid, p->step);
+	printf("# Horizon limit: Z < %g degrees, zenith zone: Z < %g degrees\n", p->zmax, p->zmin);
+	printf("#%-*s %5s %5s %5s %6s %7s %5s %6s %6s %8s\n", Namew - 1, "Name", "Rise", "Set", "Hours",
+		"Zmin", "Airmass", "Culm", "ZenIn", "ZenOut", "ZenHours");
+	for(k = 0; k < ntgt; k += PLAN_BLOCK){
+		size_t nblk = (ntgt - k < PLAN_BLOCK) ? ntgt - k : PLAN_BLOCK, from = k;
+		for(j = 0; j < nthr; ++j){
+			size_t to = k + nblk * (j + 1) / nthr;
+			w[j].tgt = &tgt[from];
+			w[j].n = to - from;
+			w[j].sum.len = w[j].crv.len = 0;
+			from = to;
+			if(pthread_create(&w[j].thread, NULL, plan_worker, &w[j]))
+				ERR("pthread_create()");
+		}
+		for(j = 0; j < nthr; ++j) pthread_join(w[j].thread, NULL);
+		for(j = 0; j < nthr; ++j){
+			if(!write_all(STDOUT_FILENO, w[j].sum.buf, w[j].sum.len)) goto ret;
+			if(Curves && !write_all(cfd, w[j].crv.buf, w[j].crv.len)) goto ret;
+		}
+	}
+	ret = 1;
+	DBG("%zd targets, %zd points in %.3fs (%d threads)", ntgt, ntgt * Ngrid, dtime() - tstart, nthr);
+ret:
+	if(cfd > -1) close(cfd);
+	if(w) for(j = 0; j < nthr; ++j){
+		FREE(w[j].alpha);
+		FREE(w[j].sum.buf);
+		FREE(w[j].crv.buf);
+	}
+	FREE(w);
+	FREE(tgt);
+	FREE(Tobj);
+	cat_close(Tcat); Tcat = NULL;
+	FREE(Ut); FREE(Lst); FREE(Utstr);
+	return ret;
+}
@@ -0,0 +1,38 @@
+/*
+ * planner.h - night visibility planner for list of targets
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __PLANNER_H__
+#define __PLANNER_H__
+
+// parameters of planning
+typedef struct{
+	char *date;         // evening date of night (YYYY-MM-DD, NULL - current night)
+	double step;        // step of time grid (minutes)
+	double zmax;        // horizon limit: max zenith distance (degrees)
+	double zmin;        // zenith-avoidance zone: min zenith distance (degrees)
+	double sunalt;      // night is time when Sun is lower than sunalt (degrees)
+	char *curves;       // file for A/Z, airmass & PA of each object on each step (NULL - none)
+	int nthreads;       // amount of threads (0 - by number of CPUs)
+} plan_params;
+
+int run_planner(char *list, plan_params *p);
+
+#endif // __PLANNER_H__
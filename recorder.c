@@ -0,0 +1,280 @@
+/*
+ * recorder.c - binary recorder of BTA shared data
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE // for MAP_POPULATE
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+
+#include "recorder.h"
+// REC_READER - only reading functions (for offline tools)
+#ifndef REC_READER
+#include "bta_control.h"
+#include "timers.h"
+
+/*
+ * Each segment is preallocated & mapped (with MAP_POPULATE) at once, so storing of
+ * every server tick is only copying into memory: no syscalls or allocations until
+ * segment is full. Header counter changes after record & index are filled, so
+ * segment could be read at any moment (even while recording).
+ */
+
+// segment opened for writing
+typedef struct{
+	int fd;
+	uint8_t *map;
+	size_t len;
+	rec_header *hdr;
+	double *idx;
+	bta_record *rec;
+} wsegment;
+
+static wsegment wseg = {.fd = -1};
+static struct{
+	uint32_t records;   // records stored
+	uint32_t segments;  // segments created
+	uint32_t missed;    // server ticks missed
+	uint32_t torn;      // incoherent snapshots
+} rstat = {0};
+
+#define PAGE_ROUND(x)   (((x) + 4095) & ~(uint64_t)4095)
+
+/**
+ * calculate offsets & size of segment with `capacity` records
+ */
+static size_t seg_size(uint32_t capacity, uint64_t *idxoff, uint64_t *recoff){
+	uint64_t i = REC_HDRSIZE, r = i + PAGE_ROUND(capacity * sizeof(double));
+	if(idxoff) *idxoff = i;
+	if(recoff) *recoff = r;
+	return (size_t)(r + (uint64_t)capacity * sizeof(bta_record));
+}
+
+/**
+ * close segment & cut off unused records
+ */
+static void seg_close(wsegment *w){
+	size_t used;
+	if(!w->map) return;
+	used = (size_t)w->hdr->recoff + (size_t)w->hdr->count * sizeof(bta_record);
+	if(munmap(w->map, w->len)) WARN(_("Can't munmap"));
+	if(used < w->len && ftruncate(w->fd, used)) WARN(_("Can't truncate segment"));
+	close(w->fd);
+	w->map = NULL;
+	w->fd = -1;
+}
+
+/**
+ * create new segment
+ * @param prefix   - prefix of filename
+ * @param segno    - number of segment
+ * @param nsegs    - amount of segments in ring (0 - unlimited)
+ * @param capacity - max records amount
+ * @return 0 if failed
+ */
+static int seg_create(wsegment *w, char *prefix, uint32_t segno, int nsegs, uint32_t capacity){
+	char name[PATH_MAX];
+	uint64_t idxoff, recoff;
+	int err;
+	size_t len = seg_size(capacity, &idxoff, &recoff);
+	if(nsegs > 0)
+		snprintf(name, PATH_MAX, "%s.%03u" REC_SUFFIX, prefix, segno % (uint32_t)nsegs);
+	else
+		snprintf(name, PATH_MAX, "%s.%06u" REC_SUFFIX, prefix, segno);
+	if((w->fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0){
+		WARN(_("Can't open %s for writing"), name);
+		return 0;
+	}
+	if((err = posix_fallocate(w->fd, 0, len))){
+		errno = err;
+		WARN(_("Can't preallocate %zd bytes for %s"), len, name);
+		close(w->fd);
+		return 0;
+	}
+	w->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->fd, 0);
+	if(w->map == MAP_FAILED){
+		WARN(_("Can't mmap %s"), name);
+		w->map = NULL;
+		close(w->fd);
+		return 0;
+	}
+	w->len = len;
+	w->hdr = (rec_header*)w->map;
+	w->idx = (double*)(w->map + idxoff);
+	w->rec = (bta_record*)(w->map + recoff);
+	w->hdr->version = REC_VERSION;
+	w->hdr->hdrsize = REC_HDRSIZE;
+	w->hdr->recsize = sizeof(bta_record);
+	w->hdr->datasize = sizeof(struct BTA_Data);
+	w->hdr->localsize = sizeof(struct BTA_Local);
+	w->hdr->dataver = BTA_Data_Ver;
+	w->hdr->capacity = capacity;
+	w->hdr->segno = segno;
+	w->hdr->idxoff = idxoff;
+	w->hdr->recoff = recoff;
+	w->hdr->tstart = dtime();
+	w->hdr->count = 0;
+	memcpy(w->hdr->magic, REC_MAGIC, 8);
+	++rstat.segments;
+	DBG("New segment %s", name);
+	return 1;
+}
+
+static void rec_finish(){
+	seg_close(&wseg);
+	PRINT(_("Recorded %u records in %u segments, missed ticks: %u, inconsistent: %u\n"),
+		rstat.records, rstat.segments, rstat.missed, rstat.torn);
+}
+
+/**
+ * Record all server data changes
+ * @param prefix   - prefix of segments filenames
+ * @param capacity - max amount of records in segment
+ * @param nsegs    - amount of segments in ring (older are overwritten), 0 - unlimited
+ * @param duration - recording time (seconds), <= 0 - until signal
+ * @return 0 if failed
+ */
+int run_recorder(char *prefix, int capacity, int nsegs, double duration){
+	static struct BTA_Snapshot snap;
+	double tend = (duration > 0.) ? mtime() + duration : 0., dayoff = 0., prev = -1., t;
+	uint32_t segno = 0, n;
+	bta_record *r;
+	if(!prefix || capacity < 1) return 0;
+	if(!seg_create(&wseg, prefix, segno, nsegs, (uint32_t)capacity)) return 0;
+	atexit(rec_finish);
+	PRINT(_("Start recording into %s*" REC_SUFFIX "\n"), prefix);
+	while(!tend || mtime() < tend){
+		if(!wait_data(1.)){
+			if(!check_shm_block(&sdat)) WARNX(_("There's no connection to BTA!"));
+			continue;
+		}
+		if(!get_bta_snapshot(&snap)) ++rstat.torn;
+		if(snap.mtime == prev) continue;
+		if(prev > 0.){
+			t = snap.mtime - prev;
+			if(t < -43200.){ // midnight
+				t += 86400.;
+				dayoff += 86400.;
+			}
+			if(Wstat.period > 0. && t > 1.5 * Wstat.period){
+				n = (uint32_t)lround(t / Wstat.period) - 1;
+				rstat.missed += n;
+				wseg.hdr->missed += n;
+			}
+		}
+		prev = snap.mtime;
+		if(wseg.hdr->count == wseg.hdr->capacity){
+			seg_close(&wseg);
+			if(!seg_create(&wseg, prefix, ++segno, nsegs, (uint32_t)capacity)) return 0;
+		}
+		n = wseg.hdr->count;
+		t = snap.mtime + dayoff;
+		r = &wseg.rec[n];
+		r->mtime = t;
+		r->rtime = snap.rtime;
+		r->coherent = snap.coherent;
+		r->seq = rstat.records++;
+		memcpy(&r->data, &snap.data, sizeof(struct BTA_Data));
+		memcpy(&r->local, &snap.local, sizeof(struct BTA_Local));
+		wseg.idx[n] = t;
+		if(!n) wseg.hdr->first = t;
+		wseg.hdr->last = t;
+		__sync_synchronize();
+		wseg.hdr->count = n + 1;
+	}
+	return 1;
+}
+
+#endif // REC_READER
+
+/**
+ * Open recorded segment for reading
+ * @return segment or NULL if file is wrong
+ */
+rec_segment *rec_open(char *filename){
+	mmapbuf *b = My_mmap(filename);
+	rec_header *h = (rec_header*)b->data;
+	uint32_t cnt;
+	if(b->len < REC_HDRSIZE || memcmp(h->magic, REC_MAGIC, 8) || h->version != REC_VERSION){
+		WARNX(_("%s isn't BTA record file"), filename);
+		goto bad;
+	}
+	if(h->recsize != sizeof(bta_record) || h->datasize != sizeof(struct BTA_Data)
+		|| h->localsize != sizeof(struct BTA_Local)){
+		WARNX(_("%s: wrong record size"), filename);
+		goto bad;
+	}
+	if(h->dataver != BTA_Data_Ver)
+		WARNX(_("%s: data version %d differs from current %d"), filename, h->dataver, BTA_Data_Ver);
+	// index lies before records, so it should be whole even in truncated file
+	if(h->idxoff % sizeof(double) || h->idxoff > b->len
+		|| (uint64_t)h->capacity * sizeof(double) > b->len - h->idxoff){
+		WARNX(_("%s: wrong index of records"), filename);
+		goto bad;
+	}
+	cnt = h->count;
+	if(cnt > h->capacity || h->recoff + (uint64_t)cnt * h->recsize > b->len){
+		WARNX(_("%s: file is truncated"), filename);
+		if(b->len < h->recoff) goto bad;
+		cnt = (b->len - h->recoff) / h->recsize;
+		if(cnt > h->capacity) cnt = h->capacity;
+	}
+	rec_segment *s = MALLOC(rec_segment, 1);
+	s->buf = b;
+	s->hdr = h;
+	s->idx = (double*)(b->data + h->idxoff);
+	s->rec = (bta_record*)(b->data + h->recoff);
+	s->count = cnt;
+	return s;
+bad:
+	My_munmap(b);
+	return NULL;
+}
+
+void rec_close(rec_segment *s){
+	if(!s) return;
+	My_munmap(s->buf);
+	FREE(s);
+}
+
+/**
+ * Find record by time
+ * @param t - M_time (time after midnight is added to 86400 if segment started before it)
+ * @return number of first record with M_time >= t (s->count if there's no such records)
+ */
+uint32_t rec_find(rec_segment *s, double t){
+	uint32_t l = 0, h;
+	if(!s || !s->count) return 0;
+	h = s->count;
+	while(t < s->idx[0] && t + 86400. <= s->idx[h-1]) t += 86400.;
+	while(l < h){
+		uint32_t m = (l + h) / 2;
+		if(s->idx[m] < t) l = m + 1;
+		else h = m;
+	}
+	return l;
+}
+
+/**
+ * @return record number `n` or NULL if there's no such record
+ */
+bta_record *rec_get(rec_segment *s, uint32_t n){
+	if(!s || n >= s->count) return NULL;
+	return &s->rec[n];
+}
@@ -0,0 +1,90 @@
+/*
+ * recorder.h - binary recorder of BTA shared data
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include <stdint.h>
+#include "bta_shdata.h"
+#include "usefull_macros.h"
+
+/*
+ * Segment file layout:
+ *   [header, REC_HDRSIZE bytes]
+ *   [index: double[capacity] - M_time of each record, page aligned]
+ *   [records: bta_record[capacity]]
+ * Index values are M_time continued through midnight (M_time + 86400*N), so they
+ * always grow inside segment & allow binary search.
+ */
+#define REC_MAGIC       "BTAREC01"
+#define REC_VERSION     (1)
+#define REC_HDRSIZE     (4096)
+#define REC_SUFFIX      ".btr"
+// default amount of records in segment (an hour of 10Hz data)
+#define REC_DEFSIZE     (36000)
+
+#pragma pack(push, 4)
+typedef struct{
+	char magic[8];          // REC_MAGIC
+	uint32_t version;       // REC_VERSION
+	uint32_t hdrsize;       // REC_HDRSIZE
+	uint32_t recsize;       // sizeof(bta_record)
+	uint32_t datasize;      // sizeof(struct BTA_Data)
+	uint32_t localsize;     // sizeof(struct BTA_Local)
+	uint32_t dataver;       // BTA_Data_Ver
+	uint32_t capacity;      // max amount of records
+	uint32_t segno;         // number of segment in recording session
+	uint64_t idxoff;        // offset of index
+	uint64_t recoff;        // offset of records
+	double tstart;          // UNIX time of segment creation
+	double first;           // index value of first record
+	double last;            // index value of last record
+	uint32_t missed;        // amount of missed server ticks
+	volatile uint32_t count;// amount of records written
+} rec_header;
+
+typedef struct{
+	double mtime;           // M_time of record (the same as in index)
+	double rtime;           // local UNIX time of copying
+	uint32_t coherent;      // ==1 if data wasn't changing while copying
+	uint32_t seq;           // number of record since recording start
+	struct BTA_Data data;
+	struct BTA_Local local;
+} bta_record;
+#pragma pack(pop)
+
+// segment opened for reading
+typedef struct{
+	mmapbuf *buf;
+	rec_header *hdr;
+	double *idx;
+	bta_record *rec;
+	uint32_t count;         // amount of records available
+} rec_segment;
+
+int run_recorder(char *prefix, int capacity, int nsegs, double duration);
+
+rec_segment *rec_open(char *filename);
+void rec_close(rec_segment *s);
+uint32_t rec_find(rec_segment *s, double t);
+bta_record *rec_get(rec_segment *s, uint32_t n);
+
+#endif // __RECORDER_H__
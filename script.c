@@ -0,0 +1,142 @@
+/*
+ * script.c - batch of commands in one process
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#define _GNU_SOURCE // for getline
+#include <sys/wait.h>
+#include "usefull_macros.h"
+#include "parceargs.h"
+#include "timers.h"
+#include "script.h"
+
+/*
+ * Each line of script contains options of one bta_control run (in the same format as
+ * in command line, arguments with spaces should be quoted); empty lines and text after
+ * '#' are ignored. Shared memory, command queue & access key are got only once, but each
+ * step runs in child process: wrong options or fatal errors (exit() inside of step) don't
+ * kill whole script, such step counts as failed.
+ */
+#define SCRIPT_MAXARGS  (64)
+
+/**
+ * Split line into arguments (in-place), single or double quotes group words
+ * @param argv (o) - arguments, argv[0] is program name
+ * @return argc or -1 if line is wrong
+ */
+static int split_line(char *line, char **argv){
+	int argc = 1;
+	char *in = line, *out = line;
+	while(1){
+		while(*in == ' ' || *in == '\t' || *in == '\n' || *in == '\r') ++in;
+		if(!*in || *in == '#') break;
+		if(argc == SCRIPT_MAXARGS) return -1;
+		argv[argc++] = out;
+		char quote = 0;
+		for(; *in; ++in){
+			if(quote){
+				if(*in == quote) quote = 0;
+				else *out++ = *in;
+			}else if(*in == '"' || *in == '\''){
+				quote = *in;
+			}else if(*in == ' ' || *in == '\t' || *in == '\n' || *in == '\r'){
+				++in;
+				break;
+			}else *out++ = *in;
+		}
+		if(quote) return -1; // unclosed quote
+		*out++ = 0;
+	}
+	argv[argc] = NULL;
+	return argc;
+}
+
+/**
+ * Run one step in child process
+ * @return exit code of step (128 + signal number if it was killed)
+ */
+static int run_step(script_handler handler, int argc, char **argv){
+	pid_t pid;
+	int status;
+	fflush(stdout);
+	fflush(stderr);
+	if((pid = fork()) < 0){
+		WARN("fork()");
+		return 1;
+	}
+	if(pid == 0) exit(handler(argc, argv));
+	while(waitpid(pid, &status, 0) < 0)
+		if(errno != EINTR){
+			WARN("waitpid()");
+			return 1;
+		}
+	if(WIFEXITED(status)) return WEXITSTATUS(status);
+	if(WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+	return 1;
+}
+
+/**
+ * Run all steps of script
+ * @param filename  - script file name or "-" for stdin
+ * @param handler   - function to run each step
+ * @param stoponerr - ==1 to stop at first failed step
+ * @param steptimes - ==1 to show running time of each step
+ * @return 0 if all OK or exit code of first failed step
+ */
+int run_script(char *filename, script_handler handler, int stoponerr, int steptimes){
+	FILE *f = stdin;
+	char *line = NULL, *argv[SCRIPT_MAXARGS + 1];
+	size_t len = 0;
+	int lineno = 0, nsteps = 0, nfailed = 0, ret = 0;
+	double t0 = mtime();
+	if(strcmp(filename, "-") && !(f = fopen(filename, "r"))){
+		WARN(_("Can't open %s"), filename);
+		return 1;
+	}
+	// children share file offset with us: exit() of buffered input stream would move it back
+	setvbuf(f, NULL, _IONBF, 0);
+	argv[0] = (char*)__progname;
+	while(getline(&line, &len, f) > 0){
+		int argc, r;
+		++lineno;
+		if((argc = split_line(line, argv)) < 0){
+			WARNX(_("%s:%d: wrong line (unclosed quote or too much arguments)"), filename, lineno);
+			r = 1;
+		}else if(argc == 1) continue;
+		else{
+			double t = mtime();
+			++nsteps;
+			r = run_step(handler, argc, argv);
+			if(steptimes)
+				fprintf(stderr, _("step %d (line %d): %.3fs, code %d\n"), nsteps, lineno, mtime() - t, r);
+		}
+		if(r){
+			++nfailed;
+			if(!ret) ret = r;
+			if(stoponerr){
+				WARNX(_("%s:%d: failed, stop"), filename, lineno);
+				break;
+			}
+		}
+	}
+	if(steptimes)
+		fprintf(stderr, _("%d steps (%d failed) in %.3fs\n"), nsteps, nfailed, mtime() - t0);
+	free(line);
+	if(f != stdin) fclose(f);
+	return ret;
+}
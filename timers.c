@@ -0,0 +1,221 @@
+/*
+ * timers.c - monotonic deadlines served by single thread
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <pthread.h>
+#include <time.h>
+
+#include "usefull_macros.h"
+#include "timers.h"
+
+/*
+ * All deadlines are kept in a small table & served by one long-lived thread,
+ * which sleeps on condition variable (with CLOCK_MONOTONIC) until the nearest
+ * deadline. Expired deadline sets its flag to 1.
+ * Timer ID consists of slot number & generation, so cancelling of already
+ * fired (and reused) slot is harmless.
+ */
+typedef struct{
+	char name[TIMER_NAMELEN];
+	double deadline;        // monotonic time of expiration
+	volatile int *flag;     // flag to set
+	uint32_t gen;           // generation of slot
+	int active;
+} deadline;
+
+static deadline timers[TIMERS_MAX];
+static timers_stat tstat = {0};
+static pthread_mutex_t tmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tcond;
+static pthread_once_t tonce = PTHREAD_ONCE_INIT;
+static int thread_ok = 0; // ==1 if timers thread is running in this process
+
+#define ID(slot)    ((int)((timers[slot].gen << 8) | (slot)))
+#define SLOT(id)    ((id) & 0xff)
+#define GEN(id)     ((uint32_t)(id) >> 8)
+
+/**
+ * Monotonic time (seconds)
+ */
+double mtime(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *timers_thread(_U_ void *arg){
+	pthread_mutex_lock(&tmutex);
+	while(1){
+		int i, nact = 0;
+		double next = 0., now = mtime();
+		for(i = 0; i < TIMERS_MAX; ++i){
+			deadline *d = &timers[i];
+			if(!d->active) continue;
+			if(d->deadline <= now){
+				double over = now - d->deadline;
+				*d->flag = 1;
+				d->active = 0;
+				++tstat.fired;
+				tstat.over_sum += over;
+				if(over > tstat.over_max) tstat.over_max = over;
+				DBG("Timer '%s' fired, overshoot: %.3fms", d->name, over*1e3);
+				continue;
+			}
+			if(!nact++ || d->deadline < next) next = d->deadline;
+		}
+		if(!nact) pthread_cond_wait(&tcond, &tmutex);
+		else{
+			struct timespec ts;
+			ts.tv_sec = (time_t)next;
+			ts.tv_nsec = (long)((next - (double)ts.tv_sec) * 1e9);
+			pthread_cond_timedwait(&tcond, &tmutex, &ts);
+		}
+	}
+	return NULL;
+}
+
+static void cond_init(){
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&tcond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+// fork() copies only calling thread: child should run its own timers thread
+static void atfork_prepare(){ pthread_mutex_lock(&tmutex); }
+static void atfork_parent(){ pthread_mutex_unlock(&tmutex); }
+static void atfork_child(){
+	thread_ok = 0;
+	cond_init();
+	pthread_mutex_unlock(&tmutex);
+}
+
+static void timers_init(){
+	cond_init();
+	pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+}
+
+// run timers thread (if it isn't running), call with locked mutex
+static int timers_run(){
+	pthread_t thread;
+	if(thread_ok) return 1;
+	if(pthread_create(&thread, NULL, timers_thread, NULL)){
+		WARN(_("Can't create timers thread!"));
+		return 0;
+	}
+	pthread_detach(thread);
+	thread_ok = 1;
+	return 1;
+}
+
+/**
+ * Add new deadline
+ * @param name  - name of deadline (for debug)
+ * @param delay - time from now (seconds)
+ * @param flag  - variable to set to 1 on expiration (cleared here)
+ * @return timer ID or -1 if failed (in this case flag is set to 1 at once)
+ */
+int timer_add(const char *name, double delay, volatile int *flag){
+	int i, id = -1;
+	double t0 = mtime(), dt;
+	if(!flag) return -1;
+	pthread_once(&tonce, timers_init);
+	pthread_mutex_lock(&tmutex);
+	if(!timers_run()){
+		pthread_mutex_unlock(&tmutex);
+		*flag = 1;
+		return -1;
+	}
+	for(i = 0; i < TIMERS_MAX; ++i){
+		deadline *d = &timers[i];
+		if(d->active) continue;
+		snprintf(d->name, TIMER_NAMELEN, "%s", name ? name : "");
+		d->deadline = t0 + delay;
+		d->flag = flag;
+		d->gen = (d->gen + 1) & 0x7fffff;
+		d->active = 1;
+		*flag = 0;
+		id = ID(i);
+		break;
+	}
+	if(id < 0){
+		WARNX(_("Too much timers, can't add '%s'"), name);
+		*flag = 1;
+	}else{
+		++tstat.created;
+		pthread_cond_signal(&tcond);
+		dt = mtime() - t0;
+		tstat.create_sum += dt;
+		if(dt > tstat.create_max) tstat.create_max = dt;
+	}
+	pthread_mutex_unlock(&tmutex);
+	return id;
+}
+
+/**
+ * Cancel deadline (its flag stays unchanged)
+ * @return 1 if timer was active
+ */
+int timer_cancel(int id){
+	int ret = 0;
+	if(id < 0) return 0;
+	pthread_mutex_lock(&tmutex);
+	deadline *d = &timers[SLOT(id) % TIMERS_MAX];
+	if(d->active && d->gen == GEN(id)){
+		d->active = 0;
+		++tstat.cancelled;
+		ret = 1;
+	}
+	pthread_mutex_unlock(&tmutex);
+	return ret;
+}
+
+/**
+ * @return 1 if deadline `id` isn't expired yet
+ */
+int timer_active(int id){
+	int ret;
+	if(id < 0) return 0;
+	pthread_mutex_lock(&tmutex);
+	deadline *d = &timers[SLOT(id) % TIMERS_MAX];
+	ret = (d->active && d->gen == GEN(id));
+	pthread_mutex_unlock(&tmutex);
+	return ret;
+}
+
+/**
+ * @return time left to deadline `id` or 0 if it's inactive
+ */
+double timer_left(int id){
+	double ret = 0.;
+	if(id < 0) return 0.;
+	pthread_mutex_lock(&tmutex);
+	deadline *d = &timers[SLOT(id) % TIMERS_MAX];
+	if(d->active && d->gen == GEN(id)) ret = d->deadline - mtime();
+	pthread_mutex_unlock(&tmutex);
+	return (ret > 0.) ? ret : 0.;
+}
+
+void get_timers_stat(timers_stat *st){
+	if(!st) return;
+	pthread_mutex_lock(&tmutex);
+	*st = tstat;
+	pthread_mutex_unlock(&tmutex);
+}
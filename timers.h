@@ -0,0 +1,50 @@
+/*
+ * timers.h - monotonic deadlines served by single thread
+ *
+ * Copyright 2016 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __TIMERS_H__
+#define __TIMERS_H__
+
+#include <stdint.h>
+
+// max amount of simultaneously active deadlines
+#define TIMERS_MAX      (32)
+// max length of deadline name
+#define TIMER_NAMELEN   (16)
+
+// statistics of timers
+typedef struct{
+	uint64_t created;     // amount of deadlines set
+	uint64_t fired;       // amount of expired deadlines
+	uint64_t cancelled;   // amount of cancelled deadlines
+	double create_sum;    // total time spent in timer_add() (seconds)
+	double create_max;    // max time of timer_add()
+	double over_sum;      // total overshoot (delay between deadline & flag setting)
+	double over_max;      // max overshoot
+} timers_stat;
+
+double mtime();
+int timer_add(const char *name, double delay, volatile int *flag);
+int timer_cancel(int id);
+int timer_active(int id);
+double timer_left(int id);
+void get_timers_stat(timers_stat *st);
+
+#endif // __TIMERS_H__